@@ -0,0 +1,107 @@
+#include "pch.h"
+#include "gtest/gtest.h"
+#include "../orderbook/bar_aggregator.h"
+#include <vector>
+
+namespace {
+
+constexpr std::int64_t kSecond = 1000000000;
+
+} // namespace
+
+// Test that trades fold into OHLCV/VWAP bars aligned to the interval.
+TEST(BarAggregatorTest, SeriesBuildsAlignedBars) {
+    BarSeries series(kSecond, 10);
+    series.add(5 * kSecond + 100, 10.0, 2);
+    series.add(5 * kSecond + 200, 12.0, 1);
+    series.add(5 * kSecond + 300, 9.0, 1);
+    series.add(7 * kSecond + 1, 11.0, 4);
+
+    std::vector<Bar> bars;
+    series.latest(10, bars);
+    ASSERT_EQ(bars.size(), 2);
+    EXPECT_EQ(bars[0].start, 5 * kSecond);
+    EXPECT_DOUBLE_EQ(bars[0].open, 10.0);
+    EXPECT_DOUBLE_EQ(bars[0].high, 12.0);
+    EXPECT_DOUBLE_EQ(bars[0].low, 9.0);
+    EXPECT_DOUBLE_EQ(bars[0].close, 9.0);
+    EXPECT_EQ(bars[0].volume, 4);
+    EXPECT_EQ(bars[0].trades, 3);
+    EXPECT_DOUBLE_EQ(bars[0].vwap(), (20.0 + 12.0 + 9.0) / 4);
+    EXPECT_EQ(bars[1].start, 7 * kSecond);      // The quiet second has no bar.
+    EXPECT_EQ(bars[1].volume, 4);
+}
+
+// Test that only the bars touched since the last take are reported, and that
+// history is bounded.
+TEST(BarAggregatorTest, SeriesReportsChangedBarsAndKeepsHistory) {
+    BarSeries series(kSecond, 2);
+    std::vector<Bar> changed;
+    series.add(1 * kSecond, 10.0, 1);
+    series.takeChanged(changed);
+    ASSERT_EQ(changed.size(), 1);
+
+    changed.clear();
+    series.add(1 * kSecond + 5, 11.0, 1);       // Closes with a late trade...
+    series.add(2 * kSecond, 12.0, 1);           // ...then the next bar opens.
+    series.takeChanged(changed);
+    ASSERT_EQ(changed.size(), 2);
+    EXPECT_EQ(changed[0].volume, 2);
+    EXPECT_EQ(changed[1].start, 2 * kSecond);
+
+    changed.clear();
+    series.takeChanged(changed);
+    EXPECT_TRUE(changed.empty());
+
+    for (std::int64_t second = 3; second < 10; second++) {
+        series.add(second * kSecond, 10.0, 1);
+    }
+    std::vector<Bar> bars;
+    series.latest(100, bars);
+    ASSERT_EQ(bars.size(), 3);                  // Two closed bars plus the open one.
+    EXPECT_EQ(bars.back().start, 9 * kSecond);
+}
+
+// Test that the aggregator picks executions up from the engine's tapes.
+TEST(BarAggregatorTest, AggregatesEngineTrades) {
+    MatchingEngine engine(2);
+    engine.start();
+    BarAggregator aggregator(engine, { kSecond, 60 * kSecond });
+    std::vector<BarUpdate> updates;
+    aggregator.setListener([&](const std::vector<BarUpdate>& pass) {
+        updates.insert(updates.end(), pass.begin(), pass.end());
+        });
+
+    EngineCommand add;
+    add.type = EngineCommand::Type::ADD;
+    for (const char* symbol : { "AAPL", "MSFT" }) {
+        add.symbol = symbol;
+        add.order = Order(1, 100.0, 10, OrderType::SELL, symbol);
+        engine.submit(add).get();
+        add.order = Order(2, 101.0, 10, OrderType::SELL, symbol);
+        engine.submit(add).get();
+        add.order = Order(3, 101.0, 15, OrderType::BUY, symbol);
+        engine.submit(add).get();
+    }
+    engine.stop();
+    EXPECT_EQ(aggregator.poll(), 4);
+    EXPECT_EQ(aggregator.poll(), 0);
+
+    std::vector<Bar> bars;
+    ASSERT_TRUE(aggregator.bars("AAPL", 60 * kSecond, 10, bars));
+    ASSERT_EQ(bars.size(), 1);
+    EXPECT_DOUBLE_EQ(bars[0].open, 100.0);
+    EXPECT_DOUBLE_EQ(bars[0].close, 101.0);
+    EXPECT_EQ(bars[0].volume, 15);
+    EXPECT_EQ(bars[0].trades, 2);
+    EXPECT_DOUBLE_EQ(bars[0].vwap(), (1000.0 + 505.0) / 15);
+    EXPECT_FALSE(aggregator.bars("AAPL", 5 * kSecond, 10, bars));
+    EXPECT_EQ(aggregator.missedTrades(), 0);
+
+    std::size_t minuteUpdates = 0;
+    for (const BarUpdate& update : updates) {
+        EXPECT_FALSE(update.bars.empty());
+        minuteUpdates += update.interval == 60 * kSecond;
+    }
+    EXPECT_EQ(minuteUpdates, 2);                // One per symbol.
+}
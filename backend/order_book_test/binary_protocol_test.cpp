@@ -0,0 +1,173 @@
+#include "pch.h"
+#include "gtest/gtest.h"
+#include "../orderbook/binary_protocol.h"
+#include <cstring>
+#include <string>
+
+namespace {
+
+template <typename Message>
+std::string bytes(const Message& message) {
+    return std::string(reinterpret_cast<const char*>(&message), sizeof(message));
+}
+
+} // namespace
+
+// Test the wire layout: fixed sizes, no padding.
+TEST(BinaryProtocolTest, FixedLayout) {
+    EXPECT_EQ(sizeof(BinaryHeader), 4);
+    EXPECT_EQ(sizeof(BinaryNewOrder), 40);
+    EXPECT_EQ(sizeof(BinaryCancel), 24);
+    EXPECT_EQ(sizeof(BinaryModify), 36);
+    EXPECT_EQ(sizeof(BinaryBatch), 24);
+    EXPECT_EQ(sizeof(BinaryAck), 16);
+    EXPECT_EQ(sizeof(BinaryReject), 9);
+    EXPECT_EQ(sizeof(BinaryFill), 32);
+}
+
+// Test that back-to-back messages decode into engine commands and a
+// trailing partial message is left for the next read.
+TEST(BinaryProtocolTest, DecodesStreamIntoCommands) {
+    BinaryNewOrder order;
+    order.orderId = 42;
+    order.quantity = 7;
+    order.price = 101.25;
+    order.side = 1;
+    std::memcpy(order.symbol, "AAPL", 4);
+    BinaryCancel cancel;
+    cancel.orderId = 9;
+    std::string stream = bytes(order) + bytes(cancel) + bytes(order).substr(0, 10);
+
+    EngineCommand command;
+    std::size_t consumed = 0;
+    ASSERT_EQ(decodeBinaryCommand(stream.data(), stream.size(), command, consumed), BinaryDecodeStatus::OK);
+    EXPECT_EQ(consumed, sizeof(BinaryNewOrder));
+    EXPECT_EQ(command.type, EngineCommand::Type::ADD);
+    EXPECT_EQ(command.symbol, Symbol("AAPL"));
+    EXPECT_EQ(command.order.GetOrderId(), 42);
+    EXPECT_EQ(command.order.quantity, 7);
+    EXPECT_DOUBLE_EQ(command.order.GetPrice(), 101.25);
+    EXPECT_EQ(command.order.GetSide(), OrderType::SELL);
+
+    std::size_t offset = consumed;
+    ASSERT_EQ(decodeBinaryCommand(stream.data() + offset, stream.size() - offset, command, consumed), BinaryDecodeStatus::OK);
+    EXPECT_EQ(command.type, EngineCommand::Type::CANCEL);
+    EXPECT_EQ(command.orderId, 9);
+    EXPECT_TRUE(command.symbol.empty());
+
+    offset += consumed;
+    EXPECT_EQ(decodeBinaryCommand(stream.data() + offset, stream.size() - offset, command, consumed), BinaryDecodeStatus::INCOMPLETE);
+}
+
+// Test that unknown types, versions and lengths are refused.
+TEST(BinaryProtocolTest, RejectsMalformedMessages) {
+    EngineCommand command;
+    std::size_t consumed = 0;
+    BinaryNewOrder order;
+    order.header.type = 'Z';
+    std::string unknown = bytes(order);
+    EXPECT_EQ(decodeBinaryCommand(unknown.data(), unknown.size(), command, consumed), BinaryDecodeStatus::MALFORMED);
+
+    order = BinaryNewOrder();
+    order.header.version = 2;
+    std::string version = bytes(order);
+    EXPECT_EQ(decodeBinaryCommand(version.data(), version.size(), command, consumed), BinaryDecodeStatus::MALFORMED);
+
+    order = BinaryNewOrder();
+    order.header.length = 12;
+    std::string length = bytes(order);
+    EXPECT_EQ(decodeBinaryCommand(length.data(), length.size(), command, consumed), BinaryDecodeStatus::MALFORMED);
+}
+
+// Test that an accepted add is answered with an ACK and one FILL per trade,
+// and a failed cancel with a REJECT.
+TEST(BinaryProtocolTest, EncodesReplies) {
+    EngineCommand add;
+    add.type = EngineCommand::Type::ADD;
+    add.order = Order(5, 10.0, 3, OrderType::BUY);
+    CommandResult result;
+    result.accepted = true;
+    result.sequence = 77;
+    result.trades.push_back({ 5, 2, 3, 9.5 });
+
+    std::string out;
+    encodeBinaryResult(add, result, out);
+    ASSERT_EQ(out.size(), sizeof(BinaryAck) + sizeof(BinaryFill));
+    BinaryAck ack;
+    std::memcpy(&ack, out.data(), sizeof(ack));
+    EXPECT_EQ(ack.header.type, BINARY_ACK);
+    EXPECT_EQ(ack.orderId, 5);
+    EXPECT_EQ(ack.sequence, 77);
+    BinaryFill fill;
+    std::memcpy(&fill, out.data() + sizeof(ack), sizeof(fill));
+    EXPECT_EQ(fill.header.type, BINARY_FILL);
+    EXPECT_EQ(fill.sellOrderId, 2);
+    EXPECT_DOUBLE_EQ(fill.price, 9.5);
+
+    EngineCommand cancel;
+    cancel.type = EngineCommand::Type::CANCEL;
+    cancel.orderId = 8;
+    out.clear();
+    encodeBinaryResult(cancel, CommandResult(), out);
+    ASSERT_EQ(out.size(), sizeof(BinaryReject));
+    BinaryReject reject;
+    std::memcpy(&reject, out.data(), sizeof(reject));
+    EXPECT_EQ(reject.orderId, 8);
+    EXPECT_EQ(reject.reason, REJECT_UNKNOWN_ORDER);
+}
+
+// Test that a batch decodes into one BATCH command and is answered entry by
+// entry, each with its own sequence and trades.
+TEST(BinaryProtocolTest, BatchRoundTrip) {
+    BinaryBatch batch;
+    batch.count = 2;
+    std::memcpy(batch.symbol, "MSFT", 4);
+    batch.header.length = sizeof(BinaryBatch) + sizeof(BinaryNewOrder) + sizeof(BinaryCancel);
+    BinaryNewOrder order;
+    order.orderId = 3;
+    order.quantity = 4;
+    order.price = 50.0;
+    BinaryCancel cancel;
+    cancel.orderId = 1;
+    std::string stream = bytes(batch) + bytes(order) + bytes(cancel);
+
+    EngineCommand command;
+    std::size_t consumed = 0;
+    ASSERT_EQ(decodeBinaryCommand(stream.data(), stream.size(), command, consumed), BinaryDecodeStatus::OK);
+    EXPECT_EQ(consumed, stream.size());
+    EXPECT_EQ(command.type, EngineCommand::Type::BATCH);
+    EXPECT_EQ(command.symbol, Symbol("MSFT"));
+    ASSERT_EQ(command.batch.size(), 2u);
+    EXPECT_EQ(command.batch[0].type, BookCommand::Type::ADD);
+    EXPECT_EQ(command.batch[0].order.GetOrderId(), 3);
+    EXPECT_EQ(command.batch[0].order.symbol, Symbol("MSFT"));
+    EXPECT_EQ(command.batch[1].type, BookCommand::Type::CANCEL);
+    EXPECT_EQ(command.batch[1].orderId, 1);
+
+    CommandResult result;
+    result.accepted = true;
+    result.sequence = 11;
+    result.trades.push_back({ 3, 7, 4, 49.0 });
+    result.batch.push_back({ true, 10, 0, 1 });
+    result.batch.push_back({ false, 0, 1, 0 });
+    std::string out;
+    encodeBinaryResult(command, result, out);
+    ASSERT_EQ(out.size(), sizeof(BinaryAck) + sizeof(BinaryFill) + sizeof(BinaryReject));
+    BinaryAck ack;
+    std::memcpy(&ack, out.data(), sizeof(ack));
+    EXPECT_EQ(ack.orderId, 3);
+    EXPECT_EQ(ack.sequence, 10);
+    BinaryFill fill;
+    std::memcpy(&fill, out.data() + sizeof(ack), sizeof(fill));
+    EXPECT_EQ(fill.sellOrderId, 7);
+    EXPECT_EQ(fill.sequence, 10);
+    BinaryReject reject;
+    std::memcpy(&reject, out.data() + sizeof(ack) + sizeof(fill), sizeof(reject));
+    EXPECT_EQ(reject.orderId, 1);
+    EXPECT_EQ(reject.reason, REJECT_UNKNOWN_ORDER);
+
+    // An entry for another symbol poisons the whole batch.
+    std::memcpy(order.symbol, "AAPL", 4);
+    std::string foreign = bytes(batch) + bytes(order) + bytes(cancel);
+    EXPECT_EQ(decodeBinaryCommand(foreign.data(), foreign.size(), command, consumed), BinaryDecodeStatus::MALFORMED);
+}
@@ -0,0 +1,156 @@
+#include "pch.h"
+#include "gtest/gtest.h"
+#include "../orderbook/book_view.h"
+#include "../orderbook/matching_engine.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::vector<std::pair<Symbol, std::shared_ptr<const BookView>>> changedView(const Symbol& symbol, const OrderBook& book) {
+    return { { symbol, BookView::capture(book) } };
+}
+
+} // namespace
+
+// Test that a view holds the book's orders and levels as of its capture.
+TEST(BookViewTest, CapturesOrdersAndLevels) {
+    OrderBook book;
+    std::vector<Trade> trades;
+    book.addOrder(Order(1, 99.0, 10, OrderType::BUY, "AAPL"), trades);
+    book.addOrder(Order(2, 99.0, 5, OrderType::BUY, "AAPL"), trades);
+    book.addOrder(Order(3, 98.0, 7, OrderType::BUY, "AAPL"), trades);
+    book.addOrder(Order(4, 101.0, 3, OrderType::SELL, "AAPL"), trades);
+
+    auto view = BookView::capture(book);
+    book.cancelOrder(1);
+
+    EXPECT_EQ(view->sequence + 1, book.updateSequence());
+    ASSERT_EQ(view->bids.size(), 3);
+    EXPECT_EQ(view->bids[0].orderID, 1);
+    ASSERT_EQ(view->asks.size(), 1);
+    ASSERT_EQ(view->levels.bids.size(), 2);
+    EXPECT_EQ(view->levels.bids[0].quantity, 15);
+    EXPECT_EQ(view->levels.bids[0].orderCount, 2u);
+
+    BookDepth top = view->depth(1);
+    EXPECT_EQ(top.sequence, view->sequence);
+    ASSERT_EQ(top.bids.size(), 1);
+    EXPECT_EQ(top.bids[0].price, 99.0);
+    EXPECT_EQ(top.asks.size(), 1);
+}
+
+// Test that a view only copies the best levels of a deep book.
+TEST(BookViewTest, CapturesOnlyTheBestLevels) {
+    OrderBook book;
+    std::vector<Trade> trades;
+    for (int i = 0; i < 50; i++) {
+        book.addOrder(Order(2 * i + 1, 99.0 - i, 1, OrderType::BUY, "AAPL"), trades);
+        book.addOrder(Order(2 * i + 2, 99.0 - i, 1, OrderType::BUY, "AAPL"), trades);
+    }
+    auto view = BookView::capture(book, 3);
+    ASSERT_EQ(view->levels.bids.size(), 3);
+    EXPECT_EQ(view->levels.bids[2].price, 97.0);
+    ASSERT_EQ(view->bids.size(), 6);
+    EXPECT_EQ(view->bids[5].orderID, 6);
+    EXPECT_TRUE(view->asks.empty());
+    EXPECT_TRUE(view->truncated);
+    EXPECT_FALSE(BookView::capture(book, 50)->truncated);
+}
+
+// Test that a replaced view stays valid while read, and is freed afterwards.
+TEST(BookViewTest, ReclaimsReplacedViewsAfterReaders) {
+    ViewPublisher views;
+    OrderBook book;
+    std::vector<Trade> trades;
+    EXPECT_EQ(views.read("AAPL", [](const BookView& view) { return view.bids.size(); }), 0);
+
+    book.addOrder(Order(1, 99.0, 10, OrderType::BUY, "AAPL"), trades);
+    auto changed = changedView("AAPL", book);
+    views.publish(changed);
+
+    std::atomic<bool> reading{ false };
+    std::atomic<bool> release{ false };
+    std::thread reader([&] {
+        views.read("AAPL", [&](const BookView& view) {
+            reading = true;
+            while (!release) {
+                std::this_thread::yield();
+            }
+            EXPECT_EQ(view.bids.size(), 1);
+            EXPECT_EQ(view.bids[0].orderID, 1);
+            return 0;
+        });
+    });
+    while (!reading) {
+        std::this_thread::yield();
+    }
+    book.cancelOrder(1);
+    changed = changedView("AAPL", book);
+    views.publish(changed);
+    EXPECT_EQ(views.read("AAPL", [](const BookView& view) { return view.bids.size(); }), 0);
+    EXPECT_GE(views.retiredCount(), 1);
+
+    release = true;
+    reader.join();
+    changed = changedView("MSFT", book);
+    views.publish(changed);
+    EXPECT_EQ(views.retiredCount(), 0);
+    EXPECT_EQ(views.read("AAPL", [](const BookView& view) { return view.sequence; }), book.updateSequence());
+}
+
+// Test that readers see whole, ever newer views while the shard keeps matching.
+TEST(BookViewTest, EngineViewsFollowTheBook) {
+    const int kOrders = 20000;
+    MatchingEngine engine(1);
+    engine.enableBookViews();
+    engine.start();
+
+    std::atomic<bool> done{ false };
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; r++) {
+        readers.emplace_back([&engine, &done] {
+            std::uint64_t last = 0;
+            while (!done) {
+                engine.readView("AAPL", [&last](const BookView& view) {
+                    EXPECT_GE(view.sequence, last);
+                    last = view.sequence;
+                    std::size_t orders = 0;
+                    for (const DepthLevel& level : view.levels.bids) {
+                        orders += level.orderCount;
+                    }
+                    EXPECT_EQ(orders, view.bids.size());
+                    return 0;
+                    });
+            }
+        });
+    }
+
+    std::vector<std::future<CommandResult>> results;
+    for (int i = 1; i <= kOrders; i++) {
+        EngineCommand add;
+        add.type = EngineCommand::Type::ADD;
+        add.symbol = "AAPL";
+        add.order = Order(i, 90.0 + i % 10, 1, OrderType::BUY, "AAPL");
+        results.push_back(engine.submit(add));
+    }
+    std::uint64_t sequence = 0;
+    for (auto& result : results) {
+        sequence = result.get().bookSequence;
+    }
+
+    // The view of the last drain is published right after its completions ran.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (engine.readView("AAPL", [](const BookView& view) { return view.sequence; }) < sequence &&
+        std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    done = true;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(engine.readView("AAPL", [](const BookView& view) { return view.bids.size(); }), kOrders);
+    engine.stop();
+}
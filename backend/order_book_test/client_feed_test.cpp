@@ -0,0 +1,134 @@
+#include "pch.h"
+#include "gtest/gtest.h"
+#include "../orderbook/client_feed.h"
+#include <string>
+
+namespace {
+
+FeedUpdatePtr levelUpdate(std::uint64_t sequence, OrderType side, Price price, std::int64_t quantity) {
+    auto update = std::make_shared<FeedUpdate>();
+    update->bookSequence = sequence;
+    BookDelta level;
+    level.side = side;
+    level.price = price;
+    level.quantity = quantity;
+    level.orderCount = quantity > 0 ? 1 : 0;
+    update->deltas.push_back(level);
+    update->message = "delta " + std::to_string(sequence);
+    return update;
+}
+
+// Renders conflated output as "levels <seq>: <price>=<qty> ...".
+std::string conflated(std::uint64_t sequence, const std::vector<BookDelta>& levels) {
+    std::string text = "levels " + std::to_string(sequence) + ":";
+    for (const BookDelta& level : levels) {
+        text += " " + std::to_string(static_cast<int>(level.price)) + "=" + std::to_string(level.quantity);
+    }
+    return text;
+}
+
+} // namespace
+
+// Test that a client that keeps up gets every update as it was published.
+TEST(ClientFeedTest, PassesUpdatesThroughWhenKeepingUp) {
+    ClientFeed feed;
+    auto now = ClientFeed::Clock::now();
+    std::vector<std::string> out;
+    EXPECT_TRUE(feed.offer(levelUpdate(1, OrderType::BUY, 10, 5)));
+    EXPECT_TRUE(feed.offer(levelUpdate(2, OrderType::BUY, 11, 5)));
+    feed.drain(now, conflated, out);
+    EXPECT_EQ(out, (std::vector<std::string>{ "delta 1", "delta 2" }));
+    EXPECT_FALSE(feed.pending());
+}
+
+// Test that an overflowing queue is conflated to the latest state per level.
+TEST(ClientFeedTest, ConflatesWhenQueueOverflows) {
+    ClientFeed::Limits limits;
+    limits.maxQueued = 2;
+    ClientFeed feed(limits);
+    feed.offer(levelUpdate(1, OrderType::BUY, 10, 5));
+    feed.offer(levelUpdate(2, OrderType::SELL, 12, 7));
+    feed.offer(levelUpdate(3, OrderType::BUY, 10, 8));   // Overflows.
+    EXPECT_TRUE(feed.conflating());
+    feed.offer(levelUpdate(4, OrderType::SELL, 12, 0));
+
+    std::vector<std::string> out;
+    feed.drain(ClientFeed::Clock::now(), conflated, out);
+    EXPECT_EQ(out, (std::vector<std::string>{ "levels 4: 10=8 12=0" }));
+
+    // Back to plain updates once the backlog is sent.
+    out.clear();
+    feed.offer(levelUpdate(5, OrderType::BUY, 9, 1));
+    feed.drain(ClientFeed::Clock::now(), conflated, out);
+    EXPECT_EQ(out, (std::vector<std::string>{ "delta 5" }));
+}
+
+// Test that a rate-limited client gets at most one message per interval.
+TEST(ClientFeedTest, RateLimitsPerClient) {
+    ClientFeed::Limits limits;
+    limits.minInterval = std::chrono::milliseconds(100);
+    ClientFeed feed(limits);
+    auto start = ClientFeed::Clock::now();
+    std::vector<std::string> out;
+
+    feed.offer(levelUpdate(1, OrderType::BUY, 10, 5));
+    feed.drain(start, conflated, out);
+    EXPECT_EQ(out, (std::vector<std::string>{ "delta 1" }));
+
+    out.clear();
+    feed.offer(levelUpdate(2, OrderType::BUY, 10, 6));
+    feed.offer(levelUpdate(3, OrderType::BUY, 11, 1));
+    feed.drain(start + std::chrono::milliseconds(50), conflated, out);
+    EXPECT_TRUE(out.empty());
+    EXPECT_EQ(feed.nextDue(), start + std::chrono::milliseconds(100));
+
+    feed.drain(start + std::chrono::milliseconds(100), conflated, out);
+    EXPECT_EQ(out, (std::vector<std::string>{ "levels 3: 10=6 11=1" }));
+}
+
+// Test that a client whose conflated backlog keeps growing is dropped.
+TEST(ClientFeedTest, DropsClientTooFarBehind) {
+    ClientFeed::Limits limits;
+    limits.maxQueued = 1;
+    limits.maxLevels = 3;
+    ClientFeed feed(limits);
+    bool keep = true;
+    for (int i = 0; i < 5 && keep; i++) {
+        keep = feed.offer(levelUpdate(i + 1, OrderType::BUY, 10 + i, 1));
+    }
+    EXPECT_FALSE(keep);
+}
+
+// Test that a client with a full window gets nothing until it acknowledges,
+// and then the conflated state of what it missed.
+TEST(ClientFeedTest, HoldsClientWithFullWindow) {
+    ClientFeed::Limits limits;
+    limits.maxUnackedBytes = 14;    // Two "delta N" messages.
+    ClientFeed feed(limits);
+    auto now = ClientFeed::Clock::now();
+    std::vector<std::string> out;
+
+    feed.offer(levelUpdate(1, OrderType::BUY, 10, 5));
+    feed.offer(levelUpdate(2, OrderType::BUY, 11, 1));
+    feed.drain(now, conflated, out);
+    EXPECT_EQ(out, (std::vector<std::string>{ "delta 1", "delta 2" }));
+    EXPECT_TRUE(feed.held());
+    EXPECT_EQ(feed.nextDue(), ClientFeed::Clock::time_point::max());
+
+    out.clear();
+    feed.offer(levelUpdate(3, OrderType::BUY, 10, 7));
+    feed.offer(levelUpdate(4, OrderType::BUY, 12, 2));
+    feed.drain(now, conflated, out);
+    EXPECT_TRUE(out.empty());
+    EXPECT_TRUE(feed.conflating());
+
+    // Acknowledging the first message reopens half the window.
+    feed.acknowledge(1);
+    EXPECT_FALSE(feed.held());
+    EXPECT_EQ(feed.unackedBytes(), 7u);
+    feed.drain(now, conflated, out);
+    EXPECT_EQ(out, (std::vector<std::string>{ "levels 4: 10=7 12=2" }));
+
+    feed.acknowledge(4);
+    EXPECT_EQ(feed.unackedBytes(), 0u);
+}
@@ -0,0 +1,114 @@
+#include "pch.h"
+#include "gtest/gtest.h"
+#include "../orderbook/command_file.h"
+#include <filesystem>
+#include <fstream>
+
+// Test that a written command file reads back command for command.
+TEST(CommandFileTest, RoundTrip) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "orderbook_commands.csv";
+    std::vector<RecordedCommand> written(4);
+    written[0].timestamp = 1000;
+    written[0].command.type = BookCommand::Type::ADD;
+    written[0].command.orderId = 7;
+    written[0].command.order = Order(7, 100.01, 25, OrderType::SELL, Symbol("AAPL"));
+    written[1].timestamp = 1500;
+    written[1].command.type = BookCommand::Type::ADD;
+    written[1].command.orderId = 8;
+    written[1].command.order = Order(8, 0.1 + 0.2, 3, OrderType::BUY);
+    written[2].timestamp = 2200;
+    written[2].command.type = BookCommand::Type::CANCEL;
+    written[2].command.orderId = 7;
+    written[2].command.order.symbol = Symbol("AAPL");
+    written[3].timestamp = 2600;
+    written[3].command.type = BookCommand::Type::MODIFY;
+    written[3].command.orderId = 8;
+    written[3].command.order.price = 0.25;
+    written[3].command.order.quantity = 2;
+    ASSERT_TRUE(writeCommandFile(path.string(), written));
+
+    std::vector<RecordedCommand> read;
+    std::string error;
+    ASSERT_TRUE(readCommandFile(path.string(), read, error)) << error;
+    ASSERT_EQ(read.size(), 4u);
+    EXPECT_EQ(read[0].timestamp, 1000);
+    EXPECT_EQ(read[0].command.type, BookCommand::Type::ADD);
+    EXPECT_EQ(read[0].command.order.GetOrderId(), 7);
+    EXPECT_EQ(read[0].command.order.GetSide(), OrderType::SELL);
+    EXPECT_EQ(read[0].command.order.GetPrice(), 100.01);
+    EXPECT_EQ(read[0].command.order.quantity, 25);
+    EXPECT_EQ(read[0].command.order.symbol, Symbol("AAPL"));
+    EXPECT_EQ(read[0].command.order.timestamp.time_since_epoch(), std::chrono::nanoseconds(1000));
+    EXPECT_EQ(read[1].command.order.GetPrice(), 0.1 + 0.2);   // Exact, not rounded.
+    EXPECT_TRUE(read[1].command.order.symbol.empty());
+    EXPECT_EQ(read[2].command.type, BookCommand::Type::CANCEL);
+    EXPECT_EQ(read[2].command.orderId, 7);
+    EXPECT_EQ(read[2].command.order.symbol, Symbol("AAPL"));
+    EXPECT_EQ(read[3].command.type, BookCommand::Type::MODIFY);
+    EXPECT_EQ(read[3].command.orderId, 8);
+    EXPECT_EQ(read[3].command.order.GetPrice(), 0.25);
+    EXPECT_EQ(read[3].command.order.quantity, 2);
+    std::filesystem::remove(path);
+}
+
+// Test that a bad line is reported with its line number.
+TEST(CommandFileTest, ReportsMalformedLine) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "orderbook_commands_bad.csv";
+    {
+        std::ofstream out(path);
+        out << "# header\n1000,A,1,B,10.5,3,\n\n2000,Q,2,,,,\n";
+    }
+    std::vector<RecordedCommand> read;
+    std::string error;
+    EXPECT_FALSE(readCommandFile(path.string(), read, error));
+    EXPECT_NE(error.find(":4:"), std::string::npos);
+    std::filesystem::remove(path);
+}
+
+// Test that the binary form reads back exactly, stamps orders with the
+// recorded time and stops at a torn tail.
+TEST(CommandFileTest, BinaryRoundTrip) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "orderbook_commands.bin";
+    std::vector<RecordedCommand> written(3);
+    written[0].timestamp = 5000;
+    written[0].command.type = BookCommand::Type::ADD;
+    written[0].command.orderId = 1;
+    written[0].command.order = Order(1, 0.1 + 0.2, 10, OrderType::BUY, Symbol("MSFT"));
+    written[0].command.order.flags = ORDER_STOP;
+    written[0].command.order.stopPrice = 0.35;
+    written[0].command.order.timeInForce = TimeInForce::IOC;
+    written[1].timestamp = 6000;
+    written[1].command.type = BookCommand::Type::MODIFY;
+    written[1].command.orderId = 1;
+    written[1].command.order.price = 0.5;
+    written[1].command.order.quantity = 4;
+    written[1].command.order.symbol = Symbol("MSFT");
+    written[2].timestamp = 0;                   // Unstamped: inherits 6000.
+    written[2].command.type = BookCommand::Type::CANCEL;
+    written[2].command.orderId = 1;
+    written[2].command.order.symbol = Symbol("MSFT");
+    ASSERT_TRUE(writeBinaryCommandFile(path.string(), written));
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out << "torn";
+    }
+
+    std::vector<RecordedCommand> read;
+    std::string error;
+    ASSERT_TRUE(readCommandFile(path.string(), read, error)) << error;
+    ASSERT_EQ(read.size(), 3u);
+    EXPECT_EQ(read[0].timestamp, 5000);
+    EXPECT_EQ(read[0].command.order.timestamp.time_since_epoch(), std::chrono::nanoseconds(5000));
+    EXPECT_EQ(read[0].command.order.GetPrice(), 0.1 + 0.2);
+    EXPECT_EQ(read[0].command.order.quantity, 10);
+    EXPECT_TRUE(read[0].command.order.IsStop());
+    EXPECT_EQ(read[0].command.order.stopPrice, 0.35);
+    EXPECT_EQ(read[0].command.order.GetTimeInForce(), TimeInForce::IOC);
+    EXPECT_EQ(read[0].command.order.symbol, Symbol("MSFT"));
+    EXPECT_EQ(read[1].command.type, BookCommand::Type::MODIFY);
+    EXPECT_EQ(read[1].command.order.GetPrice(), 0.5);
+    EXPECT_EQ(read[1].command.order.quantity, 4);
+    EXPECT_EQ(read[2].command.type, BookCommand::Type::CANCEL);
+    EXPECT_EQ(read[2].timestamp, 6000);
+    std::filesystem::remove(path);
+}
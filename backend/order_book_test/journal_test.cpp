@@ -0,0 +1,188 @@
+#include "pch.h"
+#include "gtest/gtest.h"
+#include "../orderbook/matching_engine.h"
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+std::filesystem::path freshDirectory(const char* name) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    return dir;
+}
+
+EngineCommand addCommand(const Symbol& symbol, OrderId id, Price price, int quantity, OrderType side) {
+    EngineCommand command;
+    command.type = EngineCommand::Type::ADD;
+    command.symbol = symbol;
+    command.order = Order(id, price, quantity, side, symbol);
+    return command;
+}
+
+std::vector<std::pair<OrderId, int>> restingOrders(MatchingEngine& engine, const Symbol& symbol) {
+    return engine.query(symbol, [](const OrderBook& book) {
+        std::vector<std::pair<OrderId, int>> orders;
+        auto [bids, asks] = book.getRawOrderBookData();
+        for (const Order& order : bids) {
+            orders.emplace_back(order.orderID, order.quantity);
+        }
+        for (const Order& order : asks) {
+            orders.emplace_back(order.orderID, order.quantity);
+        }
+        return orders;
+    }).get();
+}
+
+} // namespace
+
+// Test that a restarted engine rebuilds its books from the journal and keeps
+// numbering commands where it left off.
+TEST(JournalTest, RecoversBooksAfterRestart) {
+    std::filesystem::path dir = freshDirectory("orderbook_journal_recover");
+    JournalConfig config;
+    config.directory = dir.string();
+    config.durability = Durability::SYNC;
+
+    std::vector<std::pair<OrderId, int>> before;
+    std::uint64_t lastAaplSequence = 0;
+    {
+        MatchingEngine engine(2);
+        ASSERT_TRUE(engine.enableJournal(config));
+        engine.start();
+        engine.submit(addCommand("AAPL", 1, 50.0, 100, OrderType::BUY)).get();
+        engine.submit(addCommand("AAPL", 2, 51.0, 30, OrderType::BUY)).get();
+        lastAaplSequence = engine.submit(addCommand("AAPL", 3, 50.0, 60, OrderType::SELL)).get().sequence;
+        engine.submit(addCommand("MSFT", 1, 20.0, 10, OrderType::SELL)).get();
+        EngineCommand cancel;
+        cancel.type = EngineCommand::Type::CANCEL;
+        cancel.symbol = "MSFT";
+        cancel.orderId = 1;
+        CommandResult last = engine.submit(cancel).get();
+        engine.waitDurable("MSFT", last.sequence);
+        if (engine.shardFor("MSFT") == engine.shardFor("AAPL")) {
+            lastAaplSequence = last.sequence;
+        }
+        before = restingOrders(engine, "AAPL");
+    }
+
+    MatchingEngine restarted(2);
+    ASSERT_TRUE(restarted.enableJournal(config));
+    restarted.start();
+    EXPECT_EQ(restingOrders(restarted, "AAPL"), before);
+    EXPECT_TRUE(restingOrders(restarted, "MSFT").empty());
+
+    CommandResult next = restarted.submit(addCommand("AAPL", 4, 40.0, 1, OrderType::BUY)).get();
+    EXPECT_EQ(next.sequence, lastAaplSequence + 1);  // Numbering continues after the replayed tail.
+    restarted.stop();
+    std::filesystem::remove_all(dir);
+}
+
+// Test that a record torn by a crash mid-write is dropped, not replayed.
+TEST(JournalTest, IgnoresTornTail) {
+    std::filesystem::path dir = freshDirectory("orderbook_journal_torn");
+    JournalConfig config;
+    config.directory = dir.string();
+    {
+        MatchingEngine engine(1);
+        ASSERT_TRUE(engine.enableJournal(config));
+        engine.start();
+        CommandResult result = engine.submit(addCommand("AAPL", 1, 50.0, 100, OrderType::BUY)).get();
+        engine.waitDurable("AAPL", result.sequence);
+    }
+    std::filesystem::path file = dir / "journal-0-00000000000000000001.bin";
+    std::uintmax_t intact = std::filesystem::file_size(file);
+    {
+        std::ofstream out(file, std::ios::binary | std::ios::app);
+        out.write("\x01\x02\x03partial", 10);
+    }
+
+    MatchingEngine restarted(1);
+    ASSERT_TRUE(restarted.enableJournal(config));
+    EXPECT_EQ(std::filesystem::file_size(file), intact);
+    restarted.start();
+    EXPECT_EQ(restingOrders(restarted, "AAPL").size(), 1);
+    restarted.stop();
+    std::filesystem::remove_all(dir);
+}
+
+// Test that journals written with another shard layout are refused.
+TEST(JournalTest, RejectsDifferentShardCount) {
+    std::filesystem::path dir = freshDirectory("orderbook_journal_shards");
+    JournalConfig config;
+    config.directory = dir.string();
+    config.durability = Durability::NONE;
+    {
+        MatchingEngine engine(1);
+        ASSERT_TRUE(engine.enableJournal(config));
+    }
+    MatchingEngine resharded(1 + 1);
+    EXPECT_FALSE(resharded.enableJournal(config));
+    std::filesystem::remove_all(dir);
+}
+
+// Test that an order's time in force and flags are journaled, so an IOC
+// remainder that was dropped is not put back on the book by replay.
+TEST(JournalTest, ReplaysExecutionFlags) {
+    std::filesystem::path dir = freshDirectory("orderbook_journal_flags");
+    JournalConfig config;
+    config.directory = dir.string();
+    config.durability = Durability::SYNC;
+    {
+        MatchingEngine engine(1);
+        ASSERT_TRUE(engine.enableJournal(config));
+        engine.start();
+        engine.submit(addCommand("AAPL", 1, 50.0, 10, OrderType::SELL)).get();
+        EngineCommand ioc = addCommand("AAPL", 2, 50.0, 25, OrderType::BUY);
+        ioc.order.timeInForce = TimeInForce::IOC;
+        CommandResult result = engine.submit(ioc).get();
+        EXPECT_TRUE(result.accepted);
+        EXPECT_EQ(result.trades.size(), 1);
+        EngineCommand postOnly = addCommand("AAPL", 3, 49.0, 5, OrderType::BUY);
+        postOnly.order.flags = ORDER_POST_ONLY;
+        result = engine.submit(postOnly).get();
+        engine.waitDurable("AAPL", result.sequence);
+    }
+
+    MatchingEngine restarted(1);
+    ASSERT_TRUE(restarted.enableJournal(config));
+    restarted.start();
+    std::vector<std::pair<OrderId, int>> expected = { { 3, 5 } };
+    EXPECT_EQ(restingOrders(restarted, "AAPL"), expected);
+    restarted.stop();
+    std::filesystem::remove_all(dir);
+}
+
+// Test that modifies are journaled and replayed with the queue position
+// they left behind.
+TEST(JournalTest, ReplaysModifies) {
+    std::filesystem::path dir = freshDirectory("orderbook_journal_modify");
+    JournalConfig config;
+    config.directory = dir.string();
+    config.durability = Durability::SYNC;
+    {
+        MatchingEngine engine(1);
+        ASSERT_TRUE(engine.enableJournal(config));
+        engine.start();
+        engine.submit(addCommand("AAPL", 1, 50.0, 10, OrderType::BUY)).get();
+        engine.submit(addCommand("AAPL", 2, 50.0, 10, OrderType::BUY)).get();
+        EngineCommand modify;
+        modify.type = EngineCommand::Type::MODIFY;
+        modify.symbol = "AAPL";
+        modify.orderId = 1;
+        modify.order.price = 50.0;
+        modify.order.quantity = 15;
+        CommandResult result = engine.submit(modify).get();
+        EXPECT_TRUE(result.accepted);
+        EXPECT_EQ(result.sequence, 3);
+        engine.waitDurable("AAPL", result.sequence);
+    }
+
+    MatchingEngine restarted(1);
+    ASSERT_TRUE(restarted.enableJournal(config));
+    restarted.start();
+    std::vector<std::pair<OrderId, int>> expected = { { 2, 10 }, { 1, 15 } };
+    EXPECT_EQ(restingOrders(restarted, "AAPL"), expected);
+    restarted.stop();
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,91 @@
+#include "pch.h"
+#include "gtest/gtest.h"
+#include "../orderbook/json_writer.h"
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <string>
+
+namespace {
+
+// How crow::json::wvalue::dump() prints a double.
+std::string crowDouble(double number) {
+    if (std::isnan(number) || std::isinf(number)) {
+        return "null";
+    }
+    char buffer[128];
+    std::snprintf(buffer, sizeof(buffer), "%f", number);
+    std::string text = buffer;
+    std::size_t point = text.find('.');
+    std::size_t end = text.size();
+    while (end > point + 2 && text[end - 1] == '0') {
+        end--;
+    }
+    return text.substr(0, end);
+}
+
+std::string written(double number) {
+    std::string out;
+    JsonWriter(out).value(number);
+    return out;
+}
+
+} // namespace
+
+// Test that objects and arrays get their commas and nesting right.
+TEST(JsonWriterTest, WritesNestedStructures) {
+    std::string out;
+    JsonWriter json(out);
+    json.beginObject()
+        .field("type", "delta")
+        .field("sequence", std::uint64_t(18446744073709551615ULL))
+        .field("accepted", false)
+        .key("deltas").beginArray();
+    for (int i = 0; i < 2; i++) {
+        json.beginObject().field("orderID", -i).field("price", 100.5).endObject();
+    }
+    json.endArray()
+        .key("empty").beginArray().endArray()
+        .key("nested").beginObject().key("list").beginArray().value(1).value(2).endArray().endObject()
+        .endObject();
+    EXPECT_EQ(out, "{\"type\":\"delta\",\"sequence\":18446744073709551615,\"accepted\":false,"
+        "\"deltas\":[{\"orderID\":0,\"price\":100.5},{\"orderID\":-1,\"price\":100.5}],"
+        "\"empty\":[],\"nested\":{\"list\":[1,2]}}");
+}
+
+// Test that strings are escaped like crow escapes them.
+TEST(JsonWriterTest, EscapesStrings) {
+    std::string out;
+    JsonWriter(out).value(std::string_view("a\"b\\c\n\t\x01\x1f" "\xc3\xa9", 11));
+    EXPECT_EQ(out, "\"a\\\"b\\\\c\\n\\t\\u0001\\u001f\xc3\xa9\"");
+}
+
+// Test that doubles print exactly as crow's dump() printed them.
+TEST(JsonWriterTest, FormatsDoublesLikeCrow) {
+    for (double number : { 0.0, -0.0, 1.0, 100.5, 100.25, 0.1 + 0.2, 1.05, 99.85000000000001, 1e-7, 5e-7,
+             -5e-7, 0.0078125, -12.3456789, 123456789.123456, 8999999999.999999, 9.0e9, 1.0e20, 1.0e300,
+             std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN() }) {
+        EXPECT_EQ(written(number), crowDouble(number)) << number;
+    }
+    std::mt19937_64 random(7);
+    for (int i = 0; i < 200000; i++) {
+        // Tick prices, and arbitrary doubles across the fixed-point range.
+        double tick = static_cast<double>(random() % 10000000) * 0.01;
+        double any = std::ldexp(static_cast<double>(random() >> 11), -static_cast<int>(random() % 80));
+        ASSERT_EQ(written(tick), crowDouble(tick)) << tick;
+        ASSERT_EQ(written(any), crowDouble(any)) << any;
+    }
+}
+
+// Test that the thread's buffer is reused and handed back empty.
+TEST(JsonWriterTest, ThreadLocalBufferIsReused) {
+    JsonWriter first = JsonWriter::threadLocal();
+    first.beginArray().value(1).endArray();
+    const char* data = first.str().data();
+    EXPECT_EQ(first.str(), "[1]");
+    JsonWriter second = JsonWriter::threadLocal();
+    EXPECT_TRUE(second.str().empty());
+    second.value("x");
+    EXPECT_EQ(second.str().data(), data);
+}
@@ -0,0 +1,51 @@
+#include "pch.h"
+#include "gtest/gtest.h"
+#include "../orderbook/latency_histogram.h"
+
+// Test that small values are exact and percentiles walk the samples in order.
+TEST(LatencyHistogramTest, PercentilesOfExactRange) {
+    LatencyHistogram histogram;
+    for (std::uint64_t value = 1; value <= 100; value++) {
+        histogram.record(value);
+    }
+    EXPECT_EQ(histogram.count(), 100u);
+    EXPECT_EQ(histogram.min(), 1u);
+    EXPECT_EQ(histogram.max(), 100u);
+    EXPECT_DOUBLE_EQ(histogram.mean(), 50.5);
+    EXPECT_EQ(histogram.percentile(50.0), 50u);
+    EXPECT_EQ(histogram.percentile(99.0), 99u);
+    EXPECT_EQ(histogram.percentile(100.0), 100u);
+    EXPECT_EQ(histogram.countAtOrBelow(10), 10u);
+}
+
+// Test that large values keep their relative precision, the tail is not
+// rounded past the maximum, and merging adds the samples up.
+TEST(LatencyHistogramTest, LargeValuesAndMerge) {
+    LatencyHistogram fast;
+    LatencyHistogram slow;
+    for (int i = 0; i < 999; i++) {
+        fast.record(250);
+    }
+    slow.record(5000000);
+    fast.merge(slow);
+
+    EXPECT_EQ(fast.count(), 1000u);
+    EXPECT_EQ(fast.percentile(50.0), 251u);     // 250 shares a two-wide bucket.
+    EXPECT_EQ(fast.percentile(99.9), 251u);
+    EXPECT_EQ(fast.percentile(100.0), 5000000u);
+    EXPECT_EQ(fast.max(), 5000000u);
+
+    std::uint64_t big = 123456789012ULL;
+    LatencyHistogram one;
+    one.record(big);
+    std::uint64_t reported = one.percentile(50.0);
+    EXPECT_EQ(reported, big);                   // Clamped to the exact maximum.
+    one.record(big / 2);
+    reported = one.percentile(50.0);
+    EXPECT_GE(reported, big / 2);
+    EXPECT_LE(reported, big / 2 + big / 2 / 64);
+
+    one.reset();
+    EXPECT_EQ(one.count(), 0u);
+    EXPECT_EQ(one.percentile(99.0), 0u);
+}
@@ -0,0 +1,146 @@
+#include "pch.h"
+#include "gtest/gtest.h"
+#include "../orderbook/market_data_ring.h"
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+
+namespace {
+
+std::string ringName(const char* test) {
+    return "/orderbook-test-" + std::to_string(::getpid()) + "-" + test;
+}
+
+MarketDataRecord record(std::uint64_t n) {
+    MarketDataRecord out;
+    out.bookSequence = n;
+    out.timestamp = static_cast<std::int64_t>(n * 3);
+    out.price = 100.0 + static_cast<double>(n % 100) * 0.01;
+    out.quantity = static_cast<std::int64_t>(n * 7);
+    std::strcpy(out.symbol, "AAPL");
+    out.orderId = static_cast<std::int32_t>(n);
+    out.other = -static_cast<std::int32_t>(n);
+    out.type = n % 2 == 0 ? MarketDataType::TRADE : MarketDataType::LEVEL;
+    out.side = static_cast<std::uint8_t>(n % 2);
+    return out;
+}
+
+} // namespace
+
+// Test that a reader gets every record published after it opened, in order.
+TEST(MarketDataRingTest, ReaderFollowsProducer) {
+    std::string name = ringName("follow");
+    std::string error;
+    MarketDataRing ring;
+    ASSERT_TRUE(ring.create(name, 8, error)) << error;
+    ring.publish(record(100));
+
+    MarketDataReader reader;
+    ASSERT_TRUE(reader.open(name, error)) << error;
+    EXPECT_EQ(reader.capacity(), 8);
+    MarketDataRecord out;
+    std::uint64_t sequence = 0;
+    EXPECT_FALSE(reader.poll(out, sequence));
+
+    for (std::uint64_t n = 1; n <= 3; n++) {
+        ring.publish(record(n));
+    }
+    for (std::uint64_t n = 1; n <= 3; n++) {
+        MarketDataRecord expected = record(n);
+        ASSERT_TRUE(reader.poll(out, sequence));
+        EXPECT_EQ(sequence, n);
+        EXPECT_EQ(std::memcmp(&out, &expected, sizeof(out)), 0);
+    }
+    EXPECT_FALSE(reader.poll(out, sequence));
+
+    // Seeking back reads what is still held.
+    reader.seek(0);
+    ASSERT_TRUE(reader.poll(out, sequence));
+    EXPECT_EQ(out.bookSequence, 100);
+    EXPECT_EQ(reader.overruns(), 0);
+
+    EXPECT_FALSE(reader.closed());
+    ring.close();
+    EXPECT_TRUE(reader.closed());
+    EXPECT_FALSE(reader.open(name, error));
+}
+
+// Test that a reader lapped by the producer skips ahead and counts what it missed.
+TEST(MarketDataRingTest, DetectsOverruns) {
+    std::string name = ringName("overrun");
+    std::string error;
+    MarketDataRing ring;
+    ASSERT_TRUE(ring.create(name, 8, error)) << error;
+    MarketDataReader reader;
+    ASSERT_TRUE(reader.open(name, error)) << error;
+
+    for (std::uint64_t n = 0; n < 20; n++) {
+        ring.publish(record(n));
+    }
+    MarketDataRecord out;
+    std::uint64_t sequence = 0;
+    ASSERT_TRUE(reader.poll(out, sequence));
+    EXPECT_EQ(sequence, 12);
+    EXPECT_EQ(out.bookSequence, 12);
+    EXPECT_EQ(reader.overruns(), 12);
+    std::size_t count = 1;
+    while (reader.poll(out, sequence)) {
+        count++;
+    }
+    EXPECT_EQ(count, 8);
+    EXPECT_EQ(sequence, 19);
+}
+
+// Test that concurrent readers only ever see whole records.
+TEST(MarketDataRingTest, ReadersSeeWholeRecords) {
+    const std::uint64_t kRecords = 200000;
+    std::string name = ringName("whole");
+    std::string error;
+    MarketDataRing ring;
+    ASSERT_TRUE(ring.create(name, 64, error)) << error;
+
+    std::atomic<int> ready{ 0 };
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; r++) {
+        readers.emplace_back([&] {
+            MarketDataReader reader;
+            std::string openError;
+            ASSERT_TRUE(reader.open(name, openError)) << openError;
+            ready++;
+            MarketDataRecord out;
+            std::uint64_t sequence = 0;
+            std::uint64_t last = 0;
+            std::uint64_t read = 0;
+            while (last + 1 < kRecords) {
+                if (!reader.poll(out, sequence)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                MarketDataRecord expected = record(sequence);
+                ASSERT_EQ(std::memcmp(&out, &expected, sizeof(out)), 0);
+                if (read > 0) {
+                    EXPECT_GT(sequence, last);
+                }
+                last = sequence;
+                read++;
+            }
+            EXPECT_EQ(read + reader.overruns(), kRecords);
+        });
+    }
+    while (ready < 2) {
+        std::this_thread::yield();
+    }
+    for (std::uint64_t n = 0; n < kRecords; n++) {
+        ring.publish(record(n));
+    }
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+}
+
+#endif
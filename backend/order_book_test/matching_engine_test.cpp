@@ -0,0 +1,251 @@
+#include "pch.h"
+#include "gtest/gtest.h"
+#include "../orderbook/matching_engine.h"
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Test that commands for one symbol are applied in submission order.
+TEST(MatchingEngineTest, RoutesAndMatchesPerSymbol) {
+    MatchingEngine engine(2);
+    engine.start();
+
+    EngineCommand add;
+    add.type = EngineCommand::Type::ADD;
+    add.symbol = "AAPL";
+    add.order = Order(1, 50.0, 100, OrderType::BUY, "AAPL");
+    EXPECT_TRUE(engine.submit(add).get().accepted);
+
+    // Same order ID on another symbol lives in a different book.
+    add.symbol = "MSFT";
+    add.order = Order(1, 49.0, 100, OrderType::SELL, "MSFT");
+    CommandResult msft = engine.submit(add).get();
+    EXPECT_TRUE(msft.accepted);
+    EXPECT_TRUE(msft.trades.empty());
+
+    add.symbol = "AAPL";
+    add.order = Order(2, 49.0, 40, OrderType::SELL, "AAPL");
+    CommandResult aapl = engine.submit(add).get();
+    ASSERT_EQ(aapl.trades.size(), 1);
+    EXPECT_EQ(aapl.trades[0].buyOrderID, 1);
+    EXPECT_EQ(aapl.trades[0].quantity, 40);
+
+    EngineCommand cancel;
+    cancel.type = EngineCommand::Type::CANCEL;
+    cancel.symbol = "AAPL";
+    cancel.orderId = 1;
+    EXPECT_TRUE(engine.submit(cancel).get().accepted);
+    EXPECT_FALSE(engine.submit(cancel).get().accepted);
+
+    EXPECT_EQ(engine.query("AAPL", [](const OrderBook& book) { return book.size(); }).get(), 0);
+    EXPECT_EQ(engine.query("MSFT", [](const OrderBook& book) { return book.size(); }).get(), 1);
+    engine.stop();
+}
+
+// Test that concurrent producers on independent symbols all get applied.
+TEST(MatchingEngineTest, ConcurrentSymbols) {
+    const int kThreads = 4;
+    const int kOrdersPerThread = 5000;
+    MatchingEngine engine(kThreads);
+    engine.start();
+
+    std::vector<std::thread> producers;
+    for (int t = 0; t < kThreads; t++) {
+        producers.emplace_back([&engine, t] {
+            Symbol symbol(("SYM" + std::to_string(t)).c_str());
+            std::vector<std::future<CommandResult>> results;
+            for (int i = 0; i < kOrdersPerThread; i++) {
+                EngineCommand add;
+                add.type = EngineCommand::Type::ADD;
+                add.symbol = symbol;
+                add.order = Order(i + 1, 10.0 + (i % 10), 1, i % 2 ? OrderType::SELL : OrderType::BUY, symbol);
+                results.push_back(engine.submit(add));
+            }
+            for (auto& result : results) {
+                result.get();
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    for (int t = 0; t < kThreads; t++) {
+        Symbol symbol(("SYM" + std::to_string(t)).c_str());
+        std::size_t resting = engine.query(symbol, [](const OrderBook& book) { return book.size(); }).get();
+        // Identical flow per symbol gives identical books.
+        EXPECT_EQ(resting, engine.query("SYM0", [](const OrderBook& book) { return book.size(); }).get());
+    }
+    engine.stop();
+}
+
+// Test that the sequencer stamps commands from many producers gap-free, in
+// the order it applies them, and that a small ring applies backpressure
+// instead of dropping commands.
+TEST(MatchingEngineTest, SequencerStampsGapFree) {
+    const int kProducers = 4;
+    const int kOrdersPerProducer = 2000;
+    MatchingEngine engine(1, InstrumentConfig(), 64);
+    engine.start();
+
+    std::vector<std::uint64_t> applied;  // Only touched on the shard thread.
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; p++) {
+        producers.emplace_back([&engine, &applied, p] {
+            for (int i = 0; i < kOrdersPerProducer; i++) {
+                EngineCommand add;
+                add.type = EngineCommand::Type::ADD;
+                add.order = Order(p * kOrdersPerProducer + i + 1, 10.0 + (i % 7), 1,
+                    i % 2 ? OrderType::SELL : OrderType::BUY);
+                engine.submit(add, [&applied](const OrderBook&, CommandResult& result) {
+                    applied.push_back(result.sequence);
+                });
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    std::size_t total = engine.query(Symbol(), [&applied](const OrderBook&) { return applied.size(); }).get();
+    engine.stop();
+
+    ASSERT_EQ(total, kProducers * kOrdersPerProducer);
+    for (std::size_t i = 0; i < applied.size(); i++) {
+        EXPECT_EQ(applied[i], i + 1);
+    }
+}
+
+// Test that the update listener sees each book's changes once, in order,
+// with the book's own gap-free update sequence.
+TEST(MatchingEngineTest, ListenerSeesOrderedBookUpdates) {
+    MatchingEngine engine(2);
+    std::unordered_map<Symbol, std::vector<std::uint64_t>, SymbolHash> seen;
+    std::mutex seenMutex;
+    engine.setUpdateListener([&](const Symbol& symbol, const OrderBook& book, const CommandResult& result) {
+        std::lock_guard<std::mutex> lock(seenMutex);
+        EXPECT_EQ(result.bookSequence, book.updateSequence());
+        EXPECT_FALSE(result.deltas.empty());
+        seen[symbol].push_back(result.bookSequence);
+    });
+    engine.start();
+    for (int i = 1; i <= 50; i++) {
+        EngineCommand add;
+        add.type = EngineCommand::Type::ADD;
+        add.symbol = i % 2 ? "AAPL" : "MSFT";
+        add.order = Order(i, 10.0 + (i % 5), 1, i % 3 ? OrderType::BUY : OrderType::SELL);
+        engine.submit(add);
+    }
+    EngineCommand rejected;
+    rejected.type = EngineCommand::Type::CANCEL;
+    rejected.symbol = "AAPL";
+    rejected.orderId = 999;
+    engine.submit(rejected).get();
+    engine.query("MSFT", [](const OrderBook&) { return 0; }).get();
+    engine.stop();
+
+    for (const char* symbol : { "AAPL", "MSFT" }) {
+        const auto& sequences = seen[symbol];
+        ASSERT_EQ(sequences.size(), 25);
+        for (std::size_t i = 0; i < sequences.size(); i++) {
+            EXPECT_EQ(sequences[i], i + 1);
+        }
+    }
+}
+
+// Test that a batch is sequenced entry by entry and published once.
+TEST(MatchingEngineTest, BatchIsSequencedAndPublishedOnce) {
+    MatchingEngine engine(1);
+    int published = 0;  // Shard thread only.
+    engine.setUpdateListener([&published](const Symbol&, const OrderBook&, const CommandResult&) {
+        published++;
+    });
+    engine.start();
+
+    EngineCommand batch;
+    batch.type = EngineCommand::Type::BATCH;
+    batch.symbol = "AAPL";
+    batch.batch.resize(3);
+    batch.batch[0].order = Order(1, 10.0, 5, OrderType::SELL, "AAPL");
+    batch.batch[1].type = BookCommand::Type::CANCEL;
+    batch.batch[1].orderId = 42;   // Unknown: not sequenced.
+    batch.batch[2].order = Order(2, 10.0, 3, OrderType::BUY, "AAPL");
+    CommandResult result = engine.submit(batch).get();
+
+    ASSERT_TRUE(result.accepted);
+    ASSERT_EQ(result.batch.size(), 3);
+    EXPECT_EQ(result.batch[0].sequence, 1);
+    EXPECT_EQ(result.batch[1].sequence, 0);
+    EXPECT_EQ(result.batch[2].sequence, 2);
+    EXPECT_EQ(result.sequence, 2);
+    ASSERT_EQ(result.trades.size(), 1);
+    EXPECT_EQ(result.batch[2].firstTrade, 0);
+    EXPECT_EQ(result.batch[2].tradeCount, 1);
+    EXPECT_EQ(engine.query("AAPL", [&published](const OrderBook&) { return published; }).get(), 1);
+    engine.stop();
+}
+
+// Test that a mass cancel is published as one update and sequenced once per
+// order it removed.
+TEST(MatchingEngineTest, MassCancelIsPublishedOnce) {
+    MatchingEngine engine(1);
+    int published = 0;  // Shard thread only.
+    engine.setUpdateListener([&published](const Symbol&, const OrderBook&, const CommandResult&) {
+        published++;
+    });
+    engine.start();
+    for (OrderId id = 1; id <= 3; id++) {
+        EngineCommand add;
+        add.type = EngineCommand::Type::ADD;
+        add.symbol = "AAPL";
+        add.order = Order(id, 10.0 - id, 5, OrderType::BUY, "AAPL");
+        add.order.owner = id == 2 ? 9 : 4;
+        engine.submit(add).get();
+    }
+
+    EngineCommand cancel;
+    cancel.type = EngineCommand::Type::MASS_CANCEL;
+    cancel.symbol = "AAPL";
+    cancel.massCancel.owner = 4;
+    CommandResult result = engine.submit(cancel).get();
+
+    ASSERT_TRUE(result.accepted);
+    EXPECT_EQ(result.cancelled.size(), 2);
+    EXPECT_EQ(result.sequence, 5);
+    EXPECT_EQ(result.bookSequence, 4);
+    EXPECT_EQ(engine.query("AAPL", [](const OrderBook& book) { return book.size(); }).get(), 1);
+    EXPECT_EQ(engine.query("AAPL", [&published](const OrderBook&) { return published; }).get(), 4);
+    engine.stop();
+}
+
+// Test that a shard stops creating books for unconfigured symbols at its limit.
+TEST(MatchingEngineTest, BookLimitRejectsUnknownSymbols) {
+    MatchingEngine engine(1);
+    engine.configure("CONF", InstrumentConfig());
+    engine.setBookLimit(2);
+    engine.start();
+
+    // Queries never create a book.
+    EXPECT_EQ(engine.query("NONE", [](const OrderBook& book) { return book.size(); }).get(), 0);
+
+    EngineCommand add;
+    add.type = EngineCommand::Type::ADD;
+    const char* symbols[] = { "AAA", "BBB", "CCC" };
+    for (int i = 0; i < 3; i++) {
+        add.symbol = symbols[i];
+        add.order = Order(1, 50.0 + i, 10, OrderType::BUY, symbols[i]);
+        CommandResult result = engine.submit(add).get();
+        EXPECT_EQ(result.accepted, i < 2);
+        EXPECT_EQ(result.reject, i < 2 ? RejectReason::NONE : RejectReason::UNKNOWN_SYMBOL);
+    }
+
+    // Books that exist keep working, and configured symbols are not counted.
+    add.symbol = "AAA";
+    add.order = Order(2, 50.0, 10, OrderType::SELL, "AAA");
+    EXPECT_EQ(engine.submit(add).get().trades.size(), 1);
+    add.symbol = "CONF";
+    add.order = Order(1, 10.0, 10, OrderType::BUY, "CONF");
+    EXPECT_TRUE(engine.submit(add).get().accepted);
+    EXPECT_EQ(engine.query("CCC", [](const OrderBook& book) { return book.size(); }).get(), 0);
+    engine.stop();
+}
@@ -0,0 +1,34 @@
+#include "pch.h"
+#include "gtest/gtest.h"
+#include "../orderbook/metrics.h"
+#include <thread>
+
+// Test that samples recorded by a thread that has since exited still count,
+// alongside the calling thread's own, and that everything is rendered.
+TEST(MetricsTest, CollectsAcrossThreads) {
+    LatencyHistogram before;
+    Metrics::collect(MetricStage::SERIALIZE, before);
+    std::uint64_t rejectsBefore = Metrics::total(MetricCounter::REJECTS);
+
+    std::thread worker([] {
+        Metrics::record(MetricStage::SERIALIZE, 400);
+        Metrics::count(MetricCounter::REJECTS, 2);
+    });
+    worker.join();
+    Metrics::record(MetricStage::SERIALIZE, 600);
+    Metrics::count(MetricCounter::REJECTS);
+
+    LatencyHistogram after;
+    Metrics::collect(MetricStage::SERIALIZE, after);
+    EXPECT_EQ(after.count(), before.count() + 2);
+    EXPECT_EQ(after.sum(), before.sum() + 1000);
+    EXPECT_EQ(Metrics::total(MetricCounter::REJECTS), rejectsBefore + 3);
+
+    std::string text = Metrics::renderPrometheus({ { "orderbook_test_gauge", "A test gauge.", 7.0 } });
+    EXPECT_NE(text.find("# TYPE orderbook_stage_latency_seconds histogram"), std::string::npos);
+    EXPECT_NE(text.find("orderbook_stage_latency_seconds_count{stage=\"serialize\"} " + std::to_string(after.count())),
+        std::string::npos);
+    EXPECT_NE(text.find("orderbook_stage_latency_seconds_bucket{stage=\"serialize\",le=\"1e-06\"} "), std::string::npos);
+    EXPECT_NE(text.find("orderbook_rejects_total " + std::to_string(rejectsBefore + 3)), std::string::npos);
+    EXPECT_NE(text.find("orderbook_test_gauge 7\n"), std::string::npos);
+}
@@ -0,0 +1,120 @@
+#include "pch.h"
+#include "gtest/gtest.h"
+#include "../orderbook/order_index.h"
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Applies random inserts and erases to `index` and to a reference map, and
+// checks that every lookup agrees.
+void checkAgainstMap(OrderIndex& index, std::mt19937& rng, int idRange, int operations) {
+    std::unordered_map<int, SlotIndex> reference;
+    std::uniform_int_distribution<int> ids(0, idRange);
+    for (int i = 0; i < operations; i++) {
+        int id = ids(rng);
+        if (reference.count(id) != 0) {
+            ASSERT_TRUE(index.erase(id));
+            reference.erase(id);
+        }
+        else {
+            index.insert(id, static_cast<SlotIndex>(i));
+            reference.emplace(id, static_cast<SlotIndex>(i));
+        }
+        int probe = ids(rng);
+        auto it = reference.find(probe);
+        ASSERT_EQ(index.find(probe), it != reference.end() ? it->second : kInvalidSlot);
+        ASSERT_EQ(index.size(), reference.size());
+    }
+    for (const auto& entry : reference) {
+        ASSERT_EQ(index.find(entry.first), entry.second);
+    }
+}
+
+} // namespace
+
+// Test that the hashed layout behaves like a map for random and negative IDs,
+// through growth and backward-shift erasure.
+TEST(OrderIndexTest, HashedMatchesMap) {
+    std::mt19937 rng(7);
+    OrderIndex dense;
+    checkAgainstMap(dense, rng, 2000, 200000);
+    OrderIndex sparse(OrderIndex::Layout::HASHED, 1000);
+    checkAgainstMap(sparse, rng, 1000000, 200000);
+    OrderIndex negative;
+    negative.insert(-5, 1);
+    negative.insert(0, 2);
+    EXPECT_EQ(negative.find(-5), 1u);
+    EXPECT_FALSE(negative.erase(5));
+    EXPECT_TRUE(negative.erase(-5));
+    EXPECT_FALSE(negative.contains(-5));
+    EXPECT_EQ(negative.find(0), 2u);
+}
+
+// Test that the direct layout only spans the live IDs: a long stream of
+// increasing IDs with a bounded number alive keeps the table small.
+TEST(OrderIndexTest, DirectSlidesWithLiveIds) {
+    OrderIndex index(OrderIndex::Layout::DIRECT);
+    const int live = 1000;
+    for (int id = 1; id <= 1000000; id++) {
+        index.insert(id, static_cast<SlotIndex>(id));
+        if (id > live) {
+            ASSERT_TRUE(index.erase(id - live));
+        }
+    }
+    EXPECT_EQ(index.size(), static_cast<std::size_t>(live));
+    EXPECT_FALSE(index.contains(1000000 - live));
+    EXPECT_EQ(index.find(1000000 - live + 1), static_cast<SlotIndex>(1000000 - live + 1));
+    EXPECT_LT(index.memoryBytes(), 64 * live * sizeof(SlotIndex));
+    EXPECT_FALSE(index.erase(5));
+    EXPECT_EQ(index.find(2000000), kInvalidSlot);
+}
+
+// Test that one long-lived order does not pin the direct table while the
+// rest churn past it: the index falls back to hashing, stays small, and
+// returns to the direct layout once it empties.
+TEST(OrderIndexTest, DirectFallsBackUnderChurn) {
+    OrderIndex index(OrderIndex::Layout::DIRECT);
+    index.insert(1, 1);
+    const int live = 100;
+    for (int id = 2; id <= 1000000; id++) {
+        index.insert(id, static_cast<SlotIndex>(id));
+        if (id > live + 1) {
+            ASSERT_TRUE(index.erase(id - live));
+        }
+    }
+    EXPECT_EQ(index.layout(), OrderIndex::Layout::HASHED);
+    EXPECT_EQ(index.size(), static_cast<std::size_t>(live + 1));
+    EXPECT_EQ(index.find(1), 1u);
+    EXPECT_EQ(index.find(1000000), 1000000u);
+    EXPECT_FALSE(index.contains(1000000 - live));
+    EXPECT_LT(index.memoryBytes(), 64 * live * sizeof(SlotIndex));
+
+    for (int id = 1000000 - live + 1; id <= 1000000; id++) {
+        ASSERT_TRUE(index.erase(id));
+    }
+    ASSERT_TRUE(index.erase(1));
+    EXPECT_EQ(index.layout(), OrderIndex::Layout::DIRECT);
+    index.insert(1000001, 7);
+    EXPECT_EQ(index.find(1000001), 7u);
+}
+
+// Test that the direct layout accepts IDs out of order, as a snapshot
+// restores them level by level.
+TEST(OrderIndexTest, DirectAcceptsAnyOrder) {
+    std::mt19937 rng(11);
+    OrderIndex index(OrderIndex::Layout::DIRECT);
+    checkAgainstMap(index, rng, 5000, 100000);
+    std::vector<int> ids;
+    OrderIndex restored(OrderIndex::Layout::DIRECT);
+    for (int id = 900; id >= 100; id -= 7) {
+        restored.insert(id, static_cast<SlotIndex>(id * 2));
+        ids.push_back(id);
+    }
+    for (int id : ids) {
+        EXPECT_EQ(restored.find(id), static_cast<SlotIndex>(id * 2));
+    }
+    EXPECT_FALSE(restored.contains(901));
+    EXPECT_FALSE(restored.contains(99));
+}
@@ -0,0 +1,139 @@
+#include "pch.h"
+#include "gtest/gtest.h"
+#include "../orderbook/matching_engine.h"
+#include <filesystem>
+
+namespace {
+
+std::filesystem::path freshDirectory(const char* name) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    return dir;
+}
+
+EngineCommand addCommand(const Symbol& symbol, OrderId id, Price price, int quantity, OrderType side) {
+    EngineCommand command;
+    command.type = EngineCommand::Type::ADD;
+    command.symbol = symbol;
+    command.order = Order(id, price, quantity, side, symbol);
+    return command;
+}
+
+std::vector<std::tuple<OrderId, Price, int>> restingOrders(MatchingEngine& engine, const Symbol& symbol) {
+    return engine.query(symbol, [](const OrderBook& book) {
+        std::vector<std::tuple<OrderId, Price, int>> orders;
+        auto [bids, asks] = book.getRawOrderBookData();
+        for (const Order& order : bids) {
+            orders.emplace_back(order.orderID, order.price, order.quantity);
+        }
+        for (const Order& order : asks) {
+            orders.emplace_back(order.orderID, order.price, order.quantity);
+        }
+        return orders;
+    }).get();
+}
+
+std::size_t segmentCount(const std::filesystem::path& dir) {
+    std::size_t count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.path().filename().string().rfind("journal-", 0) == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+} // namespace
+
+// Test that a restart from a snapshot plus the journal written after it
+// restores the books, their FIFO order and the sequence numbering.
+TEST(SnapshotTest, RestoresSnapshotAndJournalTail) {
+    std::filesystem::path dir = freshDirectory("orderbook_snapshot_restore");
+    JournalConfig config;
+    config.directory = dir.string();
+    config.durability = Durability::SYNC;
+
+    std::vector<std::tuple<OrderId, Price, int>> before;
+    std::uint64_t lastSequence = 0;
+    {
+        MatchingEngine engine(1);
+        engine.configure("FINE", InstrumentConfig{ 0.5, 10.0, 20.0 });
+        ASSERT_TRUE(engine.enableJournal(config));
+        engine.start();
+        engine.submit(addCommand("AAPL", 1, 50.0, 100, OrderType::BUY)).get();
+        engine.submit(addCommand("AAPL", 2, 50.0, 40, OrderType::BUY)).get();
+        engine.submit(addCommand("AAPL", 3, 52.0, 25, OrderType::SELL)).get();
+        engine.submit(addCommand("FINE", 1, 12.5, 5, OrderType::SELL)).get();
+        ASSERT_TRUE(engine.snapshot());
+
+        // The tail: only in the journal segment started by the snapshot.
+        engine.submit(addCommand("AAPL", 4, 50.0, 70, OrderType::SELL)).get();
+        CommandResult last = engine.submit(addCommand("FINE", 2, 30.0, 5, OrderType::SELL)).get();
+        engine.waitDurable("AAPL", last.sequence);
+        lastSequence = last.sequence;
+        before = restingOrders(engine, "AAPL");
+    }
+    EXPECT_TRUE(std::filesystem::exists(dir / "snapshot-0.bin"));
+
+    MatchingEngine restarted(1);
+    ASSERT_TRUE(restarted.enableJournal(config));
+    EXPECT_EQ(segmentCount(dir), 1);  // Segments covered by the snapshot are gone.
+    restarted.start();
+    EXPECT_EQ(restingOrders(restarted, "AAPL"), before);
+    // The book keeps the grid it was snapshotted with: 30.0 lands in overflow.
+    std::vector<std::tuple<OrderId, Price, int>> fine = { { 1, 12.5, 5 }, { 2, 30.0, 5 } };
+    EXPECT_EQ(restingOrders(restarted, "FINE"), fine);
+    EXPECT_EQ(restarted.submit(addCommand("AAPL", 5, 40.0, 1, OrderType::BUY)).get().sequence, lastSequence + 1);
+    restarted.stop();
+    std::filesystem::remove_all(dir);
+}
+
+// Test that a restart relies on the snapshot instead of the journal before it.
+TEST(SnapshotTest, SkipsJournalCoveredBySnapshot) {
+    std::filesystem::path dir = freshDirectory("orderbook_snapshot_skip");
+    JournalConfig config;
+    config.directory = dir.string();
+    {
+        MatchingEngine engine(1);
+        ASSERT_TRUE(engine.enableJournal(config));
+        engine.start();
+        engine.submit(addCommand("AAPL", 1, 50.0, 100, OrderType::BUY)).get();
+        engine.stop();
+        ASSERT_TRUE(engine.snapshot());  // Also works while stopped.
+    }
+    // Without any journal left, the books can only come from the snapshot.
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.path().filename().string().rfind("journal-", 0) == 0) {
+            std::filesystem::remove(entry.path());
+        }
+    }
+
+    MatchingEngine restarted(1);
+    ASSERT_TRUE(restarted.enableJournal(config));
+    restarted.start();
+    EXPECT_EQ(restingOrders(restarted, "AAPL").size(), 1);
+    EXPECT_EQ(restarted.submit(addCommand("AAPL", 2, 40.0, 1, OrderType::BUY)).get().sequence, 2);
+    restarted.stop();
+    std::filesystem::remove_all(dir);
+}
+
+// Test that a damaged snapshot is refused rather than half-loaded.
+TEST(SnapshotTest, RejectsCorruptSnapshot) {
+    std::filesystem::path dir = freshDirectory("orderbook_snapshot_corrupt");
+    JournalConfig config;
+    config.directory = dir.string();
+    {
+        MatchingEngine engine(1);
+        ASSERT_TRUE(engine.enableJournal(config));
+        engine.submit(addCommand("AAPL", 1, 50.0, 100, OrderType::BUY));
+        engine.start();
+        engine.stop();
+        ASSERT_TRUE(engine.snapshot());
+    }
+    std::filesystem::path image = dir / "snapshot-0.bin";
+    std::filesystem::resize_file(image, std::filesystem::file_size(image) - 1);
+
+    MatchingEngine restarted(1);
+    EXPECT_FALSE(restarted.enableJournal(config));
+    std::filesystem::remove_all(dir);
+}
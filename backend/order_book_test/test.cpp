@@ -1,8 +1,10 @@
 #include "pch.h"
 #include "gtest/gtest.h"
 #include "../orderbook/order_book.h"
+#include <algorithm>
 #include <chrono>
 #include <iostream>
+#include <limits>
 #include <memory>  // For std::shared_ptr
 
 // Test that an order with no match remains in the order book.
@@ -113,3 +115,675 @@ TEST(OrderBookTest, LargeVolumeTest) {
 
     EXPECT_TRUE(true);  // The test should pass as long as execution completes.
 }
+
+// Test that orders at the same price are filled oldest first.
+TEST(OrderBookTest, FifoWithinPriceLevel) {
+    OrderBook ob;
+    ob.addOrder(Order(1, 50.0, 10, OrderType::BUY));
+    ob.addOrder(Order(2, 50.0, 10, OrderType::BUY));
+    ob.addOrder(Order(3, 50.0, 10, OrderType::BUY));
+
+    std::vector<Trade> trades = ob.addOrder(Order(4, 50.0, 15, OrderType::SELL));
+
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].buyOrderID, 1);
+    EXPECT_EQ(trades[0].quantity, 10);
+    EXPECT_EQ(trades[1].buyOrderID, 2);
+    EXPECT_EQ(trades[1].quantity, 5);
+    EXPECT_EQ(ob.size(), 2);
+}
+
+// Test that cancelling from the middle of a level keeps the FIFO intact.
+TEST(OrderBookTest, CancelFromMiddleOfLevel) {
+    OrderBook ob;
+    ob.addOrder(Order(1, 50.0, 10, OrderType::BUY));
+    ob.addOrder(Order(2, 50.0, 10, OrderType::BUY));
+    ob.addOrder(Order(3, 50.0, 10, OrderType::BUY));
+
+    EXPECT_TRUE(ob.cancelOrder(2));
+
+    std::vector<Trade> trades = ob.addOrder(Order(4, 50.0, 30, OrderType::SELL));
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].buyOrderID, 1);
+    EXPECT_EQ(trades[1].buyOrderID, 3);
+    EXPECT_EQ(ob.size(), 1);  // The rest of the sell order.
+}
+
+// Test that add/cancel/fill cycles reuse pooled slots instead of growing.
+TEST(OrderBookTest, PooledSlotsAreReused) {
+    OrderBook ob(InstrumentConfig(), 128);
+    for (int round = 0; round < 1000; round++) {
+        int base = round * 200;
+        for (int i = 0; i < 100; i++) {
+            ob.addOrder(Order(base + i, 50.0 - (i % 5) * 0.01, 10, OrderType::BUY));
+        }
+        for (int i = 0; i < 50; i++) {
+            ob.cancelOrder(base + i);
+        }
+        ob.addOrder(Order(base + 100, 49.0, 500, OrderType::SELL));
+    }
+    EXPECT_EQ(ob.size(), 0);
+    EXPECT_EQ(ob.poolCapacity(), 128);
+}
+
+// Test that prices differing only by float error land on the same level.
+TEST(OrderBookTest, PricesSnapToTicks) {
+    OrderBook ob;
+    ob.addOrder(Order(1, 0.1 + 0.2, 10, OrderType::BUY));  // 0.30000000000000004
+    ob.addOrder(Order(2, 0.3, 10, OrderType::BUY));
+
+    auto [bids, asks] = ob.getRawOrderBookData();
+    ASSERT_EQ(bids.size(), 2);
+    EXPECT_EQ(bids[0].price, bids[1].price);
+
+    std::vector<Trade> trades = ob.addOrder(Order(3, 0.3, 20, OrderType::SELL));
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].buyOrderID, 1);  // Time priority holds across the snapped prices.
+    EXPECT_EQ(trades[1].buyOrderID, 2);
+}
+
+// Test that the best level is tracked as levels empty out, including
+// levels outside the configured price band.
+TEST(OrderBookTest, LadderWithOverflowLevels) {
+    InstrumentConfig config;
+    config.tickSize = 0.5;
+    config.minPrice = 10.0;
+    config.maxPrice = 20.0;
+    OrderBook ob(config);
+
+    ob.addOrder(Order(1, 25.0, 10, OrderType::SELL));   // Above the band.
+    ob.addOrder(Order(2, 15.0, 10, OrderType::SELL));
+    ob.addOrder(Order(3, 5.0, 10, OrderType::BUY));     // Below the band.
+    ob.addOrder(Order(4, 12.0, 10, OrderType::BUY));
+    ob.addOrder(Order(5, 30.0, 30, OrderType::BUY));    // Crosses both asks.
+
+    auto [bids, asks] = ob.getRawOrderBookData();
+    ASSERT_EQ(bids.size(), 3);
+    EXPECT_EQ(bids[0].orderID, 5);  // Remaining 30.0 bid is best, then 12.0, then 5.0.
+    EXPECT_EQ(bids[0].quantity, 10);
+    EXPECT_EQ(bids[1].orderID, 4);
+    EXPECT_EQ(bids[2].orderID, 3);
+    EXPECT_TRUE(asks.empty());
+
+    std::vector<Trade> trades = ob.addOrder(Order(6, 1.0, 25, OrderType::SELL));
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[0].buyOrderID, 5);
+    EXPECT_EQ(trades[1].buyOrderID, 4);
+    EXPECT_EQ(trades[2].buyOrderID, 3);
+    EXPECT_EQ(trades[2].quantity, 5);
+}
+
+// Test that the bitmap finds the next level across distant words.
+TEST(OrderBookTest, SparseLadderSweep) {
+    OrderBook ob;
+    const double prices[] = { 999.99, 500.0, 0.65, 0.01 };
+    for (int i = 0; i < 4; i++) {
+        ob.addOrder(Order(i + 1, prices[i], 1, OrderType::BUY));
+    }
+    std::vector<Trade> trades = ob.addOrder(Order(10, 0.01, 4, OrderType::SELL));
+    ASSERT_EQ(trades.size(), 4);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(trades[i].buyOrderID, i + 1);
+    }
+    EXPECT_EQ(ob.size(), 0);
+}
+
+// Test that the delta feed reports every change, L3 and L2, in order.
+TEST(OrderBookTest, DeltasDescribeEveryChange) {
+    OrderBook ob;
+    std::vector<BookDelta> deltas;
+    ob.setDeltaSink(&deltas);
+
+    ob.addOrder(Order(1, 100.0, 10, OrderType::SELL));
+    ob.addOrder(Order(2, 100.0, 5, OrderType::SELL));
+    ASSERT_EQ(deltas.size(), 4);
+    EXPECT_EQ(deltas[0].type, BookDelta::Type::ORDER_ADDED);
+    EXPECT_EQ(deltas[0].orderId, 1);
+    EXPECT_EQ(deltas[3].type, BookDelta::Type::LEVEL);
+    EXPECT_EQ(deltas[3].quantity, 15);
+    EXPECT_EQ(deltas[3].orderCount, 2);
+
+    deltas.clear();
+    ob.addOrder(Order(3, 101.0, 12, OrderType::BUY));  // Fills 1, takes 2 from order 2.
+    ASSERT_EQ(deltas.size(), 3);
+    EXPECT_EQ(deltas[0].type, BookDelta::Type::ORDER_EXECUTED);
+    EXPECT_EQ(deltas[0].orderId, 1);
+    EXPECT_EQ(deltas[0].quantity, 10);
+    EXPECT_EQ(deltas[0].remaining, 0);
+    EXPECT_EQ(deltas[1].orderId, 2);
+    EXPECT_EQ(deltas[1].remaining, 3);
+    EXPECT_EQ(deltas[2].type, BookDelta::Type::LEVEL);
+    EXPECT_EQ(deltas[2].side, OrderType::SELL);
+    EXPECT_EQ(deltas[2].quantity, 3);
+    EXPECT_EQ(deltas[2].orderCount, 1);
+
+    deltas.clear();
+    ob.cancelOrder(2);
+    ASSERT_EQ(deltas.size(), 2);
+    EXPECT_EQ(deltas[0].type, BookDelta::Type::ORDER_REMOVED);
+    EXPECT_EQ(deltas[0].quantity, 3);
+    EXPECT_EQ(deltas[1].quantity, 0);  // Level gone.
+    EXPECT_EQ(ob.updateSequence(), 4);
+}
+
+// Test that depth aggregates each level and stops at the requested count.
+TEST(OrderBookTest, DepthAggregatesLevels) {
+    OrderBook ob;
+    ob.addOrder(Order(1, 99.0, 10, OrderType::BUY));
+    ob.addOrder(Order(2, 99.0, 15, OrderType::BUY));
+    ob.addOrder(Order(3, 98.0, 5, OrderType::BUY));
+    ob.addOrder(Order(4, 97.0, 1, OrderType::BUY));
+    ob.addOrder(Order(5, 101.0, 7, OrderType::SELL));
+    ob.addOrder(Order(6, 100.0, 3, OrderType::BUY));   // Rests: no ask at or below 100.
+    ob.addOrder(Order(7, 100.0, 2, OrderType::SELL));  // Takes 2 of order 6.
+
+    BookDepth depth = ob.getDepth(2);
+    ASSERT_EQ(depth.bids.size(), 2);
+    EXPECT_DOUBLE_EQ(depth.bids[0].price, 100.0);
+    EXPECT_EQ(depth.bids[0].quantity, 1);
+    EXPECT_EQ(depth.bids[0].orderCount, 1);
+    EXPECT_DOUBLE_EQ(depth.bids[1].price, 99.0);
+    EXPECT_EQ(depth.bids[1].quantity, 25);
+    EXPECT_EQ(depth.bids[1].orderCount, 2);
+    ASSERT_EQ(depth.asks.size(), 1);
+    EXPECT_EQ(depth.asks[0].quantity, 7);
+    EXPECT_EQ(depth.sequence, ob.updateSequence());
+
+    ob.cancelOrder(2);
+    EXPECT_EQ(ob.getDepth(10).bids[1].quantity, 10);
+    EXPECT_EQ(ob.getDepth(10).bids.size(), 4);
+}
+
+// Test that a batch applies in order, reports per-command results and
+// counts as a single book update.
+TEST(OrderBookTest, ApplyBatchInOrder) {
+    OrderBook ob;
+    ob.addOrder(Order(1, 100.0, 10, OrderType::SELL));
+    std::uint64_t before = ob.updateSequence();
+
+    std::vector<BookCommand> batch(4);
+    batch[0].order = Order(2, 100.0, 12, OrderType::BUY);  // Takes all of 1, rests 2.
+    batch[1].order = Order(2, 99.0, 1, OrderType::BUY);    // Duplicate ID: rejected.
+    batch[2].type = BookCommand::Type::CANCEL;
+    batch[2].orderId = 2;
+    batch[3].order = Order(3, 100.0, 5, OrderType::BUY);   // Rests: the ask is gone.
+
+    std::vector<BookCommandResult> results;
+    std::vector<Trade> trades;
+    std::vector<BookDelta> deltas;
+    ob.setDeltaSink(&deltas);
+    EXPECT_TRUE(ob.applyBatch(batch, results, trades));
+    ASSERT_EQ(results.size(), 4);
+    EXPECT_TRUE(results[0].accepted);
+    EXPECT_EQ(results[0].tradeCount, 1);
+    EXPECT_FALSE(results[1].accepted);
+    EXPECT_TRUE(results[2].accepted);
+    EXPECT_TRUE(results[3].accepted);
+    EXPECT_EQ(results[3].tradeCount, 0);
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].quantity, 10);
+
+    EXPECT_EQ(ob.updateSequence(), before + 1);
+    EXPECT_FALSE(deltas.empty());
+    EXPECT_FALSE(ob.hasOrder(2));
+    EXPECT_TRUE(ob.hasOrder(3));
+}
+
+namespace {
+
+Order withExecution(Order order, TimeInForce timeInForce, std::uint8_t flags = 0) {
+    order.timeInForce = timeInForce;
+    order.flags = flags;
+    return order;
+}
+
+} // namespace
+
+// Test that IOC and market orders take what they can and never rest.
+TEST(OrderBookTest, IocAndMarketOrdersNeverRest) {
+    OrderBook ob;
+    ob.addOrder(Order(1, 100.0, 5, OrderType::SELL));
+    ob.addOrder(Order(2, 101.0, 5, OrderType::SELL));
+    ob.addOrder(Order(3, 98.0, 4, OrderType::BUY));
+
+    std::vector<Trade> trades;
+    EXPECT_TRUE(ob.addOrder(withExecution(Order(10, 100.0, 8, OrderType::BUY), TimeInForce::IOC), trades));
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].quantity, 5);
+    EXPECT_FALSE(ob.hasOrder(10));              // The other 3 are dropped.
+
+    trades.clear();
+    EXPECT_TRUE(ob.addOrder(withExecution(Order(11, 0.0, 20, OrderType::BUY), TimeInForce::GTC, ORDER_MARKET), trades));
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_DOUBLE_EQ(trades[0].tradePrice, 101.0);
+    EXPECT_FALSE(ob.hasOrder(11));
+
+    // A market sell prints at the bid it hits, not at its own (absent) price.
+    trades.clear();
+    EXPECT_TRUE(ob.addOrder(withExecution(Order(12, 0.0, 1, OrderType::SELL), TimeInForce::IOC, ORDER_MARKET), trades));
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_DOUBLE_EQ(trades[0].tradePrice, 98.0);
+    EXPECT_EQ(ob.size(), 1);
+}
+
+// Test that FOK fills in full or leaves the book untouched, judged from the
+// level totals within its limit.
+TEST(OrderBookTest, FillOrKill) {
+    OrderBook ob;
+    ob.addOrder(Order(1, 100.0, 5, OrderType::SELL));
+    ob.addOrder(Order(2, 100.0, 5, OrderType::SELL));
+    ob.addOrder(Order(3, 102.0, 10, OrderType::SELL));
+    std::uint64_t sequence = ob.updateSequence();
+
+    std::vector<Trade> trades;
+    RejectReason reason = RejectReason::NONE;
+    EXPECT_FALSE(ob.addOrder(withExecution(Order(10, 101.0, 11, OrderType::BUY), TimeInForce::FOK), trades, &reason));
+    EXPECT_EQ(reason, RejectReason::NOT_FILLABLE);
+    EXPECT_TRUE(trades.empty());
+    EXPECT_EQ(ob.size(), 3);
+    EXPECT_EQ(ob.updateSequence(), sequence);
+
+    EXPECT_TRUE(ob.addOrder(withExecution(Order(11, 102.0, 11, OrderType::BUY), TimeInForce::FOK), trades));
+    EXPECT_EQ(trades.size(), 3);
+    EXPECT_EQ(ob.getDepth(1).asks[0].quantity, 9);
+}
+
+// Test that post-only orders rest when passive and are refused when they
+// would trade, and that contradictory flags are refused.
+TEST(OrderBookTest, PostOnly) {
+    OrderBook ob;
+    ob.addOrder(Order(1, 100.0, 5, OrderType::SELL));
+
+    std::vector<Trade> trades;
+    RejectReason reason = RejectReason::NONE;
+    EXPECT_FALSE(ob.addOrder(withExecution(Order(2, 100.0, 5, OrderType::BUY), TimeInForce::GTC, ORDER_POST_ONLY), trades, &reason));
+    EXPECT_EQ(reason, RejectReason::WOULD_CROSS);
+    EXPECT_TRUE(ob.addOrder(withExecution(Order(3, 99.99, 5, OrderType::BUY), TimeInForce::GTC, ORDER_POST_ONLY), trades));
+    EXPECT_TRUE(ob.hasOrder(3));
+    EXPECT_FALSE(ob.addOrder(withExecution(Order(4, 99.0, 5, OrderType::BUY), TimeInForce::IOC, ORDER_POST_ONLY), trades, &reason));
+    EXPECT_EQ(reason, RejectReason::INVALID_ORDER);
+    EXPECT_TRUE(trades.empty());
+}
+
+// Test that a smaller quantity at the same price keeps the order's place in
+// the queue and is reported as one in-place change.
+TEST(OrderBookTest, ModifySizeDownKeepsPriority) {
+    OrderBook ob;
+    ob.addOrder(Order(1, 100.0, 10, OrderType::SELL));
+    ob.addOrder(Order(2, 100.0, 10, OrderType::SELL));
+    std::vector<BookDelta> deltas;
+    ob.setDeltaSink(&deltas);
+    std::vector<Trade> trades;
+    EXPECT_TRUE(ob.modifyOrder(1, 100.0, 4, trades));
+    EXPECT_TRUE(trades.empty());
+    ASSERT_EQ(deltas.size(), 2);
+    EXPECT_EQ(deltas[0].type, BookDelta::Type::ORDER_MODIFIED);
+    EXPECT_EQ(deltas[0].quantity, 4);
+    EXPECT_EQ(deltas[1].type, BookDelta::Type::LEVEL);
+    EXPECT_EQ(deltas[1].quantity, 14);
+    EXPECT_EQ(ob.updateSequence(), 3);
+
+    ob.addOrder(Order(3, 100.0, 5, OrderType::BUY), trades);
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].sellOrderID, 1);    // Still first in line.
+    EXPECT_EQ(trades[0].quantity, 4);
+    EXPECT_EQ(trades[1].sellOrderID, 2);
+    EXPECT_EQ(trades[1].quantity, 1);
+}
+
+// Test that a size-up or a new price sends the order to the back of its
+// level, and that a new price moves it between levels in one update.
+TEST(OrderBookTest, ModifyLosesPriorityOnSizeUpOrReprice) {
+    OrderBook ob;
+    ob.addOrder(Order(1, 99.0, 10, OrderType::BUY));
+    ob.addOrder(Order(2, 99.0, 10, OrderType::BUY));
+    ob.addOrder(Order(3, 98.0, 10, OrderType::BUY));
+    std::vector<Trade> trades;
+    EXPECT_TRUE(ob.modifyOrder(1, 99.0, 12, trades));
+    auto bids = ob.getRawOrderBookData().first;
+    ASSERT_EQ(bids.size(), 3);
+    EXPECT_EQ(bids[0].orderID, 2);
+    EXPECT_EQ(bids[1].orderID, 1);
+    EXPECT_EQ(bids[1].quantity, 12);
+
+    std::vector<BookDelta> deltas;
+    ob.setDeltaSink(&deltas);
+    std::uint64_t before = ob.updateSequence();
+    EXPECT_TRUE(ob.modifyOrder(2, 98.0, 10, trades));
+    EXPECT_EQ(ob.updateSequence(), before + 1);
+    ASSERT_EQ(deltas.size(), 3);
+    EXPECT_EQ(deltas[0].type, BookDelta::Type::LEVEL);     // 99 loses the order.
+    EXPECT_EQ(deltas[0].quantity, 12);
+    EXPECT_EQ(deltas[1].type, BookDelta::Type::ORDER_MODIFIED);
+    EXPECT_DOUBLE_EQ(deltas[1].price, 98.0);
+    EXPECT_EQ(deltas[2].quantity, 20);                    // 98 gains it.
+    bids = ob.getRawOrderBookData().first;
+    ASSERT_EQ(bids.size(), 3);
+    EXPECT_EQ(bids[1].orderID, 3);
+    EXPECT_EQ(bids[2].orderID, 2);
+    EXPECT_EQ(ob.size(), 3);
+}
+
+// Test that a new price that crosses trades like an incoming order, and the
+// refusals that leave the order untouched.
+TEST(OrderBookTest, ModifyAcrossTheSpread) {
+    OrderBook ob;
+    ob.addOrder(Order(1, 101.0, 5, OrderType::SELL));
+    ob.addOrder(Order(2, 99.0, 8, OrderType::BUY));
+    std::vector<Trade> trades;
+    EXPECT_TRUE(ob.modifyOrder(2, 101.0, 8, trades));
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].buyOrderID, 2);
+    EXPECT_EQ(trades[0].quantity, 5);
+    auto book = ob.getRawOrderBookData();
+    ASSERT_EQ(book.first.size(), 1);
+    EXPECT_EQ(book.first[0].quantity, 3);
+    EXPECT_DOUBLE_EQ(book.first[0].price, 101.0);
+    EXPECT_TRUE(book.second.empty());
+
+    // Filled in full on the way: the order leaves the book.
+    trades.clear();
+    ob.addOrder(Order(3, 103.0, 3, OrderType::SELL));
+    EXPECT_TRUE(ob.modifyOrder(2, 103.0, 3, trades));
+    EXPECT_EQ(trades.size(), 1);
+    EXPECT_FALSE(ob.hasOrder(2));
+
+    RejectReason reason = RejectReason::NONE;
+    EXPECT_FALSE(ob.modifyOrder(2, 100.0, 1, trades, &reason));
+    EXPECT_EQ(reason, RejectReason::UNKNOWN_ORDER);
+    ob.addOrder(Order(4, 99.0, 5, OrderType::BUY));
+    EXPECT_FALSE(ob.modifyOrder(4, 99.0, 0, trades, &reason));
+    EXPECT_EQ(reason, RejectReason::INVALID_ORDER);
+
+    Order postOnly(5, 110.0, 5, OrderType::SELL);
+    postOnly.flags = ORDER_POST_ONLY;
+    ob.addOrder(postOnly);
+    std::uint64_t before = ob.updateSequence();
+    EXPECT_FALSE(ob.modifyOrder(5, 99.0, 5, trades, &reason));
+    EXPECT_EQ(reason, RejectReason::WOULD_CROSS);
+    EXPECT_EQ(ob.updateSequence(), before);
+    EXPECT_DOUBLE_EQ(ob.getRawOrderBookData().second[0].price, 110.0);
+}
+
+namespace {
+
+Order stopOrder(OrderId id, Price price, int quantity, OrderType side, Price stopPrice, std::uint8_t flags = 0) {
+    Order order(id, price, quantity, side);
+    order.flags = static_cast<std::uint8_t>(flags | ORDER_STOP);
+    order.stopPrice = stopPrice;
+    return order;
+}
+
+} // namespace
+
+// Test that a stop stays off the book until a later trade reaches its
+// trigger, then enters as the order it carries.
+TEST(OrderBookTest, StopOrdersWaitForTrigger) {
+    OrderBook ob;
+    ob.addOrder(Order(1, 99.0, 5, OrderType::BUY));
+    ob.addOrder(Order(2, 98.0, 5, OrderType::BUY));
+    std::vector<Trade> trades;
+    EXPECT_TRUE(ob.addOrder(stopOrder(10, 0.0, 4, OrderType::SELL, 98.0, ORDER_MARKET), trades));
+    EXPECT_TRUE(ob.addOrder(stopOrder(11, 101.0, 3, OrderType::BUY, 100.0), trades));
+    EXPECT_TRUE(trades.empty());
+    EXPECT_EQ(ob.size(), 2);
+    EXPECT_EQ(ob.stopCount(), 2);
+    EXPECT_FALSE(ob.hasOrder(10));
+    EXPECT_FALSE(ob.addOrder(Order(10, 50.0, 1, OrderType::BUY), trades));  // ID taken by the stop.
+
+    ob.addOrder(Order(3, 99.0, 2, OrderType::SELL), trades);   // Prints at 99: above the sell trigger.
+    EXPECT_EQ(trades.size(), 1);
+    EXPECT_EQ(ob.stopCount(), 2);
+
+    trades.clear();
+    ob.addOrder(Order(4, 98.0, 4, OrderType::SELL), trades);   // 3 at 99, 1 at 98: fires the stop.
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[2].sellOrderID, 10);
+    EXPECT_EQ(trades[2].buyOrderID, 2);
+    EXPECT_EQ(trades[2].quantity, 4);
+    EXPECT_DOUBLE_EQ(trades[2].tradePrice, 98.0);
+    EXPECT_EQ(ob.stopCount(), 1);
+    EXPECT_FALSE(ob.hasOrder(10));   // A stop-market never rests.
+
+    EXPECT_TRUE(ob.cancelOrder(11));
+    EXPECT_EQ(ob.stopCount(), 0);
+    EXPECT_FALSE(ob.cancelOrder(11));
+}
+
+// Test that stops firing stops run as a loop, in a fixed order, however
+// long the chain: each market sell stop knocks out one bid, whose trade
+// price fires the next stop down.
+TEST(OrderBookTest, StopCascadeIsOrderedAndIterative) {
+    constexpr int kChain = 20000;
+    OrderBook ob;
+    for (int i = 1; i <= kChain; i++) {
+        ob.addOrder(Order(i, 500.0 - 0.01 * i, 1, OrderType::BUY));
+        ob.addOrder(stopOrder(kChain + i, 0.0, 1, OrderType::SELL, 500.0 - 0.01 * i, ORDER_MARKET));
+    }
+    // Two stops on one trigger price fire oldest first.
+    ob.addOrder(Order(3 * kChain, 600.0, 1, OrderType::SELL));
+    ob.addOrder(stopOrder(3 * kChain + 1, 600.0, 1, OrderType::BUY, 600.0));
+    ob.addOrder(stopOrder(3 * kChain + 2, 600.0, 1, OrderType::BUY, 600.0));
+
+    std::uint64_t before = ob.updateSequence();
+    std::vector<Trade> trades;
+    ob.addOrder(Order(3 * kChain + 3, 499.99, 1, OrderType::SELL), trades);
+    EXPECT_EQ(ob.updateSequence(), before + 1);
+    ASSERT_EQ(trades.size(), static_cast<std::size_t>(kChain));
+    for (int i = 0; i < kChain; i++) {
+        EXPECT_EQ(trades[i].buyOrderID, i + 1);
+        EXPECT_EQ(trades[i].sellOrderID, i == 0 ? 3 * kChain + 3 : kChain + i);
+    }
+    EXPECT_EQ(ob.size(), 1);    // Only the 600 ask is left; the last stop found no bid.
+    EXPECT_EQ(ob.stopCount(), 2);
+
+    trades.clear();
+    ob.addOrder(Order(3 * kChain + 4, 600.0, 1, OrderType::BUY), trades);
+    ASSERT_EQ(trades.size(), 1);
+    auto bids = ob.getRawOrderBookData().first;
+    ASSERT_EQ(bids.size(), 2);
+    EXPECT_EQ(bids[0].orderID, 3 * kChain + 1);
+    EXPECT_EQ(bids[1].orderID, 3 * kChain + 2);
+}
+
+// Test that dormant stops survive a snapshot round trip.
+TEST(OrderBookTest, SnapshotKeepsStops) {
+    OrderBook ob;
+    ob.addOrder(Order(1, 99.0, 5, OrderType::BUY));
+    ob.addOrder(stopOrder(2, 97.5, 4, OrderType::SELL, 98.0, 0));
+    std::vector<char> image;
+    SnapshotWriter out(image);
+    ob.saveSnapshot(out);
+
+    OrderBook restored;
+    SnapshotReader in(image.data(), image.size());
+    ASSERT_TRUE(restored.loadSnapshot(in, Symbol()));
+    EXPECT_EQ(restored.size(), 1);
+    EXPECT_EQ(restored.stopCount(), 1);
+    std::vector<Trade> trades;
+    restored.addOrder(Order(3, 98.0, 5, OrderType::SELL), trades);
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(restored.size(), 1);     // The fired stop-limit rests at 97.5.
+    EXPECT_DOUBLE_EQ(restored.getRawOrderBookData().second[0].price, 97.5);
+}
+
+// Test that prices with no representable tick are refused on add, stop and
+// modify without touching the book, and that mass-cancel bounds saturate.
+TEST(OrderBookTest, RejectsUnrepresentablePrices) {
+    OrderBook ob;
+    ob.addOrder(Order(1, 100.0, 5, OrderType::BUY));
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double inf = std::numeric_limits<double>::infinity();
+
+    std::vector<Trade> trades;
+    RejectReason reason = RejectReason::NONE;
+    for (double price : {1e300, -1e300, inf, -inf, nan}) {
+        reason = RejectReason::NONE;
+        EXPECT_FALSE(ob.addOrder(Order(2, price, 5, OrderType::SELL), trades, &reason));
+        EXPECT_EQ(reason, RejectReason::INVALID_ORDER);
+        reason = RejectReason::NONE;
+        EXPECT_FALSE(ob.addOrder(stopOrder(3, 0.0, 5, OrderType::SELL, price, ORDER_MARKET), trades, &reason));
+        EXPECT_EQ(reason, RejectReason::INVALID_ORDER);
+        reason = RejectReason::NONE;
+        EXPECT_FALSE(ob.modifyOrder(1, price, 5, trades, &reason));
+        EXPECT_EQ(reason, RejectReason::INVALID_ORDER);
+    }
+    EXPECT_TRUE(trades.empty());
+    EXPECT_EQ(ob.size(), 1);
+    EXPECT_EQ(ob.stopCount(), 0);
+    EXPECT_DOUBLE_EQ(ob.getRawOrderBookData().first[0].price, 100.0);
+
+    EXPECT_EQ(ob.cancelByPriceRange(OrderType::BUY, nan, 200.0), 0);
+    EXPECT_EQ(ob.cancelByPriceRange(OrderType::BUY, -1e300, 1e300), 1);
+    EXPECT_EQ(ob.size(), 0);
+}
+
+// Test that a book assigning IDs numbers accepted orders without gaps,
+// ignores the client's ID, and keeps the numbering through a snapshot.
+TEST(OrderBookTest, AssignsOrderIds) {
+    InstrumentConfig config;
+    config.assignOrderIds = true;
+    OrderBook ob(config);
+    std::vector<Trade> trades;
+    ASSERT_TRUE(ob.addOrder(Order(42, 99.0, 5, OrderType::BUY), trades));
+    EXPECT_EQ(ob.lastOrderId(), 1);
+    ASSERT_TRUE(ob.addOrder(Order(42, 99.5, 5, OrderType::BUY), trades));
+    EXPECT_EQ(ob.lastOrderId(), 2);
+    Order postOnly(7, 99.0, 5, OrderType::SELL);
+    postOnly.flags = ORDER_POST_ONLY;
+    RejectReason reason = RejectReason::NONE;
+    EXPECT_FALSE(ob.addOrder(postOnly, trades, &reason));
+    EXPECT_EQ(reason, RejectReason::WOULD_CROSS);
+    EXPECT_EQ(ob.lastOrderId(), 2);
+
+    ASSERT_TRUE(ob.addOrder(Order(0, 99.5, 3, OrderType::SELL), trades));
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].buyOrderID, 2);
+    EXPECT_EQ(trades[0].sellOrderID, 3);
+    EXPECT_TRUE(ob.hasOrder(1));
+    EXPECT_TRUE(ob.cancelOrder(1));
+    EXPECT_FALSE(ob.hasOrder(1));
+
+    std::vector<char> image;
+    SnapshotWriter out(image);
+    ob.saveSnapshot(out);
+    OrderBook restored(config);
+    SnapshotReader in(image.data(), image.size());
+    ASSERT_TRUE(restored.loadSnapshot(in, Symbol()));
+    EXPECT_TRUE(restored.hasOrder(2));
+    ASSERT_TRUE(restored.addOrder(Order(0, 98.0, 1, OrderType::BUY), trades));
+    EXPECT_EQ(restored.lastOrderId(), 4);
+}
+
+namespace {
+
+Order ownedOrder(OrderId id, Price price, int quantity, OrderType side, OwnerId owner) {
+    Order order(id, price, quantity, side);
+    order.owner = owner;
+    return order;
+}
+
+} // namespace
+
+// Test that cancelAll removes one owner's resting orders and stops in a
+// single sequence step, with one LEVEL delta per level it changed, and
+// that fills keep the owner lists in step.
+TEST(OrderBookTest, CancelAllByOwner) {
+    OrderBook ob;
+    std::vector<Trade> trades;
+    ob.addOrder(ownedOrder(1, 99.0, 5, OrderType::BUY, 7), trades);
+    ob.addOrder(ownedOrder(2, 99.0, 5, OrderType::BUY, 8), trades);
+    ob.addOrder(ownedOrder(3, 99.0, 5, OrderType::BUY, 7), trades);
+    ob.addOrder(ownedOrder(4, 101.0, 5, OrderType::SELL, 7), trades);
+    ob.addOrder(ownedOrder(5, 102.0, 5, OrderType::SELL, 7), trades);
+    Order stop = stopOrder(6, 0.0, 2, OrderType::SELL, 90.0, ORDER_MARKET);
+    stop.owner = 7;
+    ob.addOrder(stop, trades);
+    ob.addOrder(Order(9, 101.0, 5, OrderType::BUY), trades);  // Fills order 4.
+    EXPECT_EQ(ob.ownerOrderCount(7), 4);
+
+    std::vector<BookDelta> deltas;
+    ob.setDeltaSink(&deltas);
+    std::uint64_t before = ob.updateSequence();
+    std::vector<OrderId> cancelled;
+    MassCancel filter;
+    filter.owner = 7;
+    EXPECT_EQ(ob.cancelOrders(filter, &cancelled), 4);
+    ob.setDeltaSink(nullptr);
+
+    EXPECT_EQ(ob.updateSequence(), before + 1);
+    std::sort(cancelled.begin(), cancelled.end());
+    EXPECT_EQ(cancelled, (std::vector<OrderId>{ 1, 3, 5, 6 }));
+    EXPECT_EQ(ob.ownerOrderCount(7), 0);
+    EXPECT_EQ(ob.size(), 1);
+    EXPECT_EQ(ob.stopCount(), 0);
+    EXPECT_TRUE(ob.hasOrder(2));
+    int levels = 0;
+    for (const BookDelta& delta : deltas) {
+        levels += delta.type == BookDelta::Type::LEVEL;
+    }
+    EXPECT_EQ(levels, 2);   // 99 (one order left) and 102 (gone).
+    BookDepth depth = ob.getDepth(5);
+    ASSERT_EQ(depth.bids.size(), 1);
+    EXPECT_EQ(depth.bids[0].quantity, 5);
+    EXPECT_TRUE(depth.asks.empty());
+    EXPECT_EQ(ob.cancelAll(7), 0);
+    EXPECT_EQ(ob.updateSequence(), before + 1);
+}
+
+// Test the side and price range filters, with and without an owner, and
+// that owners survive a snapshot.
+TEST(OrderBookTest, CancelBySideAndPriceRange) {
+    OrderBook ob;
+    std::vector<Trade> trades;
+    for (int i = 0; i < 10; i++) {
+        ob.addOrder(ownedOrder(i + 1, 90.0 + i, 1, OrderType::BUY, i % 2 == 0 ? 1 : 2), trades);
+        ob.addOrder(ownedOrder(i + 101, 110.0 + i, 1, OrderType::SELL, 1), trades);
+    }
+    EXPECT_EQ(ob.cancelByPriceRange(OrderType::BUY, 92.0, 95.0), 4);
+    EXPECT_FALSE(ob.hasOrder(3));
+    EXPECT_TRUE(ob.hasOrder(2));
+    EXPECT_TRUE(ob.hasOrder(7));
+    EXPECT_EQ(ob.cancelByPriceRange(OrderType::BUY, 0.0, 100.0, 2), 3);  // 2, 8 and 10.
+    EXPECT_EQ(ob.cancelBySide(OrderType::SELL), 10);
+    EXPECT_EQ(ob.size(), 3);   // 1, 7 and 9, all owner 1.
+
+    std::vector<char> image;
+    SnapshotWriter out(image);
+    ob.saveSnapshot(out);
+    OrderBook restored;
+    SnapshotReader in(image.data(), image.size());
+    ASSERT_TRUE(restored.loadSnapshot(in, Symbol()));
+    EXPECT_EQ(restored.ownerOrderCount(1), 3);
+    EXPECT_EQ(restored.cancelAll(1), 3);
+    EXPECT_EQ(restored.size(), 0);
+    EXPECT_EQ(restored.getDepth(5).bids.size(), 0);
+}
+
+// Test that a price filter with only one bound leaves the other end open,
+// both when walking the levels and when walking an owner's orders.
+TEST(OrderBookTest, CancelByOneSidedPriceRange) {
+    OrderBook ob;
+    std::vector<Trade> trades;
+    for (int i = 0; i < 10; i++) {
+        ob.addOrder(ownedOrder(i + 1, 90.0 + i, 1, OrderType::BUY, 1), trades);
+        ob.addOrder(ownedOrder(i + 101, 110.0 + i, 1, OrderType::SELL, 2), trades);
+    }
+    MassCancel above;
+    above.hasMinPrice = true;
+    above.minPrice = 95.0;
+    std::vector<OrderId> cancelled;
+    EXPECT_EQ(ob.cancelOrders(above, &cancelled), 15);   // Bids 95-99 and every ask.
+    EXPECT_EQ(ob.size(), 5);
+    EXPECT_TRUE(ob.hasOrder(5));
+    EXPECT_FALSE(ob.hasOrder(6));
+
+    MassCancel below;
+    below.owner = 1;
+    below.hasMaxPrice = true;
+    below.maxPrice = 92.0;
+    EXPECT_EQ(ob.cancelOrders(below), 3);
+    EXPECT_EQ(ob.size(), 2);
+    EXPECT_TRUE(ob.hasOrder(4));
+    EXPECT_TRUE(ob.hasOrder(5));
+}
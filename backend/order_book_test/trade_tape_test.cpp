@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "gtest/gtest.h"
+#include "../orderbook/matching_engine.h"
+#include "../orderbook/trade_tape.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+Trade numberedTrade(std::uint64_t n) {
+    return { static_cast<OrderId>(n), static_cast<OrderId>(n + 1), static_cast<int>(n % 1000) + 1,
+        static_cast<Price>(n) * 0.5 };
+}
+
+} // namespace
+
+// Test that trades read back in order from any sequence, and that a reader
+// left behind by a lap resumes at the oldest trade still held.
+TEST(TradeTapeTest, ReadsBySequenceAndSkipsOverwritten) {
+    TradeTape tape(8);
+    EXPECT_EQ(tape.capacity(), 8);
+    std::vector<Trade> trades;
+    for (std::uint64_t n = 0; n < 5; n++) {
+        trades.push_back(numberedTrade(n));
+    }
+    tape.append(trades.data(), trades.size(), "AAPL", 7, 1000);
+    EXPECT_EQ(tape.head(), 5);
+
+    TapeTrade out[16];
+    ASSERT_EQ(tape.read(2, out, 16), 3);
+    EXPECT_EQ(out[0].sequence, 2);
+    EXPECT_EQ(out[0].trade.buyOrderID, 2);
+    EXPECT_EQ(out[0].commandSequence, 7);
+    EXPECT_EQ(out[0].timestamp, 1000);
+    EXPECT_EQ(out[0].symbol, Symbol("AAPL"));
+    EXPECT_EQ(tape.read(5, out, 16), 0);
+
+    trades.clear();
+    for (std::uint64_t n = 5; n < 20; n++) {
+        trades.push_back(numberedTrade(n));
+    }
+    tape.append(trades.data(), trades.size(), "MSFT", 8, 2000);
+    ASSERT_EQ(tape.read(0, out, 16), 8);     // Sequences 0-11 are gone.
+    EXPECT_EQ(out[0].sequence, 12);
+    EXPECT_EQ(out[7].sequence, 19);
+    EXPECT_DOUBLE_EQ(out[7].trade.tradePrice, 9.5);
+}
+
+// Test that readers racing the writer only ever see whole, consecutive trades.
+TEST(TradeTapeTest, ConcurrentReadersSeeWholeTrades) {
+    const std::uint64_t kTrades = 200000;
+    TradeTape tape(64);
+    std::atomic<bool> done{ false };
+    std::atomic<std::uint64_t> torn{ 0 };
+    std::atomic<std::uint64_t> seen{ 0 };
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; r++) {
+        readers.emplace_back([&] {
+            TapeTrade out[32];
+            std::uint64_t next = 0;
+            while (!done.load() || next < tape.head()) {
+                std::size_t count = tape.read(next, out, 32);
+                for (std::size_t i = 0; i < count; i++) {
+                    Trade expected = numberedTrade(out[i].sequence);
+                    if (out[i].trade.buyOrderID != expected.buyOrderID || out[i].trade.sellOrderID != expected.sellOrderID
+                        || out[i].trade.quantity != expected.quantity || out[i].trade.tradePrice != expected.tradePrice
+                        || out[i].commandSequence != out[i].sequence || (i > 0 && out[i].sequence != out[i - 1].sequence + 1)) {
+                        torn++;
+                    }
+                }
+                if (count > 0) {
+                    next = out[count - 1].sequence + 1;
+                    seen += count;
+                }
+            }
+        });
+    }
+    for (std::uint64_t n = 0; n < kTrades; n++) {
+        Trade trade = numberedTrade(n);
+        tape.append(&trade, 1, "AAPL", n, 0);
+    }
+    done = true;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(torn.load(), 0);
+    EXPECT_GT(seen.load(), 0);
+}
+
+// Test that the engine records every execution with its command's sequence.
+TEST(TradeTapeTest, EngineAppendsExecutions) {
+    MatchingEngine engine(1);
+    engine.start();
+    EngineCommand add;
+    add.type = EngineCommand::Type::ADD;
+    add.symbol = "AAPL";
+    add.order = Order(1, 50.0, 10, OrderType::SELL, "AAPL");
+    engine.submit(add).get();
+    add.order = Order(2, 50.0, 4, OrderType::BUY, "AAPL");
+    CommandResult result = engine.submit(add).get();
+
+    EngineCommand batch;
+    batch.type = EngineCommand::Type::BATCH;
+    batch.symbol = "AAPL";
+    batch.batch.resize(2);
+    batch.batch[0].order = Order(3, 50.0, 1, OrderType::BUY, "AAPL");
+    batch.batch[1].order = Order(4, 50.0, 2, OrderType::BUY, "AAPL");
+    CommandResult batched = engine.submit(batch).get();
+    engine.stop();
+
+    const TradeTape& tape = engine.tape("AAPL");
+    TapeTrade out[8];
+    ASSERT_EQ(tape.read(0, out, 8), 3);
+    EXPECT_EQ(out[0].trade.buyOrderID, 2);
+    EXPECT_EQ(out[0].commandSequence, result.sequence);
+    EXPECT_EQ(out[1].commandSequence, batched.batch[0].sequence);
+    EXPECT_EQ(out[2].commandSequence, batched.batch[1].sequence);
+    EXPECT_EQ(out[2].trade.quantity, 2);
+}
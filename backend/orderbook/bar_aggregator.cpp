@@ -0,0 +1,154 @@
+#include "bar_aggregator.h"
+#include <algorithm>
+#include <chrono>
+
+void BarSeries::add(std::int64_t timestamp, Price price, int quantity) {
+    std::int64_t start = timestamp - timestamp % interval_;
+    if (bars_.empty() || start > bars_.back().start) {
+        Bar bar;
+        bar.start = start;
+        bar.open = bar.high = bar.low = price;
+        bars_.push_back(bar);
+        if (bars_.size() > history_ + 1) {
+            bars_.pop_front();
+        }
+    }
+    Bar& bar = bars_.back();
+    bar.high = std::max(bar.high, price);
+    bar.low = std::min(bar.low, price);
+    bar.close = price;
+    bar.volume += quantity;
+    bar.notional += price * quantity;
+    bar.trades++;
+    changedFrom_ = std::min(changedFrom_, bar.start);
+}
+
+void BarSeries::latest(std::size_t limit, std::vector<Bar>& out) const {
+    std::size_t count = std::min(limit, bars_.size());
+    out.insert(out.end(), bars_.end() - static_cast<std::ptrdiff_t>(count), bars_.end());
+}
+
+void BarSeries::takeChanged(std::vector<Bar>& out) {
+    std::size_t count = 0;
+    while (count < bars_.size() && bars_[bars_.size() - 1 - count].start >= changedFrom_) {
+        count++;
+    }
+    latest(count, out);
+    changedFrom_ = INT64_MAX;
+}
+
+BarAggregator::BarAggregator(MatchingEngine& engine, std::vector<std::int64_t> intervals, std::size_t history)
+    : engine_(engine), intervals_(std::move(intervals)), history_(history),
+      cursors_(engine.shardCount(), 0), chunk_(kChunk) {
+    // Start at the present: the tapes only hold recent trades anyway.
+    for (std::size_t i = 0; i < cursors_.size(); i++) {
+        cursors_[i] = engine_.shardTape(i).head();
+    }
+}
+
+BarAggregator::~BarAggregator() {
+    stop();
+}
+
+void BarAggregator::start() {
+    if (thread_.joinable()) {
+        return;
+    }
+    stopping_.store(false);
+    thread_ = std::thread([this] { run(); });
+}
+
+void BarAggregator::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    stopping_.store(true);
+    thread_.join();
+}
+
+void BarAggregator::run() {
+    while (!stopping_.load(std::memory_order_relaxed)) {
+        if (poll() == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    poll();
+}
+
+BarAggregator::SymbolBars& BarAggregator::barsFor(const Symbol& symbol) {
+    auto it = symbols_.find(symbol);
+    if (it == symbols_.end()) {
+        SymbolBars bars;
+        bars.series.reserve(intervals_.size());
+        for (std::int64_t interval : intervals_) {
+            bars.series.emplace_back(interval, history_);
+        }
+        it = symbols_.emplace(symbol, std::move(bars)).first;
+    }
+    return it->second;
+}
+
+std::size_t BarAggregator::poll() {
+    std::size_t folded = 0;
+    std::vector<std::pair<Symbol, SymbolBars*>> touched;
+    for (std::size_t shard = 0; shard < cursors_.size(); shard++) {
+        std::uint64_t& cursor = cursors_[shard];
+        std::size_t count = engine_.shardTape(shard).read(cursor, chunk_.data(), chunk_.size());
+        if (count == 0) {
+            continue;
+        }
+        if (chunk_[0].sequence > cursor) {
+            missed_.fetch_add(chunk_[0].sequence - cursor, std::memory_order_relaxed);
+        }
+        cursor = chunk_[count - 1].sequence + 1;
+        engine_.waitDurable(chunk_[count - 1].symbol, chunk_[count - 1].commandSequence);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::size_t i = 0; i < count; i++) {
+            const TapeTrade& entry = chunk_[i];
+            SymbolBars& bars = barsFor(entry.symbol);
+            for (BarSeries& series : bars.series) {
+                series.add(entry.timestamp, entry.trade.tradePrice, entry.trade.quantity);
+            }
+            if (!bars.touched) {
+                bars.touched = true;
+                touched.emplace_back(entry.symbol, &bars);
+            }
+        }
+        folded += count;
+    }
+    if (touched.empty()) {
+        return folded;
+    }
+    std::vector<BarUpdate> updates;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& [symbol, bars] : touched) {
+            bars->touched = false;
+            for (BarSeries& series : bars->series) {
+                BarUpdate update;
+                update.symbol = symbol;
+                update.interval = series.interval();
+                series.takeChanged(update.bars);
+                updates.push_back(std::move(update));
+            }
+        }
+    }
+    if (listener_) {
+        listener_(updates);
+    }
+    return folded;
+}
+
+bool BarAggregator::bars(const Symbol& symbol, std::int64_t interval, std::size_t limit, std::vector<Bar>& out) const {
+    auto position = std::find(intervals_.begin(), intervals_.end(), interval);
+    if (position == intervals_.end()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = symbols_.find(symbol);
+    if (it != symbols_.end()) {
+        it->second.series[static_cast<std::size_t>(position - intervals_.begin())].latest(limit, out);
+    }
+    return true;
+}
@@ -0,0 +1,141 @@
+#ifndef BAR_AGGREGATOR_H
+#define BAR_AGGREGATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "matching_engine.h"
+
+// OHLCV summary of the trades of one symbol over [start, start + interval).
+struct Bar {
+    std::int64_t start = 0;         // Nanoseconds since the epoch.
+    Price open = 0.0;
+    Price high = 0.0;
+    Price low = 0.0;
+    Price close = 0.0;
+    std::int64_t volume = 0;
+    double notional = 0.0;          // Sum of price * quantity.
+    std::uint64_t trades = 0;
+
+    double vwap() const { return volume == 0 ? 0.0 : notional / static_cast<double>(volume); }
+};
+
+//
+// Bars of one symbol at one interval: the bar being built plus up to
+// `history` closed ones. Intervals without trades produce no bar.
+//
+class BarSeries {
+public:
+    BarSeries(std::int64_t interval, std::size_t history) : interval_(interval), history_(history) {}
+
+    // Folds in one trade. O(1). A trade stamped before the current bar (a
+    // clock step back) is counted in the current bar.
+    void add(std::int64_t timestamp, Price price, int quantity);
+
+    std::int64_t interval() const { return interval_; }
+
+    // Appends the last `limit` bars, oldest first, the open one last.
+    void latest(std::size_t limit, std::vector<Bar>& out) const;
+
+    // Appends the bars that received trades since the last call to
+    // takeChanged(), oldest first.
+    void takeChanged(std::vector<Bar>& out);
+
+private:
+    std::int64_t interval_;
+    std::size_t history_;
+    std::deque<Bar> bars_;          // Closed bars followed by the open one.
+    std::int64_t changedFrom_ = INT64_MAX;  // Start of the oldest bar changed since takeChanged().
+};
+
+// Bars changed by one aggregation pass, for one symbol and interval.
+struct BarUpdate {
+    Symbol symbol;
+    std::int64_t interval = 0;
+    std::vector<Bar> bars;
+};
+
+using BarListener = std::function<void(const std::vector<BarUpdate>& updates)>;
+
+//
+// Builds OHLCV/VWAP bars at a fixed set of intervals for every symbol, from
+// each shard's TradeTape. It runs on its own thread and only reads the tapes,
+// so the matching threads never wait on it nor share a lock with it; each
+// trade costs a lookup of its symbol plus O(1) work per interval. A pass
+// reads every tape from where the previous one stopped, folds the new trades
+// in and hands the changed bars to the listener.
+//
+// Trades are folded in once they are durable. If the aggregator falls more
+// than a tape's capacity behind, the overwritten trades are lost to the bars
+// and counted in missedTrades().
+//
+class BarAggregator {
+public:
+    // Default number of closed bars kept per symbol and interval.
+    static constexpr std::size_t kDefaultHistory = 1000;
+
+    BarAggregator(MatchingEngine& engine, std::vector<std::int64_t> intervals,
+        std::size_t history = kDefaultHistory);
+    ~BarAggregator();
+
+    BarAggregator(const BarAggregator&) = delete;
+    BarAggregator& operator=(const BarAggregator&) = delete;
+
+    // Called on the aggregator's thread after every pass that changed a bar.
+    // Must be set before start().
+    void setListener(BarListener listener) { listener_ = std::move(listener); }
+
+    // Starts / joins the aggregation thread.
+    void start();
+    void stop();
+
+    // Runs one pass on the calling thread (for when the thread is not
+    // started). Returns the number of trades folded in.
+    std::size_t poll();
+
+    const std::vector<std::int64_t>& intervals() const { return intervals_; }
+
+    // Appends the last `limit` bars of `symbol` at `interval`, oldest first.
+    // Returns false if `interval` is not one of intervals().
+    bool bars(const Symbol& symbol, std::int64_t interval, std::size_t limit, std::vector<Bar>& out) const;
+
+    std::uint64_t missedTrades() const { return missed_.load(std::memory_order_relaxed); }
+
+private:
+    // Trades read from a tape per pass, at most.
+    static constexpr std::size_t kChunk = 256;
+
+    // Every interval's bars of one symbol.
+    struct SymbolBars {
+        std::vector<BarSeries> series;
+        bool touched = false;       // Changed during the current pass.
+    };
+
+    void run();
+    SymbolBars& barsFor(const Symbol& symbol);
+
+    MatchingEngine& engine_;
+    std::vector<std::int64_t> intervals_;
+    std::size_t history_;
+    BarListener listener_;
+
+    // Only touched by the polling thread.
+    std::vector<std::uint64_t> cursors_;    // Next tape sequence per shard.
+    std::vector<TapeTrade> chunk_;
+
+    mutable std::mutex mutex_;              // Guards symbols_ against readers.
+    std::unordered_map<Symbol, SymbolBars, SymbolHash> symbols_;
+
+    std::atomic<std::uint64_t> missed_{ 0 };
+    std::atomic<bool> stopping_{ false };
+    std::thread thread_;
+};
+
+#endif // BAR_AGGREGATOR_H
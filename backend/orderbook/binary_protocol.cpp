@@ -0,0 +1,185 @@
+#include "binary_protocol.h"
+#include <cstring>
+
+namespace {
+
+template <typename Message>
+void append(const Message& message, std::string& out) {
+    out.append(reinterpret_cast<const char*>(&message), sizeof(message));
+}
+
+// The symbol field may use all 16 bytes; Symbol keeps at most kMaxLength.
+Symbol symbolField(const char (&field)[16]) {
+    char text[sizeof(field) + 1] = {};
+    std::memcpy(text, field, sizeof(field));
+    return Symbol(text);
+}
+
+} // namespace
+
+BinaryDecodeStatus decodeBinaryCommand(const char* data, std::size_t size, EngineCommand& command, std::size_t& consumed) {
+    if (size < sizeof(BinaryHeader)) {
+        return BinaryDecodeStatus::INCOMPLETE;
+    }
+    const BinaryHeader* header = reinterpret_cast<const BinaryHeader*>(data);
+    if (header->version != kBinaryVersion) {
+        return BinaryDecodeStatus::MALFORMED;
+    }
+    switch (header->type) {
+    case BINARY_NEW_ORDER:
+        if (header->length != sizeof(BinaryNewOrder)) {
+            return BinaryDecodeStatus::MALFORMED;
+        }
+        break;
+    case BINARY_CANCEL:
+        if (header->length != sizeof(BinaryCancel)) {
+            return BinaryDecodeStatus::MALFORMED;
+        }
+        break;
+    case BINARY_MODIFY:
+        if (header->length != sizeof(BinaryModify)) {
+            return BinaryDecodeStatus::MALFORMED;
+        }
+        break;
+    case BINARY_BATCH:
+        if (header->length < sizeof(BinaryBatch)) {
+            return BinaryDecodeStatus::MALFORMED;
+        }
+        break;
+    default:
+        return BinaryDecodeStatus::MALFORMED;
+    }
+    if (size < header->length) {
+        return BinaryDecodeStatus::INCOMPLETE;
+    }
+
+    if (header->type == BINARY_NEW_ORDER) {
+        const BinaryNewOrder* message = reinterpret_cast<const BinaryNewOrder*>(data);
+        if (message->side > 1 || message->timeInForce > static_cast<std::uint8_t>(TimeInForce::FOK)
+            || (message->flags & ~(ORDER_MARKET | ORDER_POST_ONLY)) != 0) {
+            return BinaryDecodeStatus::MALFORMED;
+        }
+        command.type = EngineCommand::Type::ADD;
+        command.symbol = symbolField(message->symbol);
+        command.orderId = message->orderId;
+        command.order = Order(message->orderId, message->price, message->quantity,
+            message->side == 0 ? OrderType::BUY : OrderType::SELL, command.symbol);
+        command.order.timeInForce = static_cast<TimeInForce>(message->timeInForce);
+        command.order.flags = message->flags;
+    }
+    else if (header->type == BINARY_CANCEL) {
+        const BinaryCancel* message = reinterpret_cast<const BinaryCancel*>(data);
+        command.type = EngineCommand::Type::CANCEL;
+        command.symbol = symbolField(message->symbol);
+        command.orderId = message->orderId;
+    }
+    else if (header->type == BINARY_MODIFY) {
+        const BinaryModify* message = reinterpret_cast<const BinaryModify*>(data);
+        command.type = EngineCommand::Type::MODIFY;
+        command.symbol = symbolField(message->symbol);
+        command.orderId = message->orderId;
+        command.order.price = message->price;
+        command.order.quantity = message->quantity;
+    }
+    else {
+        // Entries decode into the batch exactly like standalone messages.
+        const BinaryBatch* batch = reinterpret_cast<const BinaryBatch*>(data);
+        command.type = EngineCommand::Type::BATCH;
+        command.symbol = symbolField(batch->symbol);
+        command.batch.clear();
+        command.batch.reserve(batch->count);
+        std::size_t offset = sizeof(BinaryBatch);
+        for (std::uint16_t i = 0; i < batch->count; i++) {
+            EngineCommand entry;
+            std::size_t used = 0;
+            if (decodeBinaryCommand(data + offset, header->length - offset, entry, used) != BinaryDecodeStatus::OK
+                || entry.type == EngineCommand::Type::BATCH
+                || (!entry.symbol.empty() && entry.symbol != command.symbol)) {
+                return BinaryDecodeStatus::MALFORMED;
+            }
+            BookCommand sub;
+            sub.type = entry.type == EngineCommand::Type::ADD ? BookCommand::Type::ADD
+                : entry.type == EngineCommand::Type::MODIFY ? BookCommand::Type::MODIFY : BookCommand::Type::CANCEL;
+            sub.order = entry.order;
+            sub.order.symbol = command.symbol;
+            sub.orderId = entry.orderId;
+            command.batch.push_back(sub);
+            offset += used;
+        }
+        if (offset != header->length) {
+            return BinaryDecodeStatus::MALFORMED;
+        }
+    }
+    consumed = header->length;
+    return BinaryDecodeStatus::OK;
+}
+
+namespace {
+
+BinaryRejectReason binaryReason(bool add, RejectReason reason) {
+    switch (reason) {
+    case RejectReason::DUPLICATE_ORDER_ID: return REJECT_DUPLICATE_ORDER_ID;
+    case RejectReason::UNKNOWN_ORDER: return REJECT_UNKNOWN_ORDER;
+    case RejectReason::INVALID_ORDER: return REJECT_INVALID_ORDER;
+    case RejectReason::WOULD_CROSS: return REJECT_WOULD_CROSS;
+    case RejectReason::NOT_FILLABLE: return REJECT_NOT_FILLABLE;
+    case RejectReason::UNKNOWN_SYMBOL: return REJECT_UNKNOWN_SYMBOL;
+    case RejectReason::ORDER_IDS_EXHAUSTED: return REJECT_ORDER_IDS_EXHAUSTED;
+    default: return add ? REJECT_DUPLICATE_ORDER_ID : REJECT_UNKNOWN_ORDER;
+    }
+}
+
+// An accepted add is acknowledged under the ID the book filed it under,
+// which differs from the client's if the book assigns IDs (never 0).
+OrderId ackedOrderId(const Order& order, bool accepted, OrderId filed) {
+    return accepted && filed != 0 ? filed : order.GetOrderId();
+}
+
+// Replies for one applied add, cancel or modify.
+void encodeEntry(bool add, OrderId orderId, bool accepted, RejectReason reject, std::uint64_t sequence,
+    const Trade* trades, std::size_t tradeCount, std::string& out) {
+    if (!accepted) {
+        encodeBinaryReject(orderId, binaryReason(add, reject), out);
+        return;
+    }
+    BinaryAck ack;
+    ack.orderId = orderId;
+    ack.sequence = sequence;
+    append(ack, out);
+    for (std::size_t i = 0; i < tradeCount; i++) {
+        BinaryFill fill;
+        fill.buyOrderId = trades[i].buyOrderID;
+        fill.sellOrderId = trades[i].sellOrderID;
+        fill.quantity = trades[i].quantity;
+        fill.price = trades[i].tradePrice;
+        fill.sequence = sequence;
+        append(fill, out);
+    }
+}
+
+} // namespace
+
+void encodeBinaryResult(const EngineCommand& command, const CommandResult& result, std::string& out) {
+    if (command.type == EngineCommand::Type::BATCH) {
+        for (std::size_t i = 0; i < command.batch.size() && i < result.batch.size(); i++) {
+            const BookCommand& sub = command.batch[i];
+            const BookCommandResult& entry = result.batch[i];
+            bool add = sub.type == BookCommand::Type::ADD;
+            OrderId orderId = !add ? sub.orderId : ackedOrderId(sub.order, entry.accepted, entry.orderId);
+            encodeEntry(add, orderId, entry.accepted, entry.reject, entry.sequence,
+                result.trades.data() + entry.firstTrade, entry.tradeCount, out);
+        }
+        return;
+    }
+    bool add = command.type == EngineCommand::Type::ADD;
+    OrderId orderId = !add ? command.orderId : ackedOrderId(command.order, result.accepted, result.orderId);
+    encodeEntry(add, orderId, result.accepted, result.reject, result.sequence,
+        result.trades.data(), result.trades.size(), out);
+}
+
+void encodeBinaryReject(OrderId orderId, BinaryRejectReason reason, std::string& out) {
+    BinaryReject reject;
+    reject.orderId = orderId;
+    reject.reason = reason;
+    append(reject, out);
+}
@@ -0,0 +1,123 @@
+#ifndef BINARY_PROTOCOL_H
+#define BINARY_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "matching_engine.h"
+
+//
+// Fixed-layout binary order entry, in the spirit of OUCH/SBE. Every message
+// starts with a BinaryHeader whose `length` covers the whole message; fields
+// are little-endian on every supported target and never padded, so inbound
+// messages are read in place, without a parsing pass or intermediate object.
+//
+// Inbound:  NEW_ORDER, CANCEL, MODIFY, and BATCH: a BinaryBatch header
+//           followed by `count` NEW_ORDER / CANCEL / MODIFY messages for its
+//           symbol, applied as one unit.
+// Outbound: ACK (command accepted and sequenced; for a new order, the ID it
+//           was accepted under), REJECT, FILL (one per trade); for a batch,
+//           the replies of each entry in order.
+//
+constexpr std::uint8_t kBinaryVersion = 1;
+
+enum BinaryMessageType : char {
+    BINARY_NEW_ORDER = 'N',
+    BINARY_CANCEL = 'X',
+    BINARY_MODIFY = 'M',
+    BINARY_BATCH = 'B',
+    BINARY_ACK = 'A',
+    BINARY_REJECT = 'J',
+    BINARY_FILL = 'F'
+};
+
+enum BinaryRejectReason : std::uint8_t {
+    REJECT_DUPLICATE_ORDER_ID = 1,
+    REJECT_UNKNOWN_ORDER = 2,
+    REJECT_MALFORMED = 3,
+    REJECT_INVALID_ORDER = 4,
+    REJECT_WOULD_CROSS = 5,
+    REJECT_NOT_FILLABLE = 6,
+    REJECT_UNKNOWN_SYMBOL = 7,
+    REJECT_ORDER_IDS_EXHAUSTED = 8
+};
+
+#pragma pack(push, 1)
+struct BinaryHeader {
+    std::uint16_t length = 0;       // Whole message, header included.
+    char type = 0;
+    std::uint8_t version = kBinaryVersion;
+};
+
+struct BinaryNewOrder {
+    BinaryHeader header{ sizeof(BinaryNewOrder), BINARY_NEW_ORDER, kBinaryVersion };
+    std::int32_t orderId = 0;
+    std::int32_t quantity = 0;
+    double price = 0.0;
+    std::uint8_t side = 0;          // 0 = BUY, 1 = SELL
+    std::uint8_t timeInForce = 0;   // 0 = GTC, 1 = IOC, 2 = FOK
+    std::uint8_t flags = 0;         // OrderFlag bits: 1 = market, 2 = post-only.
+    std::uint8_t reserved = 0;
+    char symbol[16] = {};           // NUL-padded; empty = default book.
+};
+
+struct BinaryCancel {
+    BinaryHeader header{ sizeof(BinaryCancel), BINARY_CANCEL, kBinaryVersion };
+    std::int32_t orderId = 0;
+    char symbol[16] = {};
+};
+
+struct BinaryModify {
+    BinaryHeader header{ sizeof(BinaryModify), BINARY_MODIFY, kBinaryVersion };
+    std::int32_t orderId = 0;
+    std::int32_t quantity = 0;      // New quantity.
+    double price = 0.0;             // New price.
+    char symbol[16] = {};
+};
+
+struct BinaryBatch {
+    BinaryHeader header{ sizeof(BinaryBatch), BINARY_BATCH, kBinaryVersion };  // Length includes the entries.
+    std::uint16_t count = 0;
+    std::uint16_t reserved = 0;
+    char symbol[16] = {};           // Entries must name this symbol or none.
+};
+
+struct BinaryAck {
+    BinaryHeader header{ sizeof(BinaryAck), BINARY_ACK, kBinaryVersion };
+    std::int32_t orderId = 0;
+    std::uint64_t sequence = 0;
+};
+
+struct BinaryReject {
+    BinaryHeader header{ sizeof(BinaryReject), BINARY_REJECT, kBinaryVersion };
+    std::int32_t orderId = 0;
+    std::uint8_t reason = 0;
+};
+
+struct BinaryFill {
+    BinaryHeader header{ sizeof(BinaryFill), BINARY_FILL, kBinaryVersion };
+    std::int32_t buyOrderId = 0;
+    std::int32_t sellOrderId = 0;
+    std::int32_t quantity = 0;
+    double price = 0.0;
+    std::uint64_t sequence = 0;     // Sequence of the command that traded.
+};
+#pragma pack(pop)
+
+enum class BinaryDecodeStatus {
+    OK,          // `command` is filled in and `consumed` bytes were used.
+    INCOMPLETE,  // The buffer ends inside a message.
+    MALFORMED    // Unknown type or version, or wrong length: the stream is lost.
+};
+
+// Decodes the message at the start of [data, data + size) straight into
+// `command`, reading the fields where they lie in the buffer.
+BinaryDecodeStatus decodeBinaryCommand(const char* data, std::size_t size, EngineCommand& command, std::size_t& consumed);
+
+// Appends the replies for an applied command to `out`: an ACK and one FILL
+// per trade, or a REJECT carrying the book's reason.
+void encodeBinaryResult(const EngineCommand& command, const CommandResult& result, std::string& out);
+
+void encodeBinaryReject(OrderId orderId, BinaryRejectReason reason, std::string& out);
+
+#endif // BINARY_PROTOCOL_H
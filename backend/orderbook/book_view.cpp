@@ -0,0 +1,109 @@
+#include "book_view.h"
+#include <algorithm>
+#include <thread>
+
+std::shared_ptr<const BookView> BookView::capture(const OrderBook& book, std::size_t levels) {
+    auto view = std::make_shared<BookView>();
+    view->sequence = book.updateSequence();
+    std::tie(view->bids, view->asks) = book.getRawOrderBookData(levels);
+    // One level more than kept tells whether anything was left out.
+    view->levels = book.getDepth(levels < SIZE_MAX ? levels + 1 : levels);
+    for (std::vector<DepthLevel>* side : { &view->levels.bids, &view->levels.asks }) {
+        if (side->size() > levels) {
+            side->resize(levels);
+            view->truncated = true;
+        }
+    }
+    return view;
+}
+
+BookDepth BookView::depth(std::size_t count) const {
+    BookDepth out;
+    out.sequence = sequence;
+    out.bids.assign(levels.bids.begin(), levels.bids.begin() + std::min(count, levels.bids.size()));
+    out.asks.assign(levels.asks.begin(), levels.asks.begin() + std::min(count, levels.asks.size()));
+    return out;
+}
+
+ViewPublisher::~ViewPublisher() {
+    delete current_.load();
+}
+
+void ViewPublisher::publish(std::vector<std::pair<Symbol, std::shared_ptr<const BookView>>>& changed) {
+    const ViewMap* current = current_.load(std::memory_order_relaxed);
+    std::unique_ptr<ViewMap> grown;
+    std::size_t firstRetired = retiredViews_.size();
+    for (auto& [symbol, view] : changed) {
+        auto it = current->find(symbol);
+        ViewSlot* slot = it != current->end() ? it->second : nullptr;
+        if (slot == nullptr && grown) {
+            auto added = grown->find(symbol);
+            slot = added != grown->end() ? added->second : nullptr;
+        }
+        if (slot == nullptr) {
+            // A symbol seen for the first time: the only case that copies the map.
+            if (!grown) {
+                grown = std::make_unique<ViewMap>(*current);
+            }
+            viewSlots_.push_back(std::make_unique<ViewSlot>());
+            slot = viewSlots_.back().get();
+            (*grown)[symbol] = slot;
+        }
+        slot->view.store(view.get(), std::memory_order_seq_cst);
+        if (slot->owner) {
+            retiredViews_.emplace_back(0, std::move(slot->owner));
+        }
+        slot->owner = std::move(view);
+    }
+    const ViewMap* replaced = grown ? current_.exchange(grown.release(), std::memory_order_seq_cst) : nullptr;
+
+    // Everything replaced above was replaced in this epoch.
+    std::uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+    for (std::size_t i = firstRetired; i < retiredViews_.size(); i++) {
+        retiredViews_[i].first = epoch;
+    }
+    if (replaced != nullptr) {
+        retiredMaps_.emplace_back(epoch, replaced);
+    }
+    reclaim();
+}
+
+// A reader that announced epoch E may hold any view or map current in E, i.e.
+// one replaced in E or later; those replaced before every announced epoch are
+// free.
+void ViewPublisher::reclaim() {
+    std::uint64_t oldest = UINT64_MAX;
+    for (const ReaderSlot& slot : slots_) {
+        std::uint64_t epoch = slot.epoch.load(std::memory_order_seq_cst);
+        if (epoch != 0) {
+            oldest = std::min(oldest, epoch);
+        }
+    }
+    auto expired = [oldest](const auto& entry) { return entry.first < oldest; };
+    retiredViews_.erase(std::remove_if(retiredViews_.begin(), retiredViews_.end(), expired), retiredViews_.end());
+    retiredMaps_.erase(std::remove_if(retiredMaps_.begin(), retiredMaps_.end(), expired), retiredMaps_.end());
+}
+
+// Claims a free slot for the current epoch. The epoch is announced before the
+// map is loaded, both sequentially consistent: a publisher that then misses the
+// announcement has already swapped in a newer map, which is what gets loaded.
+ViewPublisher::ReaderSlot& ViewPublisher::pin() const {
+    std::size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+    for (;;) {
+        for (std::size_t i = 0; i < kReaderSlots; i++) {
+            ReaderSlot& slot = slots_[(start + i) % kReaderSlots];
+            std::uint64_t free = 0;
+            if (slot.epoch.load(std::memory_order_relaxed) == 0 &&
+                slot.epoch.compare_exchange_strong(free, epoch_.load(std::memory_order_seq_cst),
+                    std::memory_order_seq_cst)) {
+                return slot;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+const BookView& ViewPublisher::emptyView() {
+    static const BookView empty;
+    return empty;
+}
@@ -0,0 +1,119 @@
+#ifndef BOOK_VIEW_H
+#define BOOK_VIEW_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "order_book.h"
+
+//
+// Immutable copy of the top of one book as of one update: the best levels of
+// each side, aggregated and order by order, in priority order. Captured on the
+// shard thread and then only read, by any number of threads. Only the best
+// levels are copied so a capture costs the same however deep the book is.
+//
+struct BookView {
+    // Levels per side a view holds unless told otherwise.
+    static constexpr std::size_t kDefaultLevels = 100;
+
+    std::uint64_t sequence = 0;     // The book's updateSequence() when captured.
+    std::vector<Order> bids;        // Orders of the captured levels.
+    std::vector<Order> asks;
+    BookDepth levels;               // The captured levels of each side.
+    bool truncated = false;         // A side had levels beyond those captured.
+
+    static std::shared_ptr<const BookView> capture(const OrderBook& book, std::size_t levels = kDefaultLevels);
+
+    // The best `count` levels per side.
+    BookDepth depth(std::size_t count) const;
+};
+
+//
+// The latest BookView of every book of one shard. The shard thread publishes
+// new views; any thread reads them without a lock and without ever making the
+// publisher wait (RCU with epoch-based reclamation).
+//
+// Each symbol has a slot holding its latest view, found through an immutable
+// map from symbol to slot. Publishing a view is one atomic store into its
+// slot; the map is only copied and swapped in when a new symbol appears. A
+// reader announces the current epoch in a free reader slot before loading the
+// map and the view, and clears the slot when done. The publisher tags each
+// view (or map) it replaces with the epoch it was replaced in, then advances
+// the epoch; a replaced one is freed only once no reader slot announces an
+// epoch at or before its tag, so it is never freed under a reader. A reader
+// that holds a view for long only delays that, not publication.
+//
+class ViewPublisher {
+public:
+    // Readers that can hold views at the same time; more wait for a slot.
+    static constexpr std::size_t kReaderSlots = 64;
+
+    ViewPublisher() : current_(new ViewMap()) {}
+    ~ViewPublisher();
+
+    ViewPublisher(const ViewPublisher&) = delete;
+    ViewPublisher& operator=(const ViewPublisher&) = delete;
+
+    // Publisher side: replaces the views of the given symbols.
+    void publish(std::vector<std::pair<Symbol, std::shared_ptr<const BookView>>>& changed);
+
+    // Publisher side: replaced views and maps not freed yet.
+    std::size_t retiredCount() const { return retiredViews_.size() + retiredMaps_.size(); }
+
+    // Runs `fn(const BookView&)` on the latest view of `symbol` (an empty one
+    // if none was published) and returns its result. The view stays valid
+    // until `fn` returns.
+    template <typename Fn>
+    auto read(const Symbol& symbol, Fn fn) const -> decltype(fn(std::declval<const BookView&>())) {
+        ReadGuard guard(*this);
+        const ViewMap* views = current_.load(std::memory_order_seq_cst);
+        auto it = views->find(symbol);
+        const BookView* view = it != views->end() ? it->second->view.load(std::memory_order_seq_cst) : nullptr;
+        return fn(view != nullptr ? *view : emptyView());
+    }
+
+private:
+    // Where the latest view of one symbol is published. Slots live as long
+    // as the publisher, so a replaced map never points at a freed one.
+    struct ViewSlot {
+        std::atomic<const BookView*> view{ nullptr };
+        std::shared_ptr<const BookView> owner;      // Publisher only: keeps `view` alive.
+    };
+
+    using ViewMap = std::unordered_map<Symbol, ViewSlot*, SymbolHash>;
+
+    struct alignas(64) ReaderSlot {
+        std::atomic<std::uint64_t> epoch{ 0 };     // Announced epoch; 0 when free.
+    };
+
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const ViewPublisher& publisher) : slot_(publisher.pin()) {}
+        ~ReadGuard() { slot_.epoch.store(0, std::memory_order_release); }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+    private:
+        ReaderSlot& slot_;
+    };
+
+    ReaderSlot& pin() const;
+    void reclaim();
+    static const BookView& emptyView();
+
+    std::atomic<const ViewMap*> current_;
+    std::atomic<std::uint64_t> epoch_{ 1 };
+    mutable ReaderSlot slots_[kReaderSlots];
+
+    // Publisher only: every slot, and replaced views and maps with the epoch
+    // each was replaced in.
+    std::vector<std::unique_ptr<ViewSlot>> viewSlots_;
+    std::vector<std::pair<std::uint64_t, std::shared_ptr<const BookView>>> retiredViews_;
+    std::vector<std::pair<std::uint64_t, std::unique_ptr<const ViewMap>>> retiredMaps_;
+};
+
+#endif // BOOK_VIEW_H
@@ -0,0 +1,83 @@
+#include "client_feed.h"
+
+void ClientFeed::reset() {
+    queue_.clear();
+    levels_.clear();
+    conflating_ = false;
+}
+
+bool ClientFeed::offer(const FeedUpdatePtr& update) {
+    if (conflating_) {
+        fold(*update);
+        return levels_.size() <= limits_.maxLevels;
+    }
+    queue_.push_back(update);
+    // A client with a full window is not reading: keep only its level state.
+    if (queue_.size() > limits_.maxQueued || held()) {
+        startConflating();
+        return levels_.size() <= limits_.maxLevels;
+    }
+    return true;
+}
+
+void ClientFeed::drain(Clock::time_point now, const Conflater& conflate, std::vector<std::string>& out) {
+    if (!pending() || held() || now < nextDue()) {
+        return;
+    }
+    // A rate-limited client gets at most one message per interval.
+    if (!conflating_ && limits_.minInterval.count() > 0 && queue_.size() > 1) {
+        startConflating();
+    }
+    if (conflating_) {
+        std::vector<BookDelta> levels;
+        levels.reserve(levels_.size());
+        for (const auto& entry : levels_) {
+            levels.push_back(entry.second);
+        }
+        out.push_back(conflate(conflatedSequence_, levels));
+        sent(conflatedSequence_, out.back().size());
+        levels_.clear();
+        conflating_ = false;
+    }
+    else {
+        for (const FeedUpdatePtr& update : queue_) {
+            out.push_back(update->message);
+            sent(update->bookSequence, update->message.size());
+        }
+        queue_.clear();
+    }
+    lastSent_ = now;
+}
+
+void ClientFeed::sent(std::uint64_t sequence, std::size_t bytes) {
+    if (limits_.maxUnackedBytes == 0) {
+        return;     // Nothing will acknowledge it.
+    }
+    inFlight_.emplace_back(sequence, bytes);
+    unacked_ += bytes;
+}
+
+void ClientFeed::acknowledge(std::uint64_t sequence) {
+    while (!inFlight_.empty() && inFlight_.front().first <= sequence) {
+        unacked_ -= inFlight_.front().second;
+        inFlight_.pop_front();
+    }
+}
+
+// Fold the queued updates into the level map and conflate from here on.
+void ClientFeed::startConflating() {
+    conflating_ = true;
+    for (const FeedUpdatePtr& update : queue_) {
+        fold(*update);
+    }
+    queue_.clear();
+}
+
+void ClientFeed::fold(const FeedUpdate& update) {
+    for (const BookDelta& delta : update.deltas) {
+        if (delta.type == BookDelta::Type::LEVEL) {
+            levels_[{ delta.side, delta.price }] = delta;
+        }
+    }
+    conflatedSequence_ = update.bookSequence;
+}
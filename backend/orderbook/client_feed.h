@@ -0,0 +1,108 @@
+#ifndef CLIENT_FEED_H
+#define CLIENT_FEED_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "order_book.h"
+
+// One book update as published to market data clients: serialized once and
+// shared by every subscriber's queue.
+struct FeedUpdate {
+    std::uint64_t bookSequence = 0;
+    std::vector<BookDelta> deltas;
+    std::string message;
+};
+
+using FeedUpdatePtr = std::shared_ptr<const FeedUpdate>;
+
+//
+// Outbound state of one market data subscriber. Updates are queued as shared
+// messages while the client keeps up. When its queue overflows, or more than
+// one update arrives within its minimum send interval, the client is switched
+// to conflation: only the latest state of each changed price level is kept
+// and sent as a single message once the client may send again. A client whose
+// conflated backlog grows past maxLevels is too far behind and is dropped.
+//
+// A client that acknowledges what it has processed gets a window instead:
+// once maxUnackedBytes have been sent without an acknowledgement, nothing
+// more is sent and its updates are conflated until it catches up, so a
+// client that stops reading costs one level map, not an ever-growing socket
+// buffer. Only used by the publisher thread.
+//
+class ClientFeed {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Serializes conflated levels (sorted by side, then price) as of `sequence`.
+    using Conflater = std::function<std::string(std::uint64_t sequence, const std::vector<BookDelta>& levels)>;
+
+    struct Limits {
+        std::size_t maxQueued = 256;                    // Updates held before conflating.
+        std::size_t maxLevels = 4096;                   // Conflated levels before dropping.
+        std::chrono::milliseconds minInterval{ 0 };     // Per-client rate limit; 0 = none.
+        std::size_t maxUnackedBytes = 0;                // Window; 0 = the client sends no acks.
+    };
+
+    ClientFeed() = default;
+    explicit ClientFeed(const Limits& limits) : limits_(limits) {}
+
+    // Forgets everything pending, e.g. after the client was sent a snapshot.
+    void reset();
+
+    // Queues or conflates one update. Returns false if the client has fallen
+    // too far behind and should be dropped.
+    bool offer(const FeedUpdatePtr& update);
+
+    // Appends the messages that may be sent at `now` to `out`.
+    void drain(Clock::time_point now, const Conflater& conflate, std::vector<std::string>& out);
+
+    // Counts a message sent to the client outside drain(), e.g. a snapshot,
+    // against its window.
+    void sent(std::uint64_t sequence, std::size_t bytes);
+
+    // The client has processed every message up to `sequence`.
+    void acknowledge(std::uint64_t sequence);
+
+    // True while the client's window is full.
+    bool held() const { return limits_.maxUnackedBytes != 0 && unacked_ >= limits_.maxUnackedBytes; }
+
+    std::size_t unackedBytes() const { return unacked_; }
+
+    // True if drain() has something to send, now or once the interval passes.
+    bool pending() const { return conflating_ || !queue_.empty(); }
+
+    // Earliest time drain() will send what is pending (never while held).
+    Clock::time_point nextDue() const {
+        return held() ? Clock::time_point::max() : lastSent_ + limits_.minInterval;
+    }
+
+    bool conflating() const { return conflating_; }
+
+private:
+    void startConflating();
+    void fold(const FeedUpdate& update);
+
+    Limits limits_;
+    std::deque<FeedUpdatePtr> queue_;
+
+    // Latest state per (side, price) while conflating.
+    std::map<std::pair<OrderType, Price>, BookDelta> levels_;
+    bool conflating_ = false;
+    std::uint64_t conflatedSequence_ = 0;
+
+    Clock::time_point lastSent_{};
+
+    // Messages sent but not acknowledged, as (sequence, bytes), oldest first.
+    std::deque<std::pair<std::uint64_t, std::size_t>> inFlight_;
+    std::size_t unacked_ = 0;
+};
+
+#endif // CLIENT_FEED_H
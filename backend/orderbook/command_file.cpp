@@ -0,0 +1,310 @@
+#include "command_file.h"
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "journal.h"
+
+namespace {
+
+// Splits one CSV line; no quoting is needed for this format.
+std::vector<std::string> splitFields(const std::string& line) {
+    std::vector<std::string> fields;
+    std::string field;
+    std::istringstream stream(line);
+    while (std::getline(stream, field, ',')) {
+        fields.push_back(field);
+    }
+    if (!line.empty() && line.back() == ',') {
+        fields.emplace_back();
+    }
+    return fields;
+}
+
+bool parseInteger(const std::string& text, long long& value) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    value = std::strtoll(text.c_str(), &end, 10);
+    return *end == '\0';
+}
+
+// Applies an add's '|'-separated options to `order`.
+bool parseOptions(const std::string& text, Order& order) {
+    std::istringstream stream(text);
+    std::string option;
+    while (std::getline(stream, option, '|')) {
+        if (option == "GTC") {
+            order.timeInForce = TimeInForce::GTC;
+        }
+        else if (option == "IOC") {
+            order.timeInForce = TimeInForce::IOC;
+        }
+        else if (option == "FOK") {
+            order.timeInForce = TimeInForce::FOK;
+        }
+        else if (option == "MARKET") {
+            order.flags |= ORDER_MARKET;
+        }
+        else if (option == "POST_ONLY") {
+            order.flags |= ORDER_POST_ONLY;
+        }
+        else if (!option.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string formatOptions(const Order& order) {
+    std::string text;
+    auto add = [&text](const char* option) {
+        text += text.empty() ? "" : "|";
+        text += option;
+    };
+    if (order.GetTimeInForce() == TimeInForce::IOC) {
+        add("IOC");
+    }
+    else if (order.GetTimeInForce() == TimeInForce::FOK) {
+        add("FOK");
+    }
+    if (order.IsMarket()) {
+        add("MARKET");
+    }
+    if (order.IsPostOnly()) {
+        add("POST_ONLY");
+    }
+    return text;
+}
+
+bool parsePrice(const std::string& text, double& value) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return *end == '\0';
+}
+
+// Orders take their arrival time from the file, never from the clock, so a
+// replay is the same on every run.
+std::chrono::system_clock::time_point timePoint(std::int64_t nanos) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(nanos)));
+}
+
+RecordedCommand fromRecord(const JournalRecord& record) {
+    RecordedCommand recorded;
+    recorded.timestamp = record.timestamp;
+    BookCommand& command = recorded.command;
+    char symbol[sizeof(record.symbol) + 1] = {};
+    std::memcpy(symbol, record.symbol, sizeof(record.symbol));
+    command.orderId = record.orderId;
+    if (record.type == JournalRecord::ADD) {
+        command.type = BookCommand::Type::ADD;
+        command.order = Order(record.orderId, record.price, record.quantity,
+            record.side == 0 ? OrderType::BUY : OrderType::SELL, Symbol(symbol));
+        command.order.timeInForce = static_cast<TimeInForce>(record.timeInForce);
+        command.order.flags = record.flags;
+        command.order.stopPrice = record.stopPrice;
+        command.order.owner = record.owner;
+    }
+    else {
+        command.type = record.type == JournalRecord::MODIFY ? BookCommand::Type::MODIFY : BookCommand::Type::CANCEL;
+        command.order.price = record.price;
+        command.order.quantity = record.quantity;
+        command.order.symbol = Symbol(symbol);
+    }
+    return recorded;
+}
+
+JournalRecord toRecord(std::uint64_t sequence, const RecordedCommand& recorded) {
+    const BookCommand& command = recorded.command;
+    JournalRecord record;
+    record.sequence = sequence;
+    record.timestamp = recorded.timestamp;
+    std::memcpy(record.symbol, command.order.symbol.c_str(), sizeof(record.symbol));
+    if (command.type == BookCommand::Type::ADD) {
+        const Order& order = command.order;
+        record.type = JournalRecord::ADD;
+        record.side = order.GetSide() == OrderType::BUY ? 0 : 1;
+        record.orderId = order.GetOrderId();
+        record.quantity = order.quantity;
+        record.price = order.GetPrice();
+        record.timeInForce = static_cast<std::uint8_t>(order.GetTimeInForce());
+        record.flags = order.flags;
+        record.stopPrice = order.stopPrice;
+        record.owner = order.owner;
+    }
+    else if (command.type == BookCommand::Type::MODIFY) {
+        record.type = JournalRecord::MODIFY;
+        record.orderId = command.orderId;
+        record.quantity = command.order.quantity;
+        record.price = command.order.GetPrice();
+    }
+    else {
+        record.type = JournalRecord::CANCEL;
+        record.orderId = command.orderId;
+    }
+    record.seal();
+    return record;
+}
+
+bool readBinaryCommands(std::istream& in, const std::string& path, std::vector<RecordedCommand>& commands,
+    std::string& error) {
+    JournalHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.version != JournalHeader().version) {
+        error = path + ": unsupported journal version";
+        return false;
+    }
+    JournalRecord record;
+    std::int64_t timestamp = 0;
+    while (in.read(reinterpret_cast<char*>(&record), sizeof(record)) && record.valid()) {
+        if (record.type == JournalRecord::ROTATE) {
+            continue;
+        }
+        RecordedCommand recorded = fromRecord(record);
+        if (recorded.timestamp == 0) {
+            recorded.timestamp = timestamp;
+        }
+        timestamp = recorded.timestamp;
+        recorded.command.order.timestamp = timePoint(timestamp);
+        commands.push_back(recorded);
+    }
+    return true;
+}
+
+} // namespace
+
+bool readCommandFile(const std::string& path, std::vector<RecordedCommand>& commands, std::string& error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    const JournalHeader journal;
+    char magic[sizeof(journal.magic)] = {};
+    in.read(magic, sizeof(magic));
+    in.clear();
+    in.seekg(0);
+    if (std::memcmp(magic, journal.magic, sizeof(magic)) == 0) {
+        return readBinaryCommands(in, path, commands, error);
+    }
+    std::string line;
+    std::size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::vector<std::string> fields = splitFields(line);
+        long long timestamp = 0;
+        long long orderId = 0;
+        if (fields.size() < 3 || fields.size() > 8 || !parseInteger(fields[0], timestamp)
+            || !parseInteger(fields[2], orderId)) {
+            error = path + ":" + std::to_string(lineNumber) + ": malformed command";
+            return false;
+        }
+        fields.resize(8);
+
+        RecordedCommand recorded;
+        recorded.timestamp = timestamp;
+        BookCommand& command = recorded.command;
+        command.orderId = static_cast<OrderId>(orderId);
+        if (fields[1] == "A") {
+            long long quantity = 0;
+            double price = 0.0;
+            if ((fields[3] != "B" && fields[3] != "S") || !parsePrice(fields[4], price)
+                || !parseInteger(fields[5], quantity)) {
+                error = path + ":" + std::to_string(lineNumber) + ": malformed add";
+                return false;
+            }
+            command.type = BookCommand::Type::ADD;
+            command.order = Order(command.orderId, price, static_cast<int>(quantity),
+                fields[3] == "B" ? OrderType::BUY : OrderType::SELL, Symbol(fields[6]));
+            command.order.timestamp = timePoint(timestamp);
+            if (!parseOptions(fields[7], command.order)) {
+                error = path + ":" + std::to_string(lineNumber) + ": unknown option in '" + fields[7] + "'";
+                return false;
+            }
+        }
+        else if (fields[1] == "X") {
+            command.type = BookCommand::Type::CANCEL;
+            command.order.symbol = Symbol(fields[6]);
+        }
+        else if (fields[1] == "M") {
+            long long quantity = 0;
+            double price = 0.0;
+            if (!parsePrice(fields[4], price) || !parseInteger(fields[5], quantity)) {
+                error = path + ":" + std::to_string(lineNumber) + ": malformed modify";
+                return false;
+            }
+            command.type = BookCommand::Type::MODIFY;
+            command.order.price = price;
+            command.order.quantity = static_cast<int>(quantity);
+            command.order.symbol = Symbol(fields[6]);
+        }
+        else {
+            error = path + ":" + std::to_string(lineNumber) + ": unknown action '" + fields[1] + "'";
+            return false;
+        }
+        commands.push_back(recorded);
+    }
+    return true;
+}
+
+bool writeCommandFile(const std::string& path, const std::vector<RecordedCommand>& commands) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+    out << "# timestamp_ns,action,orderID,side,price,quantity,symbol,options\n";
+    char price[32];
+    for (const RecordedCommand& recorded : commands) {
+        const BookCommand& command = recorded.command;
+        out << recorded.timestamp << ',';
+        if (command.type == BookCommand::Type::ADD) {
+            const Order& order = command.order;
+            auto written = std::to_chars(price, price + sizeof(price), order.GetPrice());
+            out << "A," << order.GetOrderId() << ',' << (order.GetSide() == OrderType::BUY ? 'B' : 'S') << ','
+                << std::string(price, written.ptr) << ',' << order.quantity << ',' << order.symbol.c_str();
+            std::string options = formatOptions(order);
+            if (!options.empty()) {
+                out << ',' << options;
+            }
+            out << '\n';
+        }
+        else if (command.type == BookCommand::Type::MODIFY) {
+            auto written = std::to_chars(price, price + sizeof(price), command.order.GetPrice());
+            out << "M," << command.orderId << ",," << std::string(price, written.ptr) << ','
+                << command.order.quantity << ',' << command.order.symbol.c_str() << '\n';
+        }
+        else {
+            out << "X," << command.orderId << ",,,," << command.order.symbol.c_str() << '\n';
+        }
+    }
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+bool writeBinaryCommandFile(const std::string& path, const std::vector<RecordedCommand>& commands) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+    JournalHeader header;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::uint64_t sequence = 0;
+    for (const RecordedCommand& recorded : commands) {
+        JournalRecord record = toRecord(++sequence, recorded);
+        out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+    out.flush();
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,48 @@
+#ifndef COMMAND_FILE_H
+#define COMMAND_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "order_book.h"
+
+//
+// Recorded order flow: a plain CSV of book commands, one per line, that can
+// be written by a benchmark or capture and replayed against a book to check
+// a change against the same input.
+//
+//   # timestamp_ns,action,orderID,side,price,quantity,symbol,options
+//   1000,A,1,B,100.25,10,AAPL      add: side B(uy) or S(ell)
+//   1200,A,2,S,0,5,AAPL,MARKET|IOC
+//   1850,X,1,,,,AAPL               cancel
+//   1900,M,2,,100.30,4,AAPL        modify: new price and quantity
+//
+// Lines starting with '#' and blank lines are ignored; the symbol column may
+// be left empty for the default book. The optional options column lists an
+// add's time in force (IOC, FOK; GTC when absent) and flags (MARKET,
+// POST_ONLY), separated by '|'.
+//
+// The binary form is a journal segment (see journal.h): a JournalHeader and
+// one sealed JournalRecord per command, so a shard's captured journal can be
+// replayed as it is.
+//
+struct RecordedCommand {
+    std::int64_t timestamp = 0;     // Nanoseconds; only the differences matter.
+    BookCommand command;            // An add's order carries `timestamp` too.
+};
+
+// Reads every command in `path`, CSV or binary (told apart by the journal
+// magic). Returns false, with a message naming the offending line or record
+// in `error`, if the file cannot be read or parsed. A binary file is read up
+// to its first torn or corrupt record, like journal recovery does; records
+// without a timestamp (older journals only stamped adds) take the previous one.
+bool readCommandFile(const std::string& path, std::vector<RecordedCommand>& commands, std::string& error);
+
+// Writes `commands` to `path` in the format read by readCommandFile. Prices
+// are written with the fewest digits that read back exactly.
+bool writeCommandFile(const std::string& path, const std::vector<RecordedCommand>& commands);
+
+// Writes `commands` to `path` in the binary form, sequenced from 1.
+bool writeBinaryCommandFile(const std::string& path, const std::vector<RecordedCommand>& commands);
+
+#endif // COMMAND_FILE_H
@@ -0,0 +1,294 @@
+#include "journal.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Records buffered per shard before the matching thread has to wait for the writer.
+constexpr std::size_t kRingCapacity = 1 << 16;
+
+// Records written per pass before durability is re-evaluated.
+constexpr std::size_t kMaxWriteBatch = 4096;
+
+// Writer poll interval when the ring is empty.
+constexpr std::chrono::microseconds kIdleSleep{ 50 };
+
+std::uint32_t fnv1a(const void* data, std::size_t length) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    std::uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Push the stdio buffer to the OS and the OS cache to the device.
+bool flushToDisk(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// The writer could not get records to the file. Nothing appended from here on
+// could be made durable and acknowledging it would lose it on restart, so
+// refuse to run undurable.
+[[noreturn]] void writeFailed(const char* what) {
+    std::fprintf(stderr, "journal: %s failed: %s\n", what, std::strerror(errno));
+    std::abort();
+}
+
+std::string segmentPath(const std::string& directory, std::uint32_t shardIndex, std::uint64_t firstSequence) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "journal-%u-%020llu.bin", shardIndex,
+        static_cast<unsigned long long>(firstSequence));
+    return (std::filesystem::path(directory) / name).string();
+}
+
+// The shard's segments, oldest first, as (first sequence, path).
+std::vector<std::pair<std::uint64_t, std::string>> listSegments(const std::string& directory, std::uint32_t shardIndex) {
+    std::vector<std::pair<std::uint64_t, std::string>> segments;
+    std::string prefix = "journal-" + std::to_string(shardIndex) + "-";
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() > prefix.size() + 4 && name.compare(0, prefix.size(), prefix) == 0
+            && name.compare(name.size() - 4, 4, ".bin") == 0) {
+            std::uint64_t first = std::strtoull(name.c_str() + prefix.size(), nullptr, 10);
+            segments.emplace_back(first, entry.path().string());
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+} // namespace
+
+void JournalRecord::seal() {
+    checksum = fnv1a(this, sizeof(JournalRecord) - sizeof(checksum));
+}
+
+bool JournalRecord::valid() const {
+    return (type == ADD || type == CANCEL || type == MODIFY)
+        && checksum == fnv1a(this, sizeof(JournalRecord) - sizeof(checksum));
+}
+
+Journal::Journal()
+    : ring_(kRingCapacity) {
+}
+
+Journal::~Journal() {
+    close();
+}
+
+bool Journal::replay(const std::string& directory, std::uint32_t shardIndex, std::uint32_t shardCount,
+    std::uint64_t afterSequence, const std::function<void(const JournalRecord&)>& apply) {
+    auto segments = listSegments(directory, shardIndex);
+    for (std::size_t s = 0; s < segments.size(); s++) {
+        bool last = s + 1 == segments.size();
+        if (!last && segments[s + 1].first <= afterSequence + 1) {
+            continue;  // Entirely covered by the snapshot.
+        }
+        const std::string& path = segments[s].second;
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            return false;
+        }
+
+        JournalHeader header;
+        JournalHeader expected;
+        std::uintmax_t validBytes = 0;
+        if (std::fread(&header, sizeof(header), 1, file) == 1) {
+            if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+                || header.version != expected.version
+                || header.shardIndex != shardIndex
+                || header.shardCount != shardCount) {
+                std::fclose(file);
+                return false;
+            }
+            validBytes = sizeof(header);
+
+            // Stop at the first record that is short or fails its checksum:
+            // that is where the process died mid-write.
+            JournalRecord record;
+            while (std::fread(&record, sizeof(record), 1, file) == 1 && record.valid()) {
+                if (record.sequence > afterSequence) {
+                    apply(record);
+                }
+                validBytes += sizeof(record);
+            }
+        }
+        std::fclose(file);
+
+        std::error_code error;
+        if (std::filesystem::file_size(path, error) != validBytes) {
+            if (!last) {
+                return false;  // Only the newest segment can have been torn.
+            }
+            std::filesystem::resize_file(path, validBytes, error);
+        }
+        if (error) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Journal::open(const std::string& directory, std::uint32_t shardIndex, std::uint32_t shardCount,
+    Durability durability, std::chrono::microseconds batchInterval, std::uint64_t lastSequence) {
+    close();
+    directory_ = directory;
+    shardIndex_ = shardIndex;
+    shardCount_ = shardCount;
+    auto segments = listSegments(directory, shardIndex);
+    if (!openSegment(segments.empty() ? lastSequence + 1 : segments.back().first)) {
+        return false;
+    }
+
+    durability_ = durability;
+    batchInterval_ = batchInterval;
+    durable_.store(lastSequence);
+    stopping_.store(false);
+    writer_ = std::thread([this] { run(); });
+    return true;
+}
+
+// Open (or create, header first) the segment starting at `firstSequence`.
+bool Journal::openSegment(std::uint64_t firstSequence) {
+    file_ = std::fopen(segmentPath(directory_, shardIndex_, firstSequence).c_str(), "ab");
+    if (file_ == nullptr) {
+        return false;
+    }
+    std::setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+    segmentFirst_.store(firstSequence);
+    if (std::ftell(file_) == 0) {
+        JournalHeader header;
+        header.shardIndex = shardIndex_;
+        header.shardCount = shardCount_;
+        if (std::fwrite(&header, sizeof(header), 1, file_) != 1 || !flushToDisk(file_)) {
+            std::fclose(file_);
+            file_ = nullptr;
+            return false;
+        }
+    }
+    return true;
+}
+
+void Journal::close() {
+    if (writer_.joinable()) {
+        stopping_.store(true);
+        writer_.join();
+    }
+    if (file_ != nullptr) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+void Journal::append(const JournalRecord& record) {
+    while (!ring_.tryPush(record)) {
+        std::this_thread::yield();  // Writer is behind: backpressure instead of dropping.
+    }
+}
+
+void Journal::rotate(std::uint64_t nextSequence) {
+    JournalRecord marker;
+    marker.type = JournalRecord::ROTATE;
+    marker.sequence = nextSequence;
+    append(marker);
+}
+
+void Journal::prune(std::uint64_t sequence) {
+    auto segments = listSegments(directory_, shardIndex_);
+    std::uint64_t open = segmentFirst_.load();
+    for (std::size_t s = 0; s + 1 < segments.size(); s++) {
+        if (segments[s].first < open && segments[s + 1].first <= sequence + 1) {
+            std::error_code error;
+            std::filesystem::remove(segments[s].second, error);
+        }
+    }
+}
+
+void Journal::waitDurable(std::uint64_t sequence) {
+    if (durability_ == Durability::NONE || durable_.load(std::memory_order_acquire) >= sequence) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(durableMutex_);
+    durableChanged_.wait(lock, [this, sequence] {
+        return durable_.load(std::memory_order_acquire) >= sequence;
+    });
+}
+
+// Writer loop: drain, write, and group-commit according to the durability level.
+void Journal::run() {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point lastSync = Clock::now() - batchInterval_;
+    std::uint64_t written = durable_.load();
+    bool dirty = false;
+    JournalRecord record;
+
+    for (;;) {
+        std::size_t count = 0;
+        while (count < kMaxWriteBatch && ring_.tryPop(record)) {
+            count++;
+            if (record.type == JournalRecord::ROTATE) {
+                // Close the current segment durably, then continue in a new one.
+                bool closed = flushToDisk(file_);
+                closed = std::fclose(file_) == 0 && closed;
+                file_ = nullptr;
+                if (!closed) {
+                    writeFailed("closing a segment");
+                }
+                if (!openSegment(record.sequence)) {
+                    writeFailed("opening a segment");
+                }
+                continue;
+            }
+            if (std::fwrite(&record, sizeof(record), 1, file_) != 1) {
+                writeFailed("write");
+            }
+            written = record.sequence;
+            dirty = true;
+        }
+
+        bool stopping = stopping_.load();
+        Clock::time_point now = Clock::now();
+        bool due = durability_ != Durability::BATCH || now - lastSync >= batchInterval_;
+        if (dirty && (due || stopping)) {
+            // durable_ only advances past records that really reached the file.
+            bool flushed = durability_ == Durability::NONE ? std::fflush(file_) == 0 : flushToDisk(file_);
+            if (!flushed) {
+                writeFailed(durability_ == Durability::NONE ? "flush" : "fsync");
+            }
+            lastSync = now;
+            dirty = false;
+            {
+                std::lock_guard<std::mutex> lock(durableMutex_);
+                durable_.store(written, std::memory_order_release);
+            }
+            durableChanged_.notify_all();
+        }
+
+        if (count == 0) {
+            if (stopping && ring_.empty() && !dirty) {
+                return;
+            }
+            std::this_thread::sleep_for(kIdleSleep);
+        }
+    }
+}
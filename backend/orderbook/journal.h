@@ -0,0 +1,140 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "spsc_ring.h"
+
+// How hard the journal tries before a command is acknowledged.
+enum class Durability {
+    NONE,   // Written asynchronously, never fsync'd; acks do not wait.
+    BATCH,  // Group commit: fsync at most every batchInterval; acks wait for it.
+    SYNC    // fsync after every write pass; acks wait for it.
+};
+
+// Where and how a MatchingEngine journals its shards.
+struct JournalConfig {
+    std::string directory;                              // One file per shard.
+    Durability durability = Durability::BATCH;
+    std::chrono::microseconds batchInterval{ 1000 };    // BATCH only.
+};
+
+// One accepted command, fixed layout, little-endian on every supported target.
+#pragma pack(push, 1)
+struct JournalRecord {
+    enum Type : std::uint8_t {
+        ADD = 1,
+        CANCEL = 2,
+        ROTATE = 3,     // In-memory only: tells the writer to start a new segment.
+        MODIFY = 4      // New price and quantity for `orderId`.
+    };
+
+    std::uint64_t sequence = 0;
+    std::uint8_t type = 0;
+    std::uint8_t side = 0;        // 0 = BUY, 1 = SELL
+    std::uint8_t timeInForce = 0; // TimeInForce of an ADD.
+    std::uint8_t flags = 0;       // OrderFlag bits of an ADD.
+    std::int32_t orderId = 0;
+    std::int32_t quantity = 0;
+    double price = 0.0;
+    std::int64_t timestamp = 0;   // Nanoseconds since the epoch.
+    double stopPrice = 0.0;       // Trigger price of a stop ADD.
+    char symbol[16] = {};
+    std::uint32_t owner = 0;      // OwnerId of an ADD.
+    std::uint32_t checksum = 0;   // FNV-1a of every byte above.
+
+    void seal();
+    bool valid() const;
+};
+
+// First bytes of every journal file.
+struct JournalHeader {
+    char magic[4] = { 'O', 'B', 'J', '1' };
+    std::uint32_t version = 3;
+    std::uint32_t shardIndex = 0;
+    std::uint32_t shardCount = 1;
+};
+#pragma pack(pop)
+
+//
+// Append-only write-ahead journal for one shard. The matching thread calls
+// append(), which only copies the record into a lock-free SPSC ring; a
+// dedicated writer thread drains the ring, writes whole batches and fsyncs
+// according to the durability level (group commit). Acknowledging threads
+// call waitDurable() before replying.
+// A write, flush or fsync the writer cannot complete aborts the process:
+// waitDurable() never reports a sequence that did not reach the file.
+//
+// The journal is split into segments named after the first sequence they
+// hold (journal-<shard>-<first>.bin). A new segment is started after every
+// snapshot, so recovery only reads the segments past the snapshot.
+//
+class Journal {
+public:
+    Journal();
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Replays, in order, every intact record of the shard's segments in
+    // `directory` whose sequence is above `afterSequence`, skipping segments
+    // that lie entirely at or below it, and cuts off a torn tail. No segments
+    // means an empty journal. Returns false if a segment belongs to a
+    // different shard layout or cannot be read.
+    static bool replay(const std::string& directory, std::uint32_t shardIndex, std::uint32_t shardCount,
+        std::uint64_t afterSequence, const std::function<void(const JournalRecord&)>& apply);
+
+    // Opens the shard's newest segment in `directory` for appending (or
+    // starts one) and the writer thread. `lastSequence` is the last sequence
+    // already applied to the books.
+    bool open(const std::string& directory, std::uint32_t shardIndex, std::uint32_t shardCount,
+        Durability durability, std::chrono::microseconds batchInterval, std::uint64_t lastSequence);
+
+    // Flushes everything appended so far and stops the writer thread.
+    void close();
+
+    // Matching thread only: queue a sealed record. Never blocks on I/O.
+    void append(const JournalRecord& record);
+
+    // Matching thread only: records from `nextSequence` on go to a new segment.
+    void rotate(std::uint64_t nextSequence);
+
+    // Deletes closed segments holding nothing after `sequence` (covered by a
+    // durable snapshot). The segment being written is never touched.
+    void prune(std::uint64_t sequence);
+
+    // Blocks until `sequence` is as durable as the configured level requires.
+    void waitDurable(std::uint64_t sequence);
+
+    Durability durability() const { return durability_; }
+
+private:
+    void run();
+    bool openSegment(std::uint64_t firstSequence);
+
+    SpscRing<JournalRecord> ring_;
+    std::FILE* file_ = nullptr;
+    std::string directory_;
+    std::uint32_t shardIndex_ = 0;
+    std::uint32_t shardCount_ = 1;
+    std::atomic<std::uint64_t> segmentFirst_{ 0 };    // First sequence of the open segment.
+    Durability durability_ = Durability::BATCH;
+    std::chrono::microseconds batchInterval_{ 1000 };
+    std::thread writer_;
+    std::atomic<bool> stopping_{ false };
+
+    // Highest sequence that satisfies the durability level.
+    std::atomic<std::uint64_t> durable_{ 0 };
+    std::mutex durableMutex_;
+    std::condition_variable durableChanged_;
+};
+
+#endif // JOURNAL_H
@@ -0,0 +1,120 @@
+#include "json_writer.h"
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+constexpr std::int64_t kFractionScale = 1000000;   // "%f" prints six decimals.
+
+// Below this magnitude the scaled value is under 2^44, so its rounding error
+// (half an ulp, at most 2^-9) can only decide a tie it lands within 2^-6 of;
+// those and larger values go through snprintf.
+constexpr double kFixedPointLimit = 1.0e7;
+constexpr double kTieMargin = 1.0 / 64;
+
+// Appends the six-digit fraction `fraction` without its trailing zeros, but
+// always with at least one digit, as crow's dump() trims "%f" output.
+void appendFraction(std::string& out, std::int64_t fraction) {
+    char digits[6];
+    for (int i = 5; i >= 0; i--) {
+        digits[i] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+    }
+    int length = 6;
+    while (length > 1 && digits[length - 1] == '0') {
+        length--;
+    }
+    out.append(digits, static_cast<std::size_t>(length));
+}
+
+// The general case, as crow formats it: "%f" into a 128-byte buffer, then
+// trailing zeros dropped after the first decimal.
+void appendPrintf(std::string& out, double number) {
+    char buffer[128];
+    std::snprintf(buffer, sizeof(buffer), "%f", number);
+    char* point = nullptr;
+    for (char* p = buffer; *p != '\0'; p++) {
+        if (*p == '.') {
+            point = p;
+            break;
+        }
+    }
+    std::size_t length = std::char_traits<char>::length(buffer);
+    if (point != nullptr && point[1] != '\0') {
+        char* end = buffer + length;
+        while (end > point + 2 && end[-1] == '0') {
+            end--;
+        }
+        length = static_cast<std::size_t>(end - buffer);
+    }
+    out.append(buffer, length);
+}
+
+} // namespace
+
+JsonWriter JsonWriter::threadLocal() {
+    static thread_local std::string buffer;
+    buffer.clear();
+    return JsonWriter(buffer);
+}
+
+void JsonWriter::writeInteger(long long number) {
+    char digits[24];
+    auto written = std::to_chars(digits, digits + sizeof(digits), number);
+    out_.append(digits, written.ptr);
+}
+
+void JsonWriter::writeUnsigned(unsigned long long number) {
+    char digits[24];
+    auto written = std::to_chars(digits, digits + sizeof(digits), number);
+    out_.append(digits, written.ptr);
+}
+
+void JsonWriter::writeDouble(double number) {
+    if (!std::isfinite(number)) {
+        out_ += "null";
+        return;
+    }
+    double scaled = std::fabs(number) * static_cast<double>(kFractionScale);
+    double remainder = scaled - std::floor(scaled);
+    if (std::fabs(number) >= kFixedPointLimit || std::fabs(remainder - 0.5) <= kTieMargin) {
+        appendPrintf(out_, number);
+        return;
+    }
+    // Round to micro-units as "%f" does, then print the integer and fraction
+    // parts as integers.
+    auto units = static_cast<std::int64_t>(remainder < 0.5 ? std::floor(scaled) : std::ceil(scaled));
+    if (std::signbit(number)) {
+        out_ += '-';
+    }
+    writeInteger(units / kFractionScale);
+    out_ += '.';
+    appendFraction(out_, units % kFractionScale);
+}
+
+void JsonWriter::writeString(std::string_view text) {
+    static const char kHex[] = "0123456789abcdef";
+    out_ += '"';
+    for (char c : text) {
+        switch (c) {
+        case '"': out_ += "\\\""; break;
+        case '\\': out_ += "\\\\"; break;
+        case '\n': out_ += "\\n"; break;
+        case '\b': out_ += "\\b"; break;
+        case '\f': out_ += "\\f"; break;
+        case '\r': out_ += "\\r"; break;
+        case '\t': out_ += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                out_ += "\\u00";
+                out_ += kHex[(c >> 4) & 0xf];
+                out_ += kHex[c & 0xf];
+            }
+            else {
+                out_ += c;
+            }
+        }
+    }
+    out_ += '"';
+}
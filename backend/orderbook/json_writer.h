@@ -0,0 +1,78 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+//
+// Streaming JSON serializer for market data and order responses. Values are
+// appended straight to a caller-owned string, with no intermediate document,
+// so a message costs no allocation once its buffer has grown to size; use
+// threadLocal() for a buffer reused by every message built on the thread.
+//
+// The output matches what crow::json::wvalue::dump() produced for the same
+// values, so clients see the same bytes apart from key order: integers in
+// full, doubles as "%f" with the trailing zeros trimmed (keeping one digit
+// after the point), non-finite doubles as null, and strings escaped alike.
+//
+// Callers keep the structure well formed: a key() must be followed by a
+// value or a begin*(), and every begin*() closed by its end*().
+//
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out_(out) {}
+
+    // A writer over the calling thread's reusable buffer, emptied. Its text
+    // is valid until the next threadLocal() call on the same thread.
+    static JsonWriter threadLocal();
+
+    JsonWriter& beginObject() { separate(); out_ += '{'; first_ = true; return *this; }
+    JsonWriter& endObject() { out_ += '}'; first_ = false; return *this; }
+    JsonWriter& beginArray() { separate(); out_ += '['; first_ = true; return *this; }
+    JsonWriter& endArray() { out_ += ']'; first_ = false; return *this; }
+
+    JsonWriter& key(std::string_view name) {
+        separate();
+        writeString(name);
+        out_ += ':';
+        first_ = true;
+        return *this;
+    }
+
+    JsonWriter& value(int number) { return value(static_cast<long long>(number)); }
+    JsonWriter& value(unsigned number) { return value(static_cast<unsigned long long>(number)); }
+    JsonWriter& value(long number) { return value(static_cast<long long>(number)); }
+    JsonWriter& value(unsigned long number) { return value(static_cast<unsigned long long>(number)); }
+    JsonWriter& value(long long number) { separate(); writeInteger(number); return *this; }
+    JsonWriter& value(unsigned long long number) { separate(); writeUnsigned(number); return *this; }
+    JsonWriter& value(double number) { separate(); writeDouble(number); return *this; }
+    JsonWriter& value(bool flag) { separate(); out_ += flag ? "true" : "false"; return *this; }
+    JsonWriter& value(std::string_view text) { separate(); writeString(text); return *this; }
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+
+    // key(name) followed by value(v).
+    template <typename T>
+    JsonWriter& field(std::string_view name, const T& v) { key(name); return value(v); }
+
+    const std::string& str() const { return out_; }
+
+private:
+    void separate() {
+        if (!first_) {
+            out_ += ',';
+        }
+        first_ = false;
+    }
+
+    void writeInteger(long long number);
+    void writeUnsigned(unsigned long long number);
+    void writeDouble(double number);
+    void writeString(std::string_view text);
+
+    std::string& out_;
+    bool first_ = true;     // Nothing written yet at this level: no comma due.
+};
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,62 @@
+#include "latency_histogram.h"
+#include <algorithm>
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (std::size_t i = 0; i < kBucketCount; i++) {
+        std::uint64_t counted = load(other.counts_[i]);
+        if (counted != 0) {
+            bump(counts_[i], counted);
+        }
+    }
+    bump(count_, load(other.count_));
+    bump(sum_, load(other.sum_));
+    max_.store(std::max(load(max_), load(other.max_)), std::memory_order_relaxed);
+    min_.store(std::min(load(min_), load(other.min_)), std::memory_order_relaxed);
+}
+
+void LatencyHistogram::reset() {
+    for (Counter& counter : counts_) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+    min_.store(UINT64_MAX, std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::highestValueOf(std::size_t index) {
+    if (index < 2 * kHalfBuckets) {
+        return index;
+    }
+    std::size_t shift = index / kHalfBuckets - 1;
+    std::uint64_t sub = index - shift * kHalfBuckets;
+    return ((sub + 1) << shift) - 1;
+}
+
+std::uint64_t LatencyHistogram::percentile(double percent) const {
+    std::uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    double clamped = std::min(std::max(percent, 0.0), 100.0);
+    // Rounded rather than ceil'd: 99.9 / 100 * 1000 is not exactly 999.
+    std::uint64_t target = static_cast<std::uint64_t>(clamped / 100.0 * static_cast<double>(total) + 0.5);
+    target = std::max<std::uint64_t>(target, 1);
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBucketCount; i++) {
+        seen += load(counts_[i]);
+        if (seen >= target) {
+            return std::min(highestValueOf(i), max());
+        }
+    }
+    return max();
+}
+
+std::uint64_t LatencyHistogram::countAtOrBelow(std::uint64_t value) const {
+    std::uint64_t seen = 0;
+    std::size_t last = indexOf(value);
+    for (std::size_t i = 0; i <= last; i++) {
+        seen += load(counts_[i]);
+    }
+    return seen;
+}
@@ -0,0 +1,112 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//
+// Fixed-size log-linear histogram of non-negative integer samples (e.g.
+// nanoseconds), in the manner of HdrHistogram. Values below 2^kSubBucketBits
+// are counted exactly; above that every power-of-two range is split into
+// 2^(kSubBucketBits - 1) equal buckets, so any reported value is within 1/64
+// (about 1.6%) of the samples it stands for. Recording is a handful of
+// instructions and never allocates; one instance per thread, merged when
+// reporting.
+//
+// Only one thread may record into (or merge into, or reset) an instance, but
+// any thread may read it at the same time: every field is a relaxed atomic
+// updated with a plain load and store, so the writer pays no locked
+// instruction and a reader sees each counter whole, if not all in step.
+//
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 7;
+
+    LatencyHistogram() = default;
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(std::uint64_t value) {
+        bump(counts_[indexOf(value)], 1);
+        bump(count_, 1);
+        bump(sum_, value);
+        if (value > load(max_)) {
+            max_.store(value, std::memory_order_relaxed);
+        }
+        if (value < load(min_)) {
+            min_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    // Adds every sample of `other` to this histogram.
+    void merge(const LatencyHistogram& other);
+
+    void reset();
+
+    std::uint64_t count() const { return load(count_); }
+    std::uint64_t sum() const { return load(sum_); }
+    std::uint64_t max() const { return load(max_); }
+    std::uint64_t min() const { return count() == 0 ? 0 : load(min_); }
+    double mean() const { return count() == 0 ? 0.0 : static_cast<double>(sum()) / static_cast<double>(count()); }
+
+    // Smallest recorded value such that at least `percent` % of the samples
+    // are no greater, to the bucket's resolution (never above max()).
+    std::uint64_t percentile(double percent) const;
+
+    // Number of samples no greater than `value`, to the bucket's resolution.
+    std::uint64_t countAtOrBelow(std::uint64_t value) const;
+
+private:
+    using Counter = std::atomic<std::uint64_t>;
+
+    static std::uint64_t load(const Counter& counter) { return counter.load(std::memory_order_relaxed); }
+
+    // Single-writer increment: no read-modify-write instruction needed.
+    static void bump(Counter& counter, std::uint64_t by) {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    static constexpr std::size_t kHalfBuckets = std::size_t(1) << (kSubBucketBits - 1);
+    static constexpr std::size_t kBucketCount = (64 - kSubBucketBits + 2) * kHalfBuckets;
+
+    static int floorLog2(std::uint64_t value) {
+#if defined(_MSC_VER) && defined(_WIN64)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<int>(index);
+#elif defined(_MSC_VER)
+        unsigned long index;
+        if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32))) {
+            return static_cast<int>(index) + 32;
+        }
+        _BitScanReverse(&index, static_cast<unsigned long>(value));
+        return static_cast<int>(index);
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+
+    static std::size_t indexOf(std::uint64_t value) {
+        if (value < (std::uint64_t(1) << kSubBucketBits)) {
+            return static_cast<std::size_t>(value);
+        }
+        int shift = floorLog2(value) - kSubBucketBits + 1;
+        return static_cast<std::size_t>(shift) * kHalfBuckets + static_cast<std::size_t>(value >> shift);
+    }
+
+    // Largest value counted in bucket `index`.
+    static std::uint64_t highestValueOf(std::size_t index);
+
+    std::array<Counter, kBucketCount> counts_{};
+    Counter count_{ 0 };
+    Counter sum_{ 0 };
+    Counter max_{ 0 };
+    Counter min_{ UINT64_MAX };
+};
+
+#endif // LATENCY_HISTOGRAM_H
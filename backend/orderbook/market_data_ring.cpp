@@ -0,0 +1,226 @@
+#include "market_data_ring.h"
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::uint32_t kMagic = 0x444d424f;    // "OBMD"
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kLive = 1;
+constexpr std::uint32_t kClosed = 2;
+constexpr std::size_t kWords = sizeof(MarketDataRecord) / 8;
+
+} // namespace
+
+// Set by the producer; `magic` is stored last, so a consumer that sees it
+// sees the rest of the header too.
+struct MarketDataRingHeader {
+    std::atomic<std::uint32_t> magic{ 0 };
+    std::uint32_t version = kVersion;
+    std::uint32_t slotSize = 0;
+    std::uint32_t capacity = 0;
+    std::atomic<std::uint32_t> state{ kLive };
+    alignas(64) std::atomic<std::uint64_t> head{ 0 };   // Written by the producer only.
+};
+
+struct alignas(64) MarketDataRingSlot {
+    std::atomic<std::uint64_t> version{ 0 };   // Sequence + 1 of the record held; 0 while written.
+    std::atomic<std::uint64_t> words[kWords] = {};
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "the ring is shared between processes");
+static_assert(sizeof(MarketDataRingHeader) <= 128, "header fits the first two cache lines");
+
+namespace {
+
+constexpr std::size_t kSlotsOffset = 128;
+
+std::size_t segmentSize(std::size_t capacity) {
+    return kSlotsOffset + capacity * sizeof(MarketDataRingSlot);
+}
+
+} // namespace
+
+#ifndef _WIN32
+
+bool MarketDataRing::create(const std::string& name, std::size_t capacity, std::string& error) {
+    close();
+    std::size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    // A fresh segment: consumers still mapping an old one keep it until they reopen.
+    ::shm_unlink(name.c_str());
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        error = "cannot create shared memory " + name + ": " + std::strerror(errno);
+        return false;
+    }
+    std::size_t bytes = segmentSize(size);
+    void* memory = MAP_FAILED;
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+        memory = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        error = "cannot map shared memory " + name + ": " + std::strerror(errno);
+        ::shm_unlink(name.c_str());
+        return false;
+    }
+
+    header_ = new (memory) MarketDataRingHeader();
+    header_->slotSize = sizeof(MarketDataRingSlot);
+    header_->capacity = static_cast<std::uint32_t>(size);
+    slots_ = reinterpret_cast<MarketDataRingSlot*>(static_cast<char*>(memory) + kSlotsOffset);
+    for (std::size_t i = 0; i < size; i++) {
+        new (&slots_[i]) MarketDataRingSlot();
+    }
+    header_->magic.store(kMagic, std::memory_order_release);
+    mapped_ = bytes;
+    name_ = name;
+    return true;
+}
+
+void MarketDataRing::close() {
+    if (header_ == nullptr) {
+        return;
+    }
+    header_->state.store(kClosed, std::memory_order_release);
+    ::munmap(header_, mapped_);
+    ::shm_unlink(name_.c_str());
+    header_ = nullptr;
+    slots_ = nullptr;
+}
+
+bool MarketDataReader::open(const std::string& name, std::string& error) {
+    if (header_ != nullptr) {
+        ::munmap(const_cast<MarketDataRingHeader*>(header_), mapped_);
+        header_ = nullptr;
+    }
+    int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        error = "cannot open shared memory " + name + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat info;
+    void* memory = MAP_FAILED;
+    if (::fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) >= kSlotsOffset) {
+        memory = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        error = "cannot map shared memory " + name;
+        return false;
+    }
+    auto* header = static_cast<const MarketDataRingHeader*>(memory);
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+    // The slot index is masked with capacity - 1, which only works for a
+    // non-zero power of two.
+    std::uint32_t capacity = header->capacity;
+    bool powerOfTwo = capacity != 0 && (capacity & (capacity - 1)) == 0;
+    if (header->magic.load(std::memory_order_acquire) != kMagic || header->version != kVersion ||
+        header->slotSize != sizeof(MarketDataRingSlot) || !powerOfTwo || segmentSize(capacity) > size) {
+        ::munmap(memory, size);
+        error = name + " is not a market data ring (or not initialized yet)";
+        return false;
+    }
+    header_ = header;
+    slots_ = reinterpret_cast<const MarketDataRingSlot*>(static_cast<const char*>(memory) + kSlotsOffset);
+    mapped_ = size;
+    mask_ = capacity - 1;
+    cursor_ = header->head.load(std::memory_order_acquire);
+    overruns_ = 0;
+    return true;
+}
+
+MarketDataReader::~MarketDataReader() {
+    if (header_ != nullptr) {
+        ::munmap(const_cast<MarketDataRingHeader*>(header_), mapped_);
+    }
+}
+
+#else
+
+bool MarketDataRing::create(const std::string&, std::size_t, std::string& error) {
+    error = "shared memory market data needs POSIX";
+    return false;
+}
+
+void MarketDataRing::close() {}
+
+bool MarketDataReader::open(const std::string&, std::string& error) {
+    error = "shared memory market data needs POSIX";
+    return false;
+}
+
+MarketDataReader::~MarketDataReader() {}
+
+#endif
+
+void MarketDataRing::publish(const MarketDataRecord& record) {
+    std::uint64_t sequence = header_->head.load(std::memory_order_relaxed);
+    // Claim the sequence first: from here on consumers treat the record it
+    // replaces as lapped, and this one as not yet ready.
+    header_->head.store(sequence + 1, std::memory_order_release);
+    MarketDataRingSlot& slot = slots_[sequence & (header_->capacity - 1)];
+    slot.version.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::uint64_t words[kWords];
+    std::memcpy(words, &record, sizeof(record));
+    for (std::size_t w = 0; w < kWords; w++) {
+        slot.words[w].store(words[w], std::memory_order_relaxed);
+    }
+    slot.version.store(sequence + 1, std::memory_order_release);
+}
+
+std::uint64_t MarketDataRing::head() const {
+    return header_->head.load(std::memory_order_acquire);
+}
+
+std::uint64_t MarketDataReader::head() const {
+    return header_->head.load(std::memory_order_acquire);
+}
+
+bool MarketDataReader::closed() const {
+    return header_->state.load(std::memory_order_acquire) == kClosed;
+}
+
+bool MarketDataReader::poll(MarketDataRecord& out, std::uint64_t& sequence) {
+    for (;;) {
+        std::uint64_t head = header_->head.load(std::memory_order_acquire);
+        if (cursor_ >= head) {
+            return false;
+        }
+        if (head - cursor_ > capacity()) {
+            overruns_ += head - capacity() - cursor_;
+            cursor_ = head - capacity();    // Lapped: skip to the oldest record held.
+        }
+        const MarketDataRingSlot& slot = slots_[cursor_ & mask_];
+        std::uint64_t version = slot.version.load(std::memory_order_acquire);
+        if (version == cursor_ + 1) {
+            std::uint64_t words[kWords];
+            for (std::size_t w = 0; w < kWords; w++) {
+                words[w] = slot.words[w].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.version.load(std::memory_order_relaxed) == version) {
+                std::memcpy(&out, words, sizeof(out));
+                sequence = cursor_++;
+                return true;
+            }
+        }
+        // Not whole: either the producer lapped us meanwhile (go round again)
+        // or it is still writing this record (come back later).
+        if (header_->head.load(std::memory_order_acquire) - cursor_ <= capacity()) {
+            return false;
+        }
+    }
+}
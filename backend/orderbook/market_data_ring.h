@@ -0,0 +1,133 @@
+#ifndef MARKET_DATA_RING_H
+#define MARKET_DATA_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Only standard headers above: consumers build this file and
+// market_data_ring.cpp on their own (the orderbook_market_data library).
+
+// What a MarketDataRecord describes. The delta types mirror BookDelta::Type.
+enum class MarketDataType : std::uint8_t {
+    TRADE = 1,
+    ORDER_ADDED,
+    ORDER_REMOVED,
+    ORDER_EXECUTED,
+    ORDER_MODIFIED,
+    LEVEL
+};
+
+// One trade or book delta, exactly as laid out in the shared memory segment
+// (64 bytes, native byte order). Records of one command come in the order
+// the engine produced them: its trades, then its deltas.
+struct MarketDataRecord {
+    std::uint64_t bookSequence = 0;     // The book's update sequence after the command.
+    std::int64_t timestamp = 0;         // Nanoseconds since the epoch, when published.
+    double price = 0.0;
+    std::int64_t quantity = 0;
+    char symbol[16] = {};               // NUL-terminated.
+    std::int32_t orderId = 0;           // Delta: the order. Trade: the buy order.
+    std::int32_t other = 0;             // Trade: the sell order. ORDER_EXECUTED: quantity
+                                        // left. LEVEL: orders at the level.
+    MarketDataType type = MarketDataType::TRADE;
+    std::uint8_t side = 0;              // Deltas: 0 = buy, 1 = sell.
+    std::uint8_t reserved[6] = {};
+};
+static_assert(sizeof(MarketDataRecord) == 64, "the shared layout is fixed");
+
+// The segment's header and record slots (market_data_ring.cpp).
+struct MarketDataRingHeader;
+struct MarketDataRingSlot;
+
+//
+// Single-producer, multi-consumer ring of MarketDataRecords in a named POSIX
+// shared memory segment, so processes on the same host follow the feed
+// without sockets or JSON. The segment is a header followed by a power of two
+// of slots, each a per-slot seqlock like TradeTape's: the producer claims the
+// sequence in the header's head, clears the slot's version, stores the record
+// and sets the version to sequence + 1. Consumers only read the segment; each
+// keeps its own cursor and never slows the producer down. One that falls more
+// than capacity() records behind is overrun: it skips to the oldest record
+// still held and counts what it missed.
+//
+// Not available on Windows, where create() and open() fail.
+//
+class MarketDataRing {
+public:
+    // Default number of records held.
+    static constexpr std::size_t kDefaultCapacity = 1 << 16;
+
+    MarketDataRing() = default;
+    ~MarketDataRing() { close(); }
+
+    MarketDataRing(const MarketDataRing&) = delete;
+    MarketDataRing& operator=(const MarketDataRing&) = delete;
+
+    // Creates (replacing any old one) the segment `name` ("/orderbook-md")
+    // with room for `capacity` records, rounded up to a power of two.
+    bool create(const std::string& name, std::size_t capacity, std::string& error);
+
+    // Marks the ring closed for consumers, unmaps and removes the segment.
+    void close();
+
+    bool isOpen() const { return header_ != nullptr; }
+
+    // Appends one record. Only one thread may publish.
+    void publish(const MarketDataRecord& record);
+
+    // Sequence the next published record will get.
+    std::uint64_t head() const;
+
+private:
+    MarketDataRingHeader* header_ = nullptr;
+    MarketDataRingSlot* slots_ = nullptr;
+    std::size_t mapped_ = 0;
+    std::string name_;
+};
+
+//
+// Consumer side of a MarketDataRing, mapped read-only. Each reader has its own
+// cursor; use one reader per thread.
+//
+class MarketDataReader {
+public:
+    MarketDataReader() = default;
+    ~MarketDataReader();
+
+    MarketDataReader(const MarketDataReader&) = delete;
+    MarketDataReader& operator=(const MarketDataReader&) = delete;
+
+    // Maps the segment `name`. The cursor starts at the head: only records
+    // published from now on are read (see seek()).
+    bool open(const std::string& name, std::string& error);
+
+    // Copies the record at the cursor into `out`, sets `sequence` to its
+    // position and advances. Returns false if there is nothing new yet.
+    bool poll(MarketDataRecord& out, std::uint64_t& sequence);
+
+    // Moves the cursor. A sequence older than the oldest record held reads
+    // from that one, and what lies in between counts as overrun.
+    void seek(std::uint64_t sequence) { cursor_ = sequence; }
+
+    std::uint64_t cursor() const { return cursor_; }
+    std::uint64_t head() const;
+    std::size_t capacity() const { return mask_ + 1; }
+
+    // Records skipped because the producer overwrote them before they were read.
+    std::uint64_t overruns() const { return overruns_; }
+
+    // True once the producer closed the ring; reopen to follow a new one.
+    bool closed() const;
+
+private:
+    const MarketDataRingHeader* header_ = nullptr;
+    const MarketDataRingSlot* slots_ = nullptr;
+    std::size_t mapped_ = 0;
+    std::size_t mask_ = 0;
+    std::uint64_t cursor_ = 0;
+    std::uint64_t overruns_ = 0;
+};
+
+#endif // MARKET_DATA_RING_H
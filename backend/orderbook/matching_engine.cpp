@@ -0,0 +1,651 @@
+#include "matching_engine.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <string>
+
+namespace {
+
+// Best-effort: keep a shard thread on one core so its books stay in that core's cache.
+void pinToCore(std::thread& thread, std::size_t core) {
+    unsigned cores = std::thread::hardware_concurrency();
+    if (cores == 0) {
+        return;
+    }
+    core %= cores;
+#if defined(_WIN32)
+    SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << core);
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+#endif
+}
+
+// Empty polls before an idle shard parks on its condition variable.
+constexpr unsigned kSpinsBeforePark = 4096;
+
+std::int64_t wallClockNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+JournalRecord::Type journalType(BookCommand::Type type) {
+    switch (type) {
+    case BookCommand::Type::ADD: return JournalRecord::ADD;
+    case BookCommand::Type::MODIFY: return JournalRecord::MODIFY;
+    default: return JournalRecord::CANCEL;
+    }
+}
+
+JournalRecord::Type journalType(EngineCommand::Type type) {
+    switch (type) {
+    case EngineCommand::Type::ADD: return JournalRecord::ADD;
+    case EngineCommand::Type::MODIFY: return JournalRecord::MODIFY;
+    default: return JournalRecord::CANCEL;
+    }
+}
+
+JournalRecord toJournalRecord(std::uint64_t sequence, const Symbol& symbol, JournalRecord::Type type,
+    const Order& order, OrderId orderId) {
+    JournalRecord record;
+    record.sequence = sequence;
+    std::memcpy(record.symbol, symbol.c_str(), sizeof(record.symbol));
+    // Every record carries its arrival time; for a cancel or modify that is
+    // when its command was built.
+    record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        order.timestamp.time_since_epoch()).count();
+    if (type == JournalRecord::ADD) {
+        record.type = JournalRecord::ADD;
+        record.side = order.GetSide() == OrderType::BUY ? 0 : 1;
+        record.orderId = order.GetOrderId();
+        record.quantity = order.quantity;
+        record.price = order.GetPrice();
+        record.timeInForce = static_cast<std::uint8_t>(order.GetTimeInForce());
+        record.flags = order.flags;
+        record.stopPrice = order.stopPrice;
+        record.owner = order.owner;
+    }
+    else if (type == JournalRecord::MODIFY) {
+        record.type = JournalRecord::MODIFY;
+        record.orderId = orderId;
+        record.quantity = order.quantity;
+        record.price = order.GetPrice();
+    }
+    else {
+        record.type = JournalRecord::CANCEL;
+        record.orderId = orderId;
+    }
+    record.seal();
+    return record;
+}
+
+EngineCommand fromJournalRecord(const JournalRecord& record) {
+    EngineCommand command;
+    char symbol[sizeof(record.symbol) + 1] = {};
+    std::memcpy(symbol, record.symbol, sizeof(record.symbol));
+    command.symbol = Symbol(symbol);
+    if (record.type == JournalRecord::ADD) {
+        command.type = EngineCommand::Type::ADD;
+        command.order = Order(record.orderId, record.price, record.quantity,
+            record.side == 0 ? OrderType::BUY : OrderType::SELL, command.symbol);
+        command.order.timeInForce = static_cast<TimeInForce>(record.timeInForce);
+        command.order.flags = record.flags;
+        command.order.stopPrice = record.stopPrice;
+        command.order.owner = record.owner;
+        command.order.timestamp = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(record.timestamp)));
+    }
+    else if (record.type == JournalRecord::MODIFY) {
+        command.type = EngineCommand::Type::MODIFY;
+        command.orderId = record.orderId;
+        command.order.price = record.price;
+        command.order.quantity = record.quantity;
+    }
+    else {
+        command.type = EngineCommand::Type::CANCEL;
+        command.orderId = record.orderId;
+    }
+    return command;
+}
+
+} // namespace
+
+MatchingEngine::MatchingEngine(std::size_t shardCount, const InstrumentConfig& defaultConfig,
+    std::size_t queueCapacity, std::size_t tapeCapacity)
+    : defaultConfig_(defaultConfig),
+    noBook_(std::make_unique<OrderBook>(defaultConfig, kOnDemandOrderCapacity)) {
+    if (shardCount == 0) {
+        shardCount = 1;
+    }
+    for (std::size_t i = 0; i < shardCount; i++) {
+        shards_.push_back(std::make_unique<Shard>(queueCapacity, tapeCapacity));
+        shards_.back()->index = i;
+    }
+}
+
+MatchingEngine::~MatchingEngine() {
+    stop();
+}
+
+void MatchingEngine::configure(const Symbol& symbol, const InstrumentConfig& config) {
+    configs_[symbol] = config;
+}
+
+bool MatchingEngine::enableJournal(const JournalConfig& config) {
+    if (running_) {
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(config.directory, error);
+    if (error) {
+        return false;
+    }
+    journalDirectory_ = config.directory;
+    std::uint32_t shardCount = static_cast<std::uint32_t>(shards_.size());
+    for (auto& shard : shards_) {
+        std::uint32_t index = static_cast<std::uint32_t>(shard->index);
+        Shard& s = *shard;
+
+        // Start from the snapshot, if any, then rebuild the rest exactly as
+        // it was when the records were written.
+        std::string image = snapshotPath(s);
+        if (std::filesystem::exists(image, error) && !loadSnapshot(s, image)) {
+            return false;
+        }
+        std::uint64_t snapshotSequence = s.sequence;
+        bool replayed = Journal::replay(config.directory, index, shardCount, snapshotSequence,
+            [this, &s](const JournalRecord& record) {
+                EngineCommand command = fromJournalRecord(record);
+                CommandResult result;
+                // Every journaled command was accepted, so its book is rebuilt
+                // whatever the current limit.
+                execute(*bookFor(s, command.symbol, std::numeric_limits<std::size_t>::max()), command, result);
+                s.sequence = record.sequence;
+            });
+        if (!replayed) {
+            return false;
+        }
+
+        shard->journal = std::make_unique<Journal>();
+        if (!shard->journal->open(config.directory, index, shardCount, config.durability, config.batchInterval, shard->sequence)) {
+            shard->journal.reset();
+            return false;
+        }
+        shard->journal->prune(snapshotSequence);
+    }
+    return true;
+}
+
+bool MatchingEngine::snapshot() {
+    if (journalDirectory_.empty()) {
+        return false;
+    }
+    bool ok = true;
+    for (auto& shard : shards_) {
+        ok = snapshotShard(*shard) && ok;
+    }
+    return ok;
+}
+
+void MatchingEngine::waitDurable(const Symbol& symbol, std::uint64_t sequence) {
+    Shard& shard = *shards_[shardFor(symbol)];
+    if (shard.journal && sequence != 0) {
+        StageTimer timer(MetricStage::DURABLE_WAIT);
+        shard.journal->waitDurable(sequence);
+    }
+}
+
+void MatchingEngine::start() {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    for (auto& shard : shards_) {
+        shard->stopping.store(false);
+        shard->thread = std::thread([this, s = shard.get()] { run(*s); });
+        pinToCore(shard->thread, shard->index);
+    }
+}
+
+void MatchingEngine::stop() {
+    if (!running_) {
+        return;
+    }
+    for (auto& shard : shards_) {
+        shard->stopping.store(true);
+        std::lock_guard<std::mutex> lock(shard->parkMutex);
+        shard->wake.notify_one();
+    }
+    for (auto& shard : shards_) {
+        shard->thread.join();
+    }
+    running_ = false;
+}
+
+void MatchingEngine::submit(const EngineCommand& command, CommandCompletion onComplete) {
+    post(*shards_[shardFor(command.symbol)], Task{ command, std::move(onComplete), nullptr, Metrics::Clock::now() });
+}
+
+void MatchingEngine::post(Shard& shard, Task&& task) {
+    while (!shard.ring.tryPush(std::move(task))) {
+        std::this_thread::yield();  // Ring full: back off until the shard catches up.
+    }
+    // Pairs with the fence in run(): either the shard sees the command, or we see it parked.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (shard.parked.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(shard.parkMutex);
+        shard.wake.notify_one();
+    }
+}
+
+std::future<CommandResult> MatchingEngine::submit(const EngineCommand& command) {
+    auto promise = std::make_shared<std::promise<CommandResult>>();
+    auto future = promise->get_future();
+    submit(command, [promise](const OrderBook&, CommandResult& result) {
+        promise->set_value(std::move(result));
+    });
+    return future;
+}
+
+// Sequencer loop: drain the ring in batches; spin briefly when it runs dry,
+// then park until a producer wakes us.
+void MatchingEngine::run(Shard& shard) {
+    Task task;
+    unsigned idlePolls = 0;
+    if (publishViews_) {
+        // Books recovered from a snapshot or journal are readable at once.
+        for (const auto& [symbol, book] : shard.books) {
+            shard.changedBooks.emplace_back(symbol, book.get());
+        }
+        publishViews(shard);
+    }
+    for (;;) {
+        std::size_t processed = 0;
+        while (processed < kMaxBatch && shard.ring.tryPop(task)) {
+            apply(shard, task);
+            processed++;
+        }
+        if (processed > 0) {
+            if (!shard.changedBooks.empty()) {
+                publishViews(shard);
+            }
+            idlePolls = 0;
+            continue;
+        }
+        if (shard.stopping.load(std::memory_order_acquire)) {
+            if (!shard.ring.readable()) {
+                return;  // Stopping and fully drained.
+            }
+            continue;
+        }
+        if (++idlePolls < kSpinsBeforePark) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(shard.parkMutex);
+        shard.parked.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!shard.ring.readable() && !shard.stopping.load(std::memory_order_acquire)) {
+            // The timeout is only a safety net; producers notify while we are parked.
+            shard.wake.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        shard.parked.store(false, std::memory_order_relaxed);
+        idlePolls = 0;
+    }
+}
+
+// Execute, stamp, journal, publish and complete one command.
+void MatchingEngine::apply(Shard& shard, Task& task) {
+    if (task.control) {
+        task.control(shard);
+        task.control = nullptr;
+        return;
+    }
+    const EngineCommand& command = task.command;
+    bool query = command.type == EngineCommand::Type::QUERY;
+    OrderBook* found = bookFor(shard, command.symbol, query ? 0 : bookLimit_);
+    if (!found) {
+        // No book to run against: an unconfigured symbol past the limit, or
+        // a query for a symbol nothing was ever added to.
+        CommandResult result;
+        if (!query) {
+            result.reject = RejectReason::UNKNOWN_SYMBOL;
+            countOutcome(command, result);
+        }
+        if (task.onComplete) {
+            task.onComplete(*noBook_, result);
+            task.onComplete = nullptr;
+        }
+        return;
+    }
+    OrderBook& book = *found;
+    CommandResult result;
+    book.setDeltaSink(&result.deltas);
+    if (command.type == EngineCommand::Type::QUERY) {
+        execute(book, command, result);
+    }
+    else {
+        Metrics::Clock::time_point start = Metrics::Clock::now();
+        execute(book, command, result);
+        Metrics::Clock::time_point end = Metrics::Clock::now();
+        Metrics::record(MetricStage::QUEUE_WAIT, task.queued, start);
+        Metrics::record(MetricStage::MATCH, start, end);
+        countOutcome(command, result);
+    }
+    book.setDeltaSink(nullptr);
+    std::int64_t tradeTime = result.trades.empty() ? 0 : wallClockNanos();
+    if (result.accepted && command.type == EngineCommand::Type::BATCH) {
+        // Journal each accepted entry on its own, so replay needs no batches.
+        for (std::size_t i = 0; i < command.batch.size(); i++) {
+            BookCommandResult& entry = result.batch[i];
+            if (entry.accepted) {
+                entry.sequence = ++shard.sequence;
+                if (shard.journal) {
+                    const BookCommand& sub = command.batch[i];
+                    JournalRecord record = toJournalRecord(entry.sequence, command.symbol,
+                        journalType(sub.type), sub.order, sub.orderId);
+                    if (sub.type == BookCommand::Type::ADD) {
+                        record.orderId = entry.orderId;
+                    }
+                    shard.journal->append(record);
+                }
+                shard.tape.append(result.trades.data() + entry.firstTrade, entry.tradeCount,
+                    command.symbol, entry.sequence, tradeTime);
+            }
+        }
+        result.sequence = shard.sequence;
+    }
+    else if (result.accepted && command.type == EngineCommand::Type::MASS_CANCEL) {
+        // Journaled as one cancel per order removed, so replay needs no filters.
+        for (OrderId orderId : result.cancelled) {
+            ++shard.sequence;
+            if (shard.journal) {
+                shard.journal->append(toJournalRecord(shard.sequence, command.symbol,
+                    JournalRecord::CANCEL, command.order, orderId));
+            }
+        }
+        result.sequence = shard.sequence;
+    }
+    else if (result.accepted && command.type != EngineCommand::Type::QUERY) {
+        result.sequence = ++shard.sequence;
+        if (shard.journal) {
+            JournalRecord record = toJournalRecord(result.sequence, command.symbol,
+                journalType(command.type), command.order, command.orderId);
+            if (command.type == EngineCommand::Type::ADD) {
+                record.orderId = result.orderId;     // The ID it was accepted under.
+            }
+            shard.journal->append(record);
+        }
+        shard.tape.append(result.trades.data(), result.trades.size(), command.symbol, result.sequence, tradeTime);
+    }
+    if (result.accepted && command.type != EngineCommand::Type::QUERY) {
+        result.bookSequence = book.updateSequence();
+        if (publishViews_) {
+            auto changed = std::find_if(shard.changedBooks.begin(), shard.changedBooks.end(),
+                [&book](const auto& entry) { return entry.second == &book; });
+            if (changed == shard.changedBooks.end()) {
+                shard.changedBooks.emplace_back(command.symbol, &book);
+            }
+        }
+        if (listener_) {
+            listener_(command.symbol, book, result);
+        }
+    }
+    if (task.onComplete) {
+        task.onComplete(book, result);
+        task.onComplete = nullptr;
+    }
+}
+
+// Captures the books changed since the last publication and swaps their views in.
+void MatchingEngine::publishViews(Shard& shard) {
+    std::vector<std::pair<Symbol, std::shared_ptr<const BookView>>> views;
+    views.reserve(shard.changedBooks.size());
+    for (const auto& [symbol, book] : shard.changedBooks) {
+        views.emplace_back(symbol, BookView::capture(*book, viewLevels_));
+    }
+    shard.changedBooks.clear();
+    shard.views.publish(views);
+}
+
+// Book registry: books are created on first use with the symbol's config.
+// A symbol without one only gets a book while the shard holds fewer than
+// `limit` such books; they start small since anyone can name a new symbol.
+OrderBook* MatchingEngine::bookFor(Shard& shard, const Symbol& symbol, std::size_t limit) {
+    auto it = shard.books.find(symbol);
+    if (it != shard.books.end()) {
+        return it->second.get();
+    }
+    std::unique_ptr<OrderBook> book;
+    auto configIt = configs_.find(symbol);
+    if (configIt != configs_.end()) {
+        book = std::make_unique<OrderBook>(configIt->second);
+    }
+    else if (shard.onDemandBooks < limit) {
+        book = std::make_unique<OrderBook>(defaultConfig_, kOnDemandOrderCapacity);
+        shard.onDemandBooks++;
+    }
+    else {
+        return nullptr;
+    }
+    return shard.books.emplace(symbol, std::move(book)).first->second.get();
+}
+
+void MatchingEngine::execute(OrderBook& book, const EngineCommand& command, CommandResult& result) {
+    switch (command.type) {
+    case EngineCommand::Type::ADD:
+        result.accepted = book.addOrder(command.order, result.trades, &result.reject);
+        if (result.accepted) {
+            result.orderId = book.lastOrderId();
+        }
+        break;
+    case EngineCommand::Type::CANCEL:
+        result.accepted = book.cancelOrder(command.orderId);
+        if (!result.accepted) {
+            result.reject = RejectReason::UNKNOWN_ORDER;
+        }
+        break;
+    case EngineCommand::Type::MODIFY:
+        result.accepted = book.modifyOrder(command.orderId, command.order.GetPrice(), command.order.quantity,
+            result.trades, &result.reject);
+        break;
+    case EngineCommand::Type::BATCH:
+        result.accepted = book.applyBatch(command.batch, result.batch, result.trades);
+        break;
+    case EngineCommand::Type::MASS_CANCEL:
+        result.accepted = book.cancelOrders(command.massCancel, &result.cancelled) > 0;
+        break;
+    case EngineCommand::Type::QUERY:
+        result.accepted = true;
+        break;
+    }
+}
+
+void MatchingEngine::countOutcome(const EngineCommand& command, const CommandResult& result) {
+    auto countOne = [](JournalRecord::Type type, bool accepted) {
+        if (!accepted) {
+            Metrics::count(MetricCounter::REJECTS);
+        }
+        else if (type == JournalRecord::ADD) {
+            Metrics::count(MetricCounter::ORDERS);
+        }
+        else {
+            Metrics::count(type == JournalRecord::MODIFY ? MetricCounter::MODIFIES : MetricCounter::CANCELS);
+        }
+    };
+    if (command.type == EngineCommand::Type::BATCH) {
+        for (std::size_t i = 0; i < command.batch.size() && i < result.batch.size(); i++) {
+            countOne(journalType(command.batch[i].type), result.batch[i].accepted);
+        }
+    }
+    else if (command.type == EngineCommand::Type::MASS_CANCEL) {
+        Metrics::count(MetricCounter::CANCELS, result.cancelled.size());
+    }
+    else {
+        countOne(journalType(command.type), result.accepted);
+    }
+    if (!result.trades.empty()) {
+        Metrics::count(MetricCounter::TRADES, result.trades.size());
+    }
+}
+
+std::string MatchingEngine::snapshotPath(const Shard& shard) const {
+    return (std::filesystem::path(journalDirectory_)
+        / ("snapshot-" + std::to_string(shard.index) + ".bin")).string();
+}
+
+// Snapshot image: header, then per book its grid and saveSnapshot() output,
+// then a checksum over everything before it.
+void MatchingEngine::writeImage(const Shard& shard, std::vector<char>& image) const {
+    SnapshotWriter out(image);
+    SnapshotHeader header;
+    header.shardIndex = static_cast<std::uint32_t>(shard.index);
+    header.shardCount = static_cast<std::uint32_t>(shards_.size());
+    header.sequence = shard.sequence;
+    header.bookCount = static_cast<std::uint32_t>(shard.books.size());
+    out.put(header);
+    for (const auto& [symbol, book] : shard.books) {
+        SnapshotBookHeader bookHeader;
+        std::memcpy(bookHeader.symbol, symbol.c_str(), sizeof(bookHeader.symbol));
+        bookHeader.tickSize = book->config().tickSize;
+        bookHeader.minPrice = book->config().minPrice;
+        bookHeader.maxPrice = book->config().maxPrice;
+        bookHeader.assignOrderIds = book->config().assignOrderIds ? 1 : 0;
+        out.put(bookHeader);
+        book->saveSnapshot(out);
+    }
+    SnapshotTrailer trailer;
+    trailer.checksum = snapshotChecksum(image.data(), image.size());
+    out.put(trailer);
+}
+
+// Capture the shard's state between two commands, then write it out from
+// here. Where fork() exists the child process serializes its copy-on-write
+// view of the books, so the matching thread only pays for the fork.
+bool MatchingEngine::snapshotShard(Shard& shard) {
+    std::string path = snapshotPath(shard);
+    struct Capture {
+        std::uint64_t sequence = 0;
+        std::vector<char> image;
+        long child = -1;
+    };
+
+    auto capture = [this, path](Shard& s) {
+        Capture result;
+        result.sequence = s.sequence;
+#ifndef _WIN32
+        pid_t child = fork();
+        if (child == 0) {
+            std::vector<char> image;
+            writeImage(s, image);
+            _exit(writeFileDurably(path, image) ? 0 : 1);
+        }
+        result.child = child;
+#endif
+        if (result.child <= 0) {
+            writeImage(s, result.image);
+        }
+        if (s.journal) {
+            s.journal->rotate(s.sequence + 1);
+        }
+        return result;
+    };
+
+    Capture captured;
+    if (running_) {
+        auto promise = std::make_shared<std::promise<Capture>>();
+        auto future = promise->get_future();
+        post(shard, Task{ EngineCommand(), nullptr, [promise, capture](Shard& s) {
+            promise->set_value(capture(s));
+        } });
+        captured = future.get();
+    }
+    else {
+        captured = capture(shard);
+    }
+
+    bool written;
+#ifndef _WIN32
+    if (captured.child > 0) {
+        int status = 0;
+        written = waitpid(static_cast<pid_t>(captured.child), &status, 0) == captured.child
+            && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    else
+#endif
+    {
+        written = writeFileDurably(path, captured.image);
+    }
+    if (written && shard.journal) {
+        shard.journal->prune(captured.sequence);
+    }
+    return written;
+}
+
+// Map the image read-only and rebuild the shard's books from it.
+bool MatchingEngine::loadSnapshot(Shard& shard, const std::string& path) {
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(SnapshotHeader) + sizeof(SnapshotTrailer)) {
+        return false;
+    }
+    std::size_t body = file.size() - sizeof(SnapshotTrailer);
+    SnapshotTrailer trailer;
+    std::memcpy(&trailer, file.data() + body, sizeof(trailer));
+    if (trailer.checksum != snapshotChecksum(file.data(), body)) {
+        return false;
+    }
+
+    SnapshotReader in(file.data(), body);
+    SnapshotHeader header;
+    SnapshotHeader expected;
+    in.get(header);
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+        || header.version != expected.version
+        || header.shardIndex != shard.index
+        || header.shardCount != shards_.size()) {
+        return false;
+    }
+    for (std::uint32_t b = 0; b < header.bookCount; b++) {
+        SnapshotBookHeader bookHeader;
+        if (!in.get(bookHeader)) {
+            return false;
+        }
+        char name[sizeof(bookHeader.symbol) + 1] = {};
+        std::memcpy(name, bookHeader.symbol, sizeof(bookHeader.symbol));
+        Symbol symbol(name);
+        InstrumentConfig config;
+        config.tickSize = bookHeader.tickSize;
+        config.minPrice = bookHeader.minPrice;
+        config.maxPrice = bookHeader.maxPrice;
+        config.assignOrderIds = bookHeader.assignOrderIds != 0;
+        auto book = std::make_unique<OrderBook>(config);
+        if (!book->loadSnapshot(in, symbol)) {
+            return false;
+        }
+        if (configs_.find(symbol) == configs_.end()) {
+            shard.onDemandBooks++;
+        }
+        shard.books[symbol] = std::move(book);
+    }
+    shard.sequence = header.sequence;
+    return in.remaining() == 0;
+}
@@ -0,0 +1,263 @@
+#ifndef MATCHING_ENGINE_H
+#define MATCHING_ENGINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "book_view.h"
+#include "journal.h"
+#include "metrics.h"
+#include "mpsc_ring.h"
+#include "order_book.h"
+#include "snapshot.h"
+#include "trade_tape.h"
+
+// A request routed to the shard that owns `symbol`.
+struct EngineCommand {
+    enum class Type {
+        ADD,     // Add `order`.
+        CANCEL,  // Cancel `orderId`.
+        MODIFY,  // Give `orderId` the price and quantity of `order`.
+        BATCH,   // Apply `batch` in order, with nothing interleaved.
+        MASS_CANCEL,  // Cancel every order `massCancel` selects.
+        QUERY    // No book change; only runs the completion.
+    };
+
+    Type type = Type::QUERY;
+    Symbol symbol;
+    Order order;
+    OrderId orderId = 0;
+    std::vector<BookCommand> batch;
+    MassCancel massCancel;
+};
+
+// Outcome of one command.
+struct CommandResult {
+    std::uint64_t sequence = 0;     // Assigned by the shard's sequencer (0 if nothing changed).
+    std::uint64_t bookSequence = 0; // The book's updateSequence() after the command.
+    bool accepted = false;          // Order added / cancel or modify found the order / batch changed the book.
+    RejectReason reject = RejectReason::NONE;  // Why an ADD, CANCEL or MODIFY was refused.
+    OrderId orderId = 0;            // Accepted ADD: its ID, assigned by the book if it assigns them.
+    std::vector<Trade> trades;      // Executions caused by an ADD, MODIFY or BATCH.
+    std::vector<BookDelta> deltas;  // Changes made to the book, in order.
+    std::vector<BookCommandResult> batch;  // BATCH: one entry per command.
+    std::vector<OrderId> cancelled; // MASS_CANCEL: the orders removed.
+};
+
+// Called on the owning shard's thread right after the command was applied.
+// It may read the book but must not block.
+using CommandCompletion = std::function<void(const OrderBook& book, CommandResult& result)>;
+
+// Called on the shard thread for every command that changed a book, in
+// sequence order, before the command's own completion. Market data feeds
+// hang off this; it must not block.
+using UpdateListener = std::function<void(const Symbol& symbol, const OrderBook& book, const CommandResult& result)>;
+
+//
+// Multi-instrument engine. Symbols are hash-partitioned across a fixed set of
+// shards; each shard runs one matching thread (pinned to a core where the
+// platform allows it) that exclusively owns the books of its symbols, so the
+// books themselves need no lock.
+//
+// Each shard is a single-writer sequencer: callers only push commands onto
+// the shard's lock-free MPSC ring, and the matching thread drains it in
+// batches, applies each command, stamps every one that changed a book with
+// the next sequence number and runs the command's completion. Each accepted
+// entry of a BATCH gets its own sequence number; `sequence` is the last one.
+// A mutex is only touched to wake a shard that parked itself after running
+// out of work.
+//
+// With a journal enabled, every sequenced command is also handed to the
+// shard's write-ahead journal; callers acknowledge a command only after
+// waitDurable() returns for its sequence. Every execution is also appended to
+// the shard's TradeTape, which any thread may read without a lock. With book
+// views enabled, each shard also publishes a BookView of the top of every
+// book it changed after each drain of its ring, so queries are served from
+// the caller's own thread and never queue behind (or hold up) order entry.
+// snapshot() periodically writes each shard's books to a binary image so a
+// restart maps the image and replays only the journal written after it.
+//
+class MatchingEngine {
+public:
+    // Default ring capacity (commands) per shard.
+    static constexpr std::size_t kDefaultQueueCapacity = 1 << 14;
+
+    // Commands applied per ring drain before the loop checks for parking.
+    static constexpr std::size_t kMaxBatch = 256;
+
+    // Default number of books each shard creates for symbols that were not
+    // configure()d.
+    static constexpr std::size_t kDefaultBookLimit = 1024;
+
+    // Order capacity a book created for an unconfigured symbol starts with;
+    // its pool and index grow from there as orders arrive.
+    static constexpr std::size_t kOnDemandOrderCapacity = 64;
+
+    explicit MatchingEngine(std::size_t shardCount = 1,
+        const InstrumentConfig& defaultConfig = InstrumentConfig(),
+        std::size_t queueCapacity = kDefaultQueueCapacity,
+        std::size_t tapeCapacity = TradeTape::kDefaultCapacity);
+    ~MatchingEngine();
+
+    MatchingEngine(const MatchingEngine&) = delete;
+    MatchingEngine& operator=(const MatchingEngine&) = delete;
+
+    // Registers a price grid for a symbol. Must be called before start();
+    // symbols without one use the default config.
+    void configure(const Symbol& symbol, const InstrumentConfig& config);
+
+    // Caps the books each shard creates on demand for symbols without a
+    // configure() call; commands for further such symbols are refused with
+    // UNKNOWN_SYMBOL (0 accepts configured symbols only). Queries never create
+    // a book. Must be called before start().
+    void setBookLimit(std::size_t limit) { bookLimit_ = limit; }
+
+    // Installs the listener for book updates. Must be called before start().
+    void setUpdateListener(UpdateListener listener) { listener_ = std::move(listener); }
+
+    // Makes the shards publish a BookView of the best `levels` levels per side
+    // of each book after every ring drain that changed it (and of every book
+    // at start), for readView(). A view trails its book by at most one drain,
+    // i.e. kMaxBatch commands. Must be called before start().
+    void enableBookViews(std::size_t levels = BookView::kDefaultLevels) {
+        publishViews_ = true;
+        viewLevels_ = levels;
+    }
+
+    // Loads each shard's latest snapshot from `config.directory`, replays the
+    // journal written after it, then journals every sequenced command there.
+    // Must be called before start(). Returns false if a snapshot or journal
+    // cannot be read or opened, or was written with a different shard count.
+    bool enableJournal(const JournalConfig& config);
+
+    // Writes every shard's books to snapshot-<shard>.bin in the journal
+    // directory and starts a new journal segment after it. Each shard only
+    // pauses to fork (where available) or copy its books; serialization and
+    // fsync happen off the matching threads while the caller blocks. Returns
+    // false if journaling is off or an image could not be written.
+    bool snapshot();
+
+    // Blocks until the command sequenced as `sequence` on the shard owning
+    // `symbol` is durable. Returns at once if journaling is off.
+    void waitDurable(const Symbol& symbol, std::uint64_t sequence);
+
+    // Starts / joins the shard threads. stop() drains queued commands first.
+    void start();
+    void stop();
+
+    std::size_t shardCount() const { return shards_.size(); }
+
+    // Index of the shard owning `symbol`.
+    std::size_t shardFor(const Symbol& symbol) const { return symbol.hash() % shards_.size(); }
+
+    // Recent executions of every symbol on the shard owning `symbol`, in the
+    // order they were printed, each tagged with its command's sequence.
+    // Safe to read from any thread while the engine runs.
+    const TradeTape& tape(const Symbol& symbol) const { return shards_[shardFor(symbol)]->tape; }
+
+    // The TradeTape of shard `index`.
+    const TradeTape& shardTape(std::size_t index) const { return shards_[index]->tape; }
+
+    // Queues a command; `onComplete` runs on the shard thread. Spins (yielding)
+    // while the shard's ring is full.
+    void submit(const EngineCommand& command, CommandCompletion onComplete);
+
+    // Queues a command and returns its result.
+    std::future<CommandResult> submit(const EngineCommand& command);
+
+    // Runs `fn(const BookView&)` on the calling thread against the latest view
+    // of `symbol`'s book (an empty one before the first), without involving the
+    // shard. Requires enableBookViews().
+    template <typename Fn>
+    auto readView(const Symbol& symbol, Fn fn) const -> decltype(fn(std::declval<const BookView&>())) {
+        return shards_[shardFor(symbol)]->views.read(symbol, std::move(fn));
+    }
+
+    // Runs `fn(const OrderBook&)` on the shard owning `symbol` and returns its result.
+    template <typename Fn>
+    auto query(const Symbol& symbol, Fn fn) -> std::future<decltype(fn(std::declval<const OrderBook&>()))> {
+        using Result = decltype(fn(std::declval<const OrderBook&>()));
+        auto promise = std::make_shared<std::promise<Result>>();
+        auto future = promise->get_future();
+        EngineCommand command;
+        command.type = EngineCommand::Type::QUERY;
+        command.symbol = symbol;
+        submit(command, [promise, fn](const OrderBook& book, CommandResult&) {
+            promise->set_value(fn(book));
+        });
+        return future;
+    }
+
+private:
+    struct Shard;
+
+    struct Task {
+        EngineCommand command;
+        CommandCompletion onComplete;
+        std::function<void(Shard&)> control;   // Runs instead of the command when set.
+        Metrics::Clock::time_point queued{};    // When submit() was called, for the queue wait.
+    };
+
+    // One matching thread, its ingress ring and the books it owns.
+    struct Shard {
+        Shard(std::size_t queueCapacity, std::size_t tapeCapacity) : ring(queueCapacity), tape(tapeCapacity) {}
+
+        std::size_t index = 0;
+        std::thread thread;
+        MpscRing<Task> ring;
+        std::atomic<bool> stopping{ false };
+
+        // Parking for an idle shard; producers only lock when `parked` is set.
+        std::atomic<bool> parked{ false };
+        std::mutex parkMutex;
+        std::condition_variable wake;
+
+        // Only touched by `thread`.
+        std::uint64_t sequence = 0;
+        std::unordered_map<Symbol, std::unique_ptr<OrderBook>, SymbolHash> books;
+        std::size_t onDemandBooks = 0;  // Books of symbols without a configure() call.
+
+        std::unique_ptr<Journal> journal;
+
+        // Written by `thread` only; read by anyone.
+        TradeTape tape;
+        ViewPublisher views;
+
+        // Books changed since the views were last published (only touched by `thread`).
+        std::vector<std::pair<Symbol, const OrderBook*>> changedBooks;
+    };
+
+    void run(Shard& shard);
+    void apply(Shard& shard, Task& task);
+    void publishViews(Shard& shard);
+    void post(Shard& shard, Task&& task);
+    bool snapshotShard(Shard& shard);
+    bool loadSnapshot(Shard& shard, const std::string& path);
+    void writeImage(const Shard& shard, std::vector<char>& image) const;
+    std::string snapshotPath(const Shard& shard) const;
+    OrderBook* bookFor(Shard& shard, const Symbol& symbol, std::size_t limit);
+    void execute(OrderBook& book, const EngineCommand& command, CommandResult& result);
+    static void countOutcome(const EngineCommand& command, const CommandResult& result);
+
+    InstrumentConfig defaultConfig_;
+    std::unordered_map<Symbol, InstrumentConfig, SymbolHash> configs_;
+    std::size_t bookLimit_ = kDefaultBookLimit;
+    std::unique_ptr<const OrderBook> noBook_;  // Handed to completions of refused commands.
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::string journalDirectory_;
+    UpdateListener listener_;
+    bool publishViews_ = false;
+    std::size_t viewLevels_ = BookView::kDefaultLevels;
+    bool running_ = false;
+};
+
+#endif // MATCHING_ENGINE_H
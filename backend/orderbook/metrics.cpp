@@ -0,0 +1,168 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+const char* const kStageNames[] = { "parse", "queue_wait", "match", "durable_wait", "serialize", "fanout" };
+
+struct CounterInfo {
+    const char* name;
+    const char* help;
+};
+
+const CounterInfo kCounters[] = {
+    { "orderbook_orders_total", "Orders accepted onto a book." },
+    { "orderbook_cancels_total", "Cancels that removed an order." },
+    { "orderbook_modifies_total", "Modifies applied to a resting order." },
+    { "orderbook_trades_total", "Executions." },
+    { "orderbook_rejects_total", "Adds, cancels and modifies refused by the book." },
+};
+
+static_assert(sizeof(kStageNames) / sizeof(kStageNames[0]) == static_cast<std::size_t>(MetricStage::COUNT),
+    "one name per stage");
+static_assert(sizeof(kCounters) / sizeof(kCounters[0]) == static_cast<std::size_t>(MetricCounter::COUNT),
+    "one name per counter");
+
+// Upper bounds (ns) of the exported histogram buckets.
+const std::uint64_t kBucketBounds[] = {
+    250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000, 250000000, 1000000000
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<Metrics::ThreadSlot*> live;
+    Metrics::ThreadSlot retired;    // Totals of threads that have exited.
+};
+
+// Never destroyed: threads may still exit while statics are torn down.
+Registry& registry() {
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+// printf-style append of one line.
+void append(std::string& out, const char* format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    int length = std::vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length > 0) {
+        out.append(line, std::min<std::size_t>(static_cast<std::size_t>(length), sizeof(line) - 1));
+    }
+}
+
+} // namespace
+
+// Owns the calling thread's slot; folds it into the retired totals when the
+// thread exits.
+struct MetricsSlotOwner {
+    std::unique_ptr<Metrics::ThreadSlot> slot;
+
+    ~MetricsSlotOwner() {
+        if (!slot) {
+            return;
+        }
+        Registry& shared = registry();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        for (std::size_t i = 0; i < static_cast<std::size_t>(MetricStage::COUNT); i++) {
+            shared.retired.stages[i].merge(slot->stages[i]);
+        }
+        for (std::size_t i = 0; i < static_cast<std::size_t>(MetricCounter::COUNT); i++) {
+            shared.retired.counters[i].fetch_add(slot->counters[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        shared.live.erase(std::find(shared.live.begin(), shared.live.end(), slot.get()));
+        Metrics::current_ = nullptr;
+    }
+};
+
+namespace {
+thread_local MetricsSlotOwner slotOwner;
+}
+
+Metrics::ThreadSlot& Metrics::attach() {
+    slotOwner.slot = std::make_unique<ThreadSlot>();
+    Registry& shared = registry();
+    {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        shared.live.push_back(slotOwner.slot.get());
+    }
+    current_ = slotOwner.slot.get();
+    return *current_;
+}
+
+void Metrics::collect(MetricStage stage, LatencyHistogram& out) {
+    Registry& shared = registry();
+    std::size_t index = static_cast<std::size_t>(stage);
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    out.merge(shared.retired.stages[index]);
+    for (const ThreadSlot* slot : shared.live) {
+        out.merge(slot->stages[index]);
+    }
+}
+
+std::uint64_t Metrics::total(MetricCounter counter) {
+    Registry& shared = registry();
+    std::size_t index = static_cast<std::size_t>(counter);
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    std::uint64_t sum = shared.retired.counters[index].load(std::memory_order_relaxed);
+    for (const ThreadSlot* slot : shared.live) {
+        sum += slot->counters[index].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+std::string Metrics::renderPrometheus(const std::vector<MetricGauge>& gauges) {
+    std::string out;
+    out.reserve(16 * 1024);
+
+    // Histograms are merged once and reused for both families.
+    std::vector<std::unique_ptr<LatencyHistogram>> stages;
+    for (std::size_t i = 0; i < static_cast<std::size_t>(MetricStage::COUNT); i++) {
+        stages.push_back(std::make_unique<LatencyHistogram>());
+        collect(static_cast<MetricStage>(i), *stages.back());
+    }
+
+    out += "# HELP orderbook_stage_latency_seconds Time spent in each stage of a command.\n";
+    out += "# TYPE orderbook_stage_latency_seconds histogram\n";
+    for (std::size_t i = 0; i < stages.size(); i++) {
+        const LatencyHistogram& histogram = *stages[i];
+        for (std::uint64_t bound : kBucketBounds) {
+            append(out, "orderbook_stage_latency_seconds_bucket{stage=\"%s\",le=\"%.9g\"} %llu\n", kStageNames[i],
+                static_cast<double>(bound) / 1e9, static_cast<unsigned long long>(histogram.countAtOrBelow(bound)));
+        }
+        append(out, "orderbook_stage_latency_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %llu\n", kStageNames[i],
+            static_cast<unsigned long long>(histogram.count()));
+        append(out, "orderbook_stage_latency_seconds_sum{stage=\"%s\"} %.9g\n", kStageNames[i],
+            static_cast<double>(histogram.sum()) / 1e9);
+        append(out, "orderbook_stage_latency_seconds_count{stage=\"%s\"} %llu\n", kStageNames[i],
+            static_cast<unsigned long long>(histogram.count()));
+    }
+
+    // Exact tail percentiles since startup, which the coarse buckets above cannot give.
+    out += "# HELP orderbook_stage_latency_quantile_seconds Latency percentiles of each stage since startup.\n";
+    out += "# TYPE orderbook_stage_latency_quantile_seconds gauge\n";
+    const double quantiles[] = { 0.5, 0.99, 0.999, 1.0 };
+    for (std::size_t i = 0; i < stages.size(); i++) {
+        for (double quantile : quantiles) {
+            append(out, "orderbook_stage_latency_quantile_seconds{stage=\"%s\",quantile=\"%g\"} %.9g\n", kStageNames[i],
+                quantile, static_cast<double>(stages[i]->percentile(quantile * 100.0)) / 1e9);
+        }
+    }
+
+    for (std::size_t i = 0; i < static_cast<std::size_t>(MetricCounter::COUNT); i++) {
+        append(out, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", kCounters[i].name, kCounters[i].help,
+            kCounters[i].name, kCounters[i].name,
+            static_cast<unsigned long long>(total(static_cast<MetricCounter>(i))));
+    }
+    for (const MetricGauge& gauge : gauges) {
+        append(out, "# HELP %s %s\n# TYPE %s gauge\n%s %.9g\n", gauge.name.c_str(), gauge.help.c_str(),
+            gauge.name.c_str(), gauge.name.c_str(), gauge.value);
+    }
+    return out;
+}
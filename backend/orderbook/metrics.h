@@ -0,0 +1,106 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "latency_histogram.h"
+
+// Timed stages of a command's trip through the server.
+enum class MetricStage : std::size_t {
+    PARSE,          // Decoding a request (JSON or binary).
+    QUEUE_WAIT,     // Sitting in the shard's ring before the matching thread takes it.
+    MATCH,          // Applying it to the book.
+    DURABLE_WAIT,   // Waiting for the journal to make it durable.
+    SERIALIZE,      // Building a response or market data message.
+    FANOUT,         // Handing market data to every subscribed connection.
+    COUNT
+};
+
+// Monotonic event counts.
+enum class MetricCounter : std::size_t {
+    ORDERS,         // Accepted adds.
+    CANCELS,        // Accepted cancels.
+    MODIFIES,       // Accepted modifies.
+    TRADES,         // Executions.
+    REJECTS,        // Adds, cancels and modifies the book refused.
+    COUNT
+};
+
+// Instantaneous values supplied by the caller when rendering.
+struct MetricGauge {
+    std::string name;
+    std::string help;
+    double value = 0.0;
+};
+
+//
+// Per-thread latency histograms and counters. Each thread records into its
+// own cache-line aligned slot, created the first time it records, so the hot
+// path is a thread-local lookup plus a few uncontended stores: no lock, no
+// atomic read-modify-write and no cache line shared with another writer.
+// Readers merge every live slot, plus the totals of threads that have since
+// exited, under a mutex that writers only take when a thread starts or ends.
+//
+class Metrics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct alignas(64) ThreadSlot {
+        LatencyHistogram stages[static_cast<std::size_t>(MetricStage::COUNT)];
+        std::atomic<std::uint64_t> counters[static_cast<std::size_t>(MetricCounter::COUNT)] = {};
+    };
+
+    static void record(MetricStage stage, std::uint64_t nanos) {
+        slot().stages[static_cast<std::size_t>(stage)].record(nanos);
+    }
+
+    static void record(MetricStage stage, Clock::time_point start, Clock::time_point end) {
+        record(stage, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+    }
+
+    static void count(MetricCounter counter, std::uint64_t by = 1) {
+        std::atomic<std::uint64_t>& value = slot().counters[static_cast<std::size_t>(counter)];
+        value.store(value.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    // Sums every thread's histogram of `stage` into `out`.
+    static void collect(MetricStage stage, LatencyHistogram& out);
+
+    // Sum of `counter` over every thread.
+    static std::uint64_t total(MetricCounter counter);
+
+    // Everything in the Prometheus text exposition format, followed by `gauges`.
+    static std::string renderPrometheus(const std::vector<MetricGauge>& gauges);
+
+private:
+    static ThreadSlot& slot() {
+        ThreadSlot* current = current_;
+        return current != nullptr ? *current : attach();
+    }
+
+    // Creates and registers the calling thread's slot.
+    static ThreadSlot& attach();
+
+    friend struct MetricsSlotOwner;
+    static inline thread_local ThreadSlot* current_ = nullptr;
+};
+
+// Records the time from construction to destruction as `stage`.
+class StageTimer {
+public:
+    explicit StageTimer(MetricStage stage) : stage_(stage), start_(Metrics::Clock::now()) {}
+    ~StageTimer() { Metrics::record(stage_, start_, Metrics::Clock::now()); }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    MetricStage stage_;
+    Metrics::Clock::time_point start_;
+};
+
+#endif // METRICS_H
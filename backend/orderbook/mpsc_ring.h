@@ -0,0 +1,91 @@
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+//
+// Bounded lock-free multi-producer / single-consumer ring (Vyukov style).
+// Every cell carries a sequence number: producers claim a position with one
+// CAS on the shared head and publish the cell by bumping its sequence, the
+// single consumer reads cells in order without any read-modify-write.
+//
+template <typename T>
+class MpscRing {
+public:
+    explicit MpscRing(std::size_t capacity) {
+        std::size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        cells_.reset(new Cell[size]);
+        for (std::size_t i = 0; i < size; i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // Producer side (any thread). Returns false if the ring is full.
+    bool tryPush(T&& value) {
+        std::size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+            std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;  // The consumer has not freed this cell yet.
+            }
+            else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side (one thread only). Returns false if nothing is ready.
+    bool tryPop(T& out) {
+        Cell& cell = cells_[dequeuePos_ & mask_];
+        if (cell.sequence.load(std::memory_order_acquire) != dequeuePos_ + 1) {
+            return false;
+        }
+        out = std::move(cell.value);
+        cell.sequence.store(dequeuePos_ + mask_ + 1, std::memory_order_release);
+        ++dequeuePos_;
+        return true;
+    }
+
+    // Consumer side: true if tryPop() would succeed.
+    bool readable() const {
+        const Cell& cell = cells_[dequeuePos_ & mask_];
+        return cell.sequence.load(std::memory_order_acquire) == dequeuePos_ + 1;
+    }
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    std::size_t mask_ = 0;
+    alignas(64) std::atomic<std::size_t> enqueuePos_{ 0 };
+    alignas(64) std::size_t dequeuePos_ = 0;
+};
+
+#endif // MPSC_RING_H
@@ -1,24 +1,62 @@
 #ifndef ORDER_BOOK_H
 #define ORDER_BOOK_H
 
+#include <array>
+#include <cstring>
 #include <map>
+#include <string>
 #include <unordered_map>
 #include <list>
 #include <vector>
 #include <chrono>
 #include <iostream>
 #include <memory>
+#include "order_index.h"
+#include "order_pool.h"
+#include "price_ladder.h"
+#include "snapshot.h"
 
 // Type aliases for clarity.
 using Price = double;
 using OrderId = int;
 
+// Session or strategy an order belongs to, for mass cancels; 0 for none.
+using OwnerId = std::uint32_t;
+constexpr OwnerId kNoOwner = 0;
+
 // Enum to represent order side.
 enum class OrderType {
     BUY,
     SELL
 };
 
+// How long an order may stay on the book.
+enum class TimeInForce : std::uint8_t {
+    GTC,    // Rests until filled or cancelled.
+    IOC,    // Fills what it can on arrival; the rest is cancelled.
+    FOK     // Fills in full on arrival, or is refused.
+};
+
+// Execution flags, combined in Order::flags.
+enum OrderFlag : std::uint8_t {
+    ORDER_MARKET = 1 << 0,      // No limit price: takes liquidity until filled or the side is empty; never rests.
+    ORDER_POST_ONLY = 1 << 1,   // Only adds liquidity: refused if it would trade on arrival.
+    ORDER_STOP = 1 << 2         // Dormant until a trade prints at or through stopPrice; then
+                                // enters as a market (with ORDER_MARKET) or limit order.
+};
+
+// Why the book refused an add or cancel.
+enum class RejectReason : std::uint8_t {
+    NONE,
+    DUPLICATE_ORDER_ID,
+    UNKNOWN_ORDER,
+    INVALID_ORDER,      // Contradictory flags, e.g. a post-only IOC or stop.
+    WOULD_CROSS,        // Post-only order would have traded.
+    NOT_FILLABLE,       // FOK order could not be filled in full.
+    UNKNOWN_SYMBOL,     // No book for the symbol and the engine may not create one.
+    ORDER_IDS_EXHAUSTED // The book assigns IDs and has handed out the last one.
+};
+
 // Structure to represent a trade execution.
 struct Trade {
     OrderId buyOrderID;    // ID of the buy order involved in the trade
@@ -27,6 +65,100 @@ struct Trade {
     Price tradePrice;      // Price at which the trade was executed
 };
 
+// One change to a book, in the order it happened. Order entries (L3) name a
+// resting order; LEVEL entries (L2) carry a level's new totals, with zero
+// quantity meaning the level is gone.
+struct BookDelta {
+    enum class Type : std::uint8_t {
+        ORDER_ADDED,     // `quantity` rests at `price`.
+        ORDER_REMOVED,   // Cancelled with `quantity` left.
+        ORDER_EXECUTED,  // `quantity` filled; `remaining` left (0 = removed).
+        ORDER_MODIFIED,  // Now `quantity` at `price`. Same price and smaller: kept its
+                         // place; otherwise moved to the back of the level.
+        LEVEL            // Level now holds `quantity` over `orderCount` orders.
+    };
+
+    Type type = Type::LEVEL;
+    OrderType side = OrderType::BUY;
+    OrderId orderId = 0;
+    Price price = 0.0;
+    std::int64_t quantity = 0;
+    int remaining = 0;
+    std::uint32_t orderCount = 0;
+};
+
+// Aggregated state of one price level.
+struct DepthLevel {
+    Price price = 0.0;
+    std::int64_t quantity = 0;
+    std::uint32_t orderCount = 0;
+};
+
+// The best levels of each side, best first, as of `sequence`
+// (the book's updateSequence()).
+struct BookDepth {
+    std::uint64_t sequence = 0;
+    std::vector<DepthLevel> bids;
+    std::vector<DepthLevel> asks;
+};
+
+// Instrument identifier (e.g. "AAPL"), stored inline so orders stay
+// trivially copyable. Longer names are truncated to kMaxLength characters.
+class Symbol {
+public:
+    static constexpr std::size_t kMaxLength = 15;
+
+    Symbol() { chars_.fill('\0'); }
+
+    Symbol(const char* text) {
+        chars_.fill('\0');
+        std::strncpy(chars_.data(), text, kMaxLength);
+    }
+
+    Symbol(const std::string& text) : Symbol(text.c_str()) {}
+
+    const char* c_str() const { return chars_.data(); }
+    std::string str() const { return std::string(chars_.data()); }
+    bool empty() const { return chars_[0] == '\0'; }
+
+    bool operator==(const Symbol& other) const { return chars_ == other.chars_; }
+    bool operator!=(const Symbol& other) const { return chars_ != other.chars_; }
+    bool operator<(const Symbol& other) const { return chars_ < other.chars_; }
+
+    // FNV-1a over the characters; also used to pick a symbol's shard.
+    std::size_t hash() const {
+        std::uint64_t h = 14695981039346656037ULL;
+        for (char c : chars_) {
+            if (c == '\0') {
+                break;
+            }
+            h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+        return static_cast<std::size_t>(h);
+    }
+
+private:
+    std::array<char, kMaxLength + 1> chars_;
+};
+
+struct SymbolHash {
+    std::size_t operator()(const Symbol& symbol) const { return symbol.hash(); }
+};
+
+// Per-instrument price grid. Prices are snapped to the nearest multiple of
+// tickSize on entry; levels between minPrice and maxPrice are kept in a flat
+// array, anything outside the band goes to a sparse overflow map.
+//
+// With assignOrderIds the book numbers accepted orders itself, 1, 2, 3, ...,
+// overwriting the ID the client sent, and indexes them in a table addressed
+// by ID instead of a hash table.
+struct InstrumentConfig {
+    Price tickSize = 0.01;
+    Price minPrice = 0.0;
+    Price maxPrice = 1000.0;
+    bool assignOrderIds = false;
+};
+
 // Order class.
 class Order {
 public:
@@ -35,6 +167,11 @@ public:
     int quantity;
     OrderType orderType;
     std::chrono::system_clock::time_point timestamp;
+    Symbol symbol;
+    TimeInForce timeInForce = TimeInForce::GTC;
+    std::uint8_t flags = 0;     // OrderFlag bits.
+    Price stopPrice = 0.0;      // Trigger price of an ORDER_STOP order.
+    OwnerId owner = kNoOwner;
 
     Order()
         : orderID(0), price(0.0), quantity(0),
@@ -48,20 +185,79 @@ public:
         timestamp(std::chrono::system_clock::now()) {
     }
 
+    Order(OrderId id, Price p, int qty, OrderType type, const Symbol& sym)
+        : orderID(id), price(p), quantity(qty),
+        orderType(type),
+        timestamp(std::chrono::system_clock::now()),
+        symbol(sym) {
+    }
+
     // Getters for convenience
     OrderType GetSide() const { return orderType; }
     Price GetPrice() const { return price; }
     OrderId GetOrderId() const { return orderID; }
+    TimeInForce GetTimeInForce() const { return timeInForce; }
+    bool IsMarket() const { return (flags & ORDER_MARKET) != 0; }
+    bool IsPostOnly() const { return (flags & ORDER_POST_ONLY) != 0; }
+    bool IsStop() const { return (flags & ORDER_STOP) != 0; }
 };
 
-// For each price level, orders are kept in a list (to preserve FIFO ordering).
+// One entry of a batch applied with OrderBook::applyBatch.
+struct BookCommand {
+    enum class Type {
+        ADD,     // Add `order`.
+        CANCEL,  // Cancel `orderId`.
+        MODIFY   // Give `orderId` the price and quantity of `order`.
+    };
+
+    Type type = Type::ADD;
+    Order order;
+    OrderId orderId = 0;
+};
+
+// Which orders OrderBook::cancelOrders removes: those matching every filter
+// that is set. A price range only selects resting orders, by limit price;
+// dormant stops are only reached through the owner and side filters. Either
+// price bound may be left open.
+struct MassCancel {
+    OwnerId owner = kNoOwner;       // Only this owner's orders, unless kNoOwner.
+    bool bySide = false;
+    OrderType side = OrderType::BUY;
+    bool hasMinPrice = false;
+    Price minPrice = 0.0;           // Inclusive bounds.
+    bool hasMaxPrice = false;
+    Price maxPrice = 0.0;
+
+    bool byPrice() const { return hasMinPrice || hasMaxPrice; }
+};
+
+// Outcome of one batch entry. Its trades are trades[firstTrade, firstTrade + tradeCount).
+struct BookCommandResult {
+    bool accepted = false;
+    std::uint64_t sequence = 0;     // Stamped by the engine's sequencer; 0 from the book.
+    std::size_t firstTrade = 0;
+    std::size_t tradeCount = 0;
+    RejectReason reject = RejectReason::NONE;
+    OrderId orderId = 0;            // ADD: the ID the order was accepted under.
+};
+
+// Orders handed to the compatibility API are shared with the caller.
 using OrderPointer = std::shared_ptr<Order>;
-using OrderPointers = std::list<OrderPointer>;
 
-// When an order is inserted, we remember its location (iterator) in the list.
-struct OrderEntry {
-    OrderPointer order_{ nullptr };
-    OrderPointers::iterator location_;
+// A resting order lives in a pooled slot and is linked into its price level's
+// FIFO through prev/next, so no per-order node is allocated. A dormant stop
+// order uses the same slot, linked into the FIFO of its trigger level.
+struct OrderSlot {
+    Order order;
+    Tick tick{ 0 };     // Limit tick, or trigger tick while the order is a dormant stop.
+    SlotIndex prev{ kInvalidSlot };
+    SlotIndex next{ kInvalidSlot };
+    // List of the owner's orders, if the order has an owner.
+    SlotIndex ownerPrev{ kInvalidSlot };
+    SlotIndex ownerNext{ kInvalidSlot };
+    // Only set for orders added through addOrder(OrderPointer): the caller's
+    // copy is kept in sync with the pooled quantity.
+    OrderPointer mirror_;
 };
 
 //
@@ -69,30 +265,275 @@ struct OrderEntry {
 //
 class OrderBook {
 private:
-    // Bids: sorted by price descending (using std::greater).
-    std::map<Price, OrderPointers, std::greater<Price>> bids_;
+    InstrumentConfig config_;
+
+    // Bids: best is the highest tick.
+    PriceLadder bids_;
+
+    // Asks: best is the lowest tick.
+    PriceLadder asks_;
+
+    // Map from order ID to the slot holding the order: DIRECT when the book
+    // assigns IDs, HASHED otherwise.
+    OrderIndex orders_;
+
+    // Storage for every resting order and dormant stop.
+    OrderPool<OrderSlot> pool_;
+
+    // Dormant stop orders by trigger tick, kept apart from the visible book.
+    // A buy stop fires once a trade prints at or above its tick, a sell stop
+    // at or below, so each side's next trigger is at one end of its map and
+    // checking a trade costs O(1) plus O(log n) per level that fires.
+    std::map<Tick, PriceLevel> buyStops_;
+    std::map<Tick, PriceLevel> sellStops_;
+    OrderIndex stops_;
+
+    // Next ID to assign (assignOrderIds), and the ID of the last accepted add.
+    OrderId nextOrderId_ = 1;
+    OrderId lastOrderId_ = 0;
 
-    // Asks: sorted by price ascending (using std::less, the default).
-    std::map<Price, OrderPointers, std::less<Price>> asks_;
+    // Stops fired and waiting to enter the book, in firing order. Reused.
+    std::vector<SlotIndex> triggered_;
 
-    // Map from order ID to OrderEntry (so we know exactly where the order is stored).
-    std::unordered_map<OrderId, OrderEntry> orders_;
+    // Head of each owner's list of resting orders and dormant stops, linked
+    // through the slots' ownerPrev/ownerNext, newest first.
+    std::unordered_map<OwnerId, SlotIndex> owners_;
+
+    // Levels a mass cancel emptied or shrank, reported once it is done. Reused.
+    std::vector<std::pair<OrderType, Tick>> touchedLevels_;
 
     // Internal matching routine.
-    void matchOrders(OrderPointer order, std::vector<Trade>& trades);
+    void matchOrders(Order& order, Tick orderTick, std::vector<Trade>& trades);
+
+    // Fills `order` against the FIFO of `level` (at `levelTick`) until one side is exhausted.
+    void fillFromLevel(Order& order, Tick orderTick, PriceLevel& level, Tick levelTick, std::vector<Trade>& trades);
+
+    // Core insertion shared by the addOrder overloads.
+    bool addPooledOrder(Order& order, const OrderPointer& mirror, std::vector<Trade>& trades, RejectReason* reason);
+
+    // Tick an order trades up to: its limit, or the far end of the range for a market order.
+    Tick limitTick(const Order& order) const;
+
+    // Stamps an order that passed its checks with its assigned ID, if the
+    // book assigns them, and records it as the last accepted.
+    void acceptOrderId(Order& order);
+
+    // Links the pooled order at `index` to the back of its level at `tick` and indexes it.
+    void restOrder(SlotIndex index, Tick tick);
+
+    // Parks a pooled stop order on its trigger level.
+    void armStop(SlotIndex index);
+
+    // Cancels a dormant stop; false if `orderId` is not one.
+    bool cancelStop(OrderId orderId);
+
+    // Fires the stops that trades[firstTrade, end) reach and enters them, in
+    // firing order, until no trade they print fires another one.
+    void releaseStops(std::vector<Trade>& trades, std::size_t firstTrade);
+
+    // Moves every stop that a trade at `tick` fires to `triggered_`.
+    void collectTriggered(Tick tick);
+
+    // Unlinks every order of a stop level, oldest first, into `triggered_`.
+    void drainStopLevel(PriceLevel& level);
+
+    // Enters a fired stop's pooled order like a newly arrived one.
+    void enterTriggered(SlotIndex index, std::vector<Trade>& trades);
+
+    // True if an order on `side` limited at `tick` would trade on arrival.
+    bool crosses(OrderType side, Tick tick) const;
+
+    // True if the opposite side holds at least `quantity` at prices `tick`
+    // accepts. Sums level totals; never visits individual orders.
+    bool canFill(OrderType side, Tick tick, std::int64_t quantity) const;
+
+    PriceLadder& sideFor(OrderType type) { return type == OrderType::BUY ? bids_ : asks_; }
+
+    // Owner list maintenance; no-ops for an order without owner.
+    void linkOwner(SlotIndex index);
+    void unlinkOwner(SlotIndex index);
+
+    // Returns a slot whose order has left the book to the pool.
+    void releaseSlot(SlotIndex index);
+
+    // Removes one resting order for a mass cancel, leaving its level's delta
+    // (and deactivation) to the end of it through touchedLevels_.
+    void cancelResting(SlotIndex index);
+
+    // Removes one dormant stop, without a sequence step.
+    void removeStop(SlotIndex index);
+
+    // A mass-cancel price bound as a tick, saturating at the ends of the
+    // tick range instead of overflowing.
+    Tick boundTick(Price price) const;
+
+    // True if the owner's order in `slot` is one `filter` selects, given the
+    // filter's price bounds as ticks.
+    bool matchesCancel(const MassCancel& filter, Tick low, Tick high, const OrderSlot& slot) const;
+
+    // FIFO maintenance; also keeps the level's totals.
+    void appendToLevel(PriceLevel& level, SlotIndex index);
+    void unlinkFromLevel(PriceLevel& level, SlotIndex index);
+
+    // Change feed: deltas go to `deltas_` while a sink is attached.
+    std::vector<BookDelta>* deltas_ = nullptr;
+    std::uint64_t updateSequence_ = 0;
+
+    void emitOrder(BookDelta::Type type, const Order& order, std::int64_t quantity) {
+        if (deltas_ != nullptr) {
+            BookDelta delta;
+            delta.type = type;
+            delta.side = order.GetSide();
+            delta.orderId = order.GetOrderId();
+            delta.price = order.GetPrice();
+            delta.quantity = quantity;
+            delta.remaining = order.quantity;
+            deltas_->push_back(delta);
+        }
+    }
+
+    void emitLevel(OrderType side, Tick tick, const PriceLevel& level) {
+        if (deltas_ != nullptr) {
+            BookDelta delta;
+            delta.side = side;
+            delta.price = toPrice(tick);
+            delta.quantity = level.quantity;
+            delta.orderCount = level.orderCount;
+            deltas_->push_back(delta);
+        }
+    }
 
 public:
+    // Default number of slots preallocated per book.
+    static constexpr std::size_t kDefaultOrderCapacity = 1 << 14;
+
+    explicit OrderBook(const InstrumentConfig& config = InstrumentConfig(),
+        std::size_t expectedOrders = kDefaultOrderCapacity);
+
+    // Conversions between API prices and engine ticks. toTick() needs a
+    // price validPrice() accepts.
+    Tick toTick(Price price) const;
+    Price toPrice(Tick tick) const;
+
+    // True if `price` is finite and its tick is well inside the Tick range,
+    // so neither it nor a neighbouring tick can be kNoTick or overflow.
+    // Orders and modifies with any other price are refused as INVALID_ORDER.
+    bool validPrice(Price price) const;
+
     // Adds an order to the order book. If the order is not fully matched, it is inserted.
+    // The order is copied into the pool; nothing is allocated in steady state.
+    std::vector<Trade> addOrder(const Order& order);
+
+    // Same, appending executions to `trades`. Returns false, with the cause in
+    // `reason` if given, when the order is refused (duplicate ID, invalid
+    // flags, post-only that would cross, FOK that cannot fill). An accepted
+    // IOC or market order never rests; whatever did not fill is dropped.
+    //
+    // An ORDER_STOP order is held out of the book until a later trade prints
+    // at or through its stopPrice (at or above for a buy, at or below for a
+    // sell); it then enters as a market or limit order under its own time in
+    // force. Stops enter in the order they fired: trade by trade; for one
+    // trade, buys before sells, each in the order a moving price reaches
+    // them (lowest buy trigger first, highest sell trigger first), oldest
+    // first within a trigger price. Trades they print may fire
+    // further stops, which queue behind; the cascade is run as a loop, all
+    // within the same command and updateSequence() step.
+    //
+    // If the book assigns IDs, the accepted order gets the next one, which
+    // lastOrderId() returns; trades and deltas carry it.
+    bool addOrder(const Order& order, std::vector<Trade>& trades, RejectReason* reason = nullptr);
+
+    // Compatibility overload: the remaining quantity of `order` is written back
+    // while it rests on the book, like the previous shared_ptr-based storage did.
     std::vector<Trade> addOrder(OrderPointer order);
 
-    // Cancels an order by its order ID (using the stored iterator for fast removal).
+    // Cancels a resting order or dormant stop by its order ID (O(1) unlink
+    // from its level).
     bool cancelOrder(OrderId orderId);
 
+    // Cancels every resting order and dormant stop `filter` selects in one
+    // pass, as one updateSequence() step: an ORDER_REMOVED delta per order,
+    // then one LEVEL delta per level it changed. Appends the IDs removed to
+    // `cancelled` if given and returns how many there were. With an owner it
+    // walks only that owner's orders; otherwise the levels of the side(s).
+    std::size_t cancelOrders(const MassCancel& filter, std::vector<OrderId>* cancelled = nullptr);
+
+    // Shorthands for cancelOrders; kNoOwner selects every owner.
+    std::size_t cancelAll(OwnerId owner);
+    std::size_t cancelBySide(OrderType side, OwnerId owner = kNoOwner);
+    std::size_t cancelByPriceRange(OrderType side, Price minPrice, Price maxPrice, OwnerId owner = kNoOwner);
+
+    // Changes a resting order's price and quantity in one step, with one
+    // updateSequence() step and one ORDER_MODIFIED delta. A quantity
+    // reduction at the same price keeps the order's queue position; a larger
+    // quantity or a new price sends it to the back of its (new) level. A new
+    // price may trade on the way, with executions appended to `trades`; an
+    // order filled in full that way leaves the book (ORDER_REMOVED with zero
+    // quantity). Returns false, with the cause in `reason` if given, for an
+    // unknown ID (dormant stops included), a non-positive quantity, or a
+    // post-only order whose new price would cross; the order is then untouched.
+    bool modifyOrder(OrderId orderId, Price newPrice, int newQuantity,
+        std::vector<Trade>& trades, RejectReason* reason = nullptr);
+
+    // Applies `commands` in order as a single update: one updateSequence()
+    // step, with the deltas of every entry, so feeds publish the batch once.
+    // `results` gets one entry per command; executions are appended to `trades`.
+    // Returns true if any entry changed the book.
+    bool applyBatch(const std::vector<BookCommand>& commands,
+        std::vector<BookCommandResult>& results, std::vector<Trade>& trades);
+
     // Displays the current order book.
     void displayOrders() const;
 
-    // Returns raw order book data (for example, for JSON conversion).
-    std::pair<std::vector<OrderPointer>, std::vector<OrderPointer>> getRawOrderBookData() const;
+    // Returns raw order book data (for example, for JSON conversion): the
+    // orders of the best `levels` levels per side, in priority order.
+    std::pair<std::vector<Order>, std::vector<Order>> getRawOrderBookData(
+        std::size_t levels = std::numeric_limits<std::size_t>::max()) const;
+
+    // Returns up to `levels` aggregated levels per side, best first. Reads the
+    // per-level totals, so it costs O(levels) whatever the number of orders.
+    BookDepth getDepth(std::size_t levels) const;
+
+    // Appends a compact image of every level and resting order, best level
+    // first on each side, then of every dormant stop, to `out`.
+    void saveSnapshot(SnapshotWriter& out) const;
+
+    // Rebuilds an empty book from an image written by saveSnapshot, sizing
+    // the pool and order index once up front. Returns false on a malformed
+    // image. Restored orders are tagged with `symbol`.
+    bool loadSnapshot(SnapshotReader& in, const Symbol& symbol);
+
+    const InstrumentConfig& config() const { return config_; }
+
+    // Attaches (or with nullptr detaches) a buffer that receives a BookDelta
+    // for every change the following calls make to the book.
+    void setDeltaSink(std::vector<BookDelta>* sink) { deltas_ = sink; }
+
+    // Number of accepted adds, cancels and modifies so far; a delta consumer
+    // that sees this jump by more than one has missed an update.
+    std::uint64_t updateSequence() const { return updateSequence_; }
+
+    // Number of resting orders.
+    std::size_t size() const { return orders_.size(); }
+
+    // Number of resting orders and dormant stops held by `owner`.
+    std::size_t ownerOrderCount(OwnerId owner) const;
+
+    // Number of dormant stop orders.
+    std::size_t stopCount() const { return stops_.size(); }
+
+    // True if `orderId` is resting on the book.
+    bool hasOrder(OrderId orderId) const { return orders_.contains(orderId); }
+
+    // ID of the most recently accepted add: the client's, or the one the book
+    // assigned it.
+    OrderId lastOrderId() const { return lastOrderId_; }
+
+    // Bytes held by the order ID indexes.
+    std::size_t indexMemoryBytes() const { return orders_.memoryBytes() + stops_.memoryBytes(); }
+
+    // Number of preallocated order slots (for checking steady-state reuse).
+    std::size_t poolCapacity() const { return pool_.capacity(); }
 };
 
 #endif // ORDER_BOOK_H
@@ -0,0 +1,274 @@
+#ifndef ORDER_INDEX_H
+#define ORDER_INDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "order_pool.h"
+
+//
+// Flat map from order ID to the pool slot holding the order, in one of two
+// layouts:
+//
+// HASHED, for client-chosen IDs: open addressing with linear probing over a
+// power-of-two array of 8-byte {id, slot} entries, kept at most 3/4 full. IDs
+// are spread by Fibonacci hashing, so sequential and random IDs alike land
+// one probe from home on average, usually in the cache line first touched.
+// Erasure shifts the following entries back instead of leaving tombstones.
+// Memory is 8 bytes per entry at between 3/8 and 3/4 occupancy: 128 MB for
+// 10M live orders.
+//
+// DIRECT, for IDs the book assigns in increasing order: a slot table indexed
+// by (id - base), covering the IDs from the oldest live order to the newest.
+// A lookup is one load; no hashing or probing. The dead prefix is dropped once
+// it makes up half the table, so memory is 4 bytes per ID in that span. One
+// long-lived order pins the span while others churn past it, so once the
+// span exceeds kMaxSpanPerOrder IDs per live order the index moves its
+// entries to the HASHED layout, and goes back to DIRECT when it next empties.
+//
+class OrderIndex {
+public:
+    enum class Layout { HASHED, DIRECT };
+
+    explicit OrderIndex(Layout layout = Layout::HASHED, std::size_t expected = 0)
+        : layout_(layout), preferred_(layout) {
+        reserve(expected);
+    }
+
+    Layout layout() const { return layout_; }
+
+    // Makes room for `count` orders without rehashing (HASHED) or growing (DIRECT).
+    void reserve(std::size_t count) {
+        if (layout_ == Layout::DIRECT) {
+            direct_.reserve(count);
+            return;
+        }
+        std::size_t capacity = kMinCapacity;
+        while (capacity * 3 / 4 < count) {
+            capacity <<= 1;
+        }
+        if (capacity > entries_.size()) {
+            rehash(capacity);
+        }
+    }
+
+    // Slot of `id`, or kInvalidSlot.
+    SlotIndex find(int id) const {
+        if (layout_ == Layout::DIRECT) {
+            std::int64_t offset = static_cast<std::int64_t>(id) - base_;
+            return offset >= 0 && offset < static_cast<std::int64_t>(direct_.size())
+                ? direct_[static_cast<std::size_t>(offset)] : kInvalidSlot;
+        }
+        if (size_ == 0) {
+            return kInvalidSlot;
+        }
+        for (std::size_t i = home(id);; i = (i + 1) & mask_) {
+            const Entry& entry = entries_[i];
+            if (entry.slot == kInvalidSlot) {
+                return kInvalidSlot;
+            }
+            if (entry.id == id) {
+                return entry.slot;
+            }
+        }
+    }
+
+    bool contains(int id) const { return find(id) != kInvalidSlot; }
+
+    // Adds `id`, which must not be present.
+    void insert(int id, SlotIndex slot) {
+        if (layout_ == Layout::DIRECT && !fitsDirect(id)) {
+            convertToHashed();
+        }
+        size_++;
+        if (layout_ == Layout::DIRECT) {
+            insertDirect(id, slot);
+            return;
+        }
+        if (size_ > entries_.size() * 3 / 4) {
+            rehash(entries_.size() * 2);
+        }
+        std::size_t i = home(id);
+        while (entries_[i].slot != kInvalidSlot) {
+            i = (i + 1) & mask_;
+        }
+        entries_[i] = Entry{ id, slot };
+    }
+
+    // Removes `id`; false if it was not present.
+    bool erase(int id) {
+        if (layout_ == Layout::DIRECT) {
+            return eraseDirect(id);
+        }
+        if (size_ == 0) {
+            return false;
+        }
+        std::size_t i = home(id);
+        while (entries_[i].id != id || entries_[i].slot == kInvalidSlot) {
+            if (entries_[i].slot == kInvalidSlot) {
+                return false;
+            }
+            i = (i + 1) & mask_;
+        }
+        // Backward shift: pull later entries of the probe run into the hole
+        // unless that would move them before their home.
+        for (std::size_t next = (i + 1) & mask_;; next = (next + 1) & mask_) {
+            const Entry& entry = entries_[next];
+            if (entry.slot == kInvalidSlot) {
+                break;
+            }
+            std::size_t wanted = home(entry.id);
+            if (((next - wanted) & mask_) >= ((next - i) & mask_)) {
+                entries_[i] = entry;
+                i = next;
+            }
+        }
+        entries_[i] = Entry{};
+        size_--;
+        if (size_ == 0 && preferred_ == Layout::DIRECT) {
+            std::vector<Entry>().swap(entries_);
+            layout_ = Layout::DIRECT;
+        }
+        return true;
+    }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Bytes held by the index itself.
+    std::size_t memoryBytes() const {
+        return entries_.capacity() * sizeof(Entry) + direct_.capacity() * sizeof(SlotIndex);
+    }
+
+private:
+    struct Entry {
+        int id = 0;
+        SlotIndex slot = kInvalidSlot;     // kInvalidSlot marks an empty entry.
+    };
+
+    static constexpr std::size_t kMinCapacity = 16;
+
+    // A DIRECT table that would span more IDs than this per live order (and
+    // more than kMinDirectSpan in all) is converted to HASHED.
+    static constexpr std::size_t kMaxSpanPerOrder = 16;
+    static constexpr std::size_t kMinDirectSpan = 1 << 12;
+
+    std::size_t home(int id) const {
+        std::uint64_t hash = static_cast<std::uint64_t>(static_cast<std::uint32_t>(id)) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<std::size_t>(hash >> shift_);
+    }
+
+    void rehash(std::size_t capacity) {
+        std::vector<Entry> old;
+        old.swap(entries_);
+        entries_.assign(capacity, Entry{});
+        mask_ = capacity - 1;
+        shift_ = 64;
+        for (std::size_t c = capacity; c > 1; c >>= 1) {
+            shift_--;
+        }
+        for (const Entry& entry : old) {
+            if (entry.slot != kInvalidSlot) {
+                std::size_t i = home(entry.id);
+                while (entries_[i].slot != kInvalidSlot) {
+                    i = (i + 1) & mask_;
+                }
+                entries_[i] = entry;
+            }
+        }
+    }
+
+    void insertDirect(int id, SlotIndex slot) {
+        if (direct_.empty()) {
+            base_ = id;
+            dead_ = 0;
+        }
+        else if (id < base_) {
+            // Only when restoring out of ID order: extend the front, with
+            // headroom so a descending run of IDs stays linear overall.
+            std::size_t needed = static_cast<std::size_t>(base_ - static_cast<std::int64_t>(id));
+            std::size_t grow = std::max(needed, direct_.size());
+            direct_.insert(direct_.begin(), grow, kInvalidSlot);
+            dead_ += grow;
+            base_ -= static_cast<std::int64_t>(grow);
+        }
+        std::size_t offset = static_cast<std::size_t>(static_cast<std::int64_t>(id) - base_);
+        if (offset >= direct_.size()) {
+            direct_.resize(offset + 1, kInvalidSlot);
+        }
+        if (offset < dead_) {
+            dead_ = offset;
+        }
+        direct_[offset] = slot;
+    }
+
+    // Whether the DIRECT table can take `id` and still span at most
+    // kMaxSpanPerOrder IDs per live order.
+    bool fitsDirect(int id) const {
+        if (direct_.empty()) {
+            return true;
+        }
+        std::int64_t first = std::min<std::int64_t>(id, base_ + static_cast<std::int64_t>(dead_));
+        std::int64_t last = std::max<std::int64_t>(id, base_ + static_cast<std::int64_t>(direct_.size()) - 1);
+        std::size_t span = static_cast<std::size_t>(last - first) + 1;
+        return span <= kMinDirectSpan || span <= kMaxSpanPerOrder * (size_ + 1);
+    }
+
+    // Moves the live entries of a sparse DIRECT table into a hash table.
+    void convertToHashed() {
+        std::vector<SlotIndex> direct;
+        direct.swap(direct_);
+        std::size_t live = size_;
+        layout_ = Layout::HASHED;
+        size_ = 0;
+        reserve(live);
+        for (std::size_t i = dead_; i < direct.size(); i++) {
+            if (direct[i] != kInvalidSlot) {
+                insert(static_cast<int>(base_ + static_cast<std::int64_t>(i)), direct[i]);
+            }
+        }
+        base_ = 0;
+        dead_ = 0;
+    }
+
+    bool eraseDirect(int id) {
+        std::int64_t offset = static_cast<std::int64_t>(id) - base_;
+        if (offset < 0 || offset >= static_cast<std::int64_t>(direct_.size())
+            || direct_[static_cast<std::size_t>(offset)] == kInvalidSlot) {
+            return false;
+        }
+        direct_[static_cast<std::size_t>(offset)] = kInvalidSlot;
+        size_--;
+        // Advance past the dead prefix; drop it once it is half the table.
+        while (dead_ < direct_.size() && direct_[dead_] == kInvalidSlot) {
+            dead_++;
+        }
+        if (dead_ == direct_.size()) {
+            direct_.clear();
+            dead_ = 0;
+        }
+        else if (dead_ >= kMinCapacity && dead_ * 2 >= direct_.size()) {
+            direct_.erase(direct_.begin(), direct_.begin() + static_cast<std::ptrdiff_t>(dead_));
+            base_ += static_cast<std::int64_t>(dead_);
+            dead_ = 0;
+        }
+        return true;
+    }
+
+    Layout layout_;
+    Layout preferred_;      // The layout asked for; layout_ can fall back to HASHED.
+    std::size_t size_ = 0;
+
+    // HASHED.
+    std::vector<Entry> entries_;
+    std::size_t mask_ = 0;
+    unsigned shift_ = 64;
+
+    // DIRECT: direct_[i] is the slot of ID base_ + i; the first dead_ are empty.
+    std::vector<SlotIndex> direct_;
+    std::int64_t base_ = 0;
+    std::size_t dead_ = 0;
+};
+
+#endif // ORDER_INDEX_H
@@ -0,0 +1,79 @@
+#ifndef ORDER_POOL_H
+#define ORDER_POOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+// Index of an order slot inside an OrderPool.
+using SlotIndex = std::uint32_t;
+
+// Sentinel used for "no slot" (end of a FIFO, empty free list, ...).
+constexpr SlotIndex kInvalidSlot = std::numeric_limits<SlotIndex>::max();
+
+//
+// Slab of preallocated slots. Slots are addressed by index rather than by
+// pointer, so the slab can grow without invalidating any stored links.
+// Released slots are threaded onto an intrusive free list and reused, which
+// means a book in steady state never touches the heap.
+//
+template <typename Slot>
+class OrderPool {
+public:
+    explicit OrderPool(std::size_t capacity = 0) {
+        reserve(capacity);
+    }
+
+    // Makes sure at least `capacity` slots exist.
+    void reserve(std::size_t capacity) {
+        if (capacity <= slots_.size()) {
+            return;
+        }
+        std::size_t first = slots_.size();
+        slots_.resize(capacity);
+        // Thread the new slots onto the free list, lowest index first.
+        for (std::size_t i = capacity; i-- > first;) {
+            slots_[i].next = freeHead_;
+            freeHead_ = static_cast<SlotIndex>(i);
+        }
+    }
+
+    // Takes a slot off the free list, doubling the slab if it is exhausted.
+    // References to slots are invalidated by growth; indices are not.
+    SlotIndex allocate() {
+        if (freeHead_ == kInvalidSlot) {
+            reserve(slots_.empty() ? 64 : slots_.size() * 2);
+        }
+        SlotIndex index = freeHead_;
+        freeHead_ = slots_[index].next;
+        slots_[index].prev = kInvalidSlot;
+        slots_[index].next = kInvalidSlot;
+        ++live_;
+        return index;
+    }
+
+    // Returns a slot to the free list.
+    void release(SlotIndex index) {
+        slots_[index].prev = kInvalidSlot;
+        slots_[index].next = freeHead_;
+        freeHead_ = index;
+        --live_;
+    }
+
+    Slot& operator[](SlotIndex index) { return slots_[index]; }
+    const Slot& operator[](SlotIndex index) const { return slots_[index]; }
+
+    // Number of slots currently handed out.
+    std::size_t size() const { return live_; }
+
+    // Number of slots allocated up front (live + free).
+    std::size_t capacity() const { return slots_.size(); }
+
+private:
+    std::vector<Slot> slots_;
+    SlotIndex freeHead_ = kInvalidSlot;
+    std::size_t live_ = 0;
+};
+
+#endif // ORDER_POOL_H
@@ -1,157 +1,887 @@
 #include "order_book.h"
 #include <algorithm>
 #include <iostream>
+#include <cmath>
 #include <iterator>
+#include <limits>
+
+namespace {
+
+// Prices must snap to ticks of magnitude below 2^62: tick arithmetic then
+// never overflows and never produces kNoTick.
+constexpr double kMaxTickMagnitude = 4611686018427387904.0;
+
+// Records why an add or modify was refused; always returns false.
+bool refuse(RejectReason* reason, RejectReason why) {
+    if (reason != nullptr) {
+        *reason = why;
+    }
+    return false;  // Rejected: no trades are produced.
+}
+
+} // namespace
+
+OrderBook::OrderBook(const InstrumentConfig& config, std::size_t expectedOrders)
+    : config_(config),
+    bids_(PriceLadder::Direction::DESCENDING, toTick(config.minPrice), toTick(config.maxPrice)),
+    asks_(PriceLadder::Direction::ASCENDING, toTick(config.minPrice), toTick(config.maxPrice)),
+    orders_(config.assignOrderIds ? OrderIndex::Layout::DIRECT : OrderIndex::Layout::HASHED, expectedOrders),
+    pool_(expectedOrders) {
+}
+
+// Snap a price to the nearest tick.
+Tick OrderBook::toTick(Price price) const {
+    return static_cast<Tick>(std::llround(price / config_.tickSize));
+}
+
+bool OrderBook::validPrice(Price price) const {
+    double ticks = price / config_.tickSize;
+    return std::isfinite(ticks) && std::fabs(ticks) < kMaxTickMagnitude;
+}
+
+Tick OrderBook::boundTick(Price price) const {
+    double ticks = price / config_.tickSize;
+    if (ticks >= kMaxTickMagnitude) {
+        return std::numeric_limits<Tick>::max();
+    }
+    if (ticks <= -kMaxTickMagnitude) {
+        return kNoTick;
+    }
+    return static_cast<Tick>(std::llround(ticks));
+}
+
+Price OrderBook::toPrice(Tick tick) const {
+    return static_cast<Price>(tick) * config_.tickSize;
+}
+
+// Append a pooled order to the tail of a level's FIFO.
+void OrderBook::appendToLevel(PriceLevel& level, SlotIndex index) {
+    OrderSlot& slot = pool_[index];
+    slot.prev = level.tail;
+    slot.next = kInvalidSlot;
+    if (level.tail != kInvalidSlot) {
+        pool_[level.tail].next = index;
+    }
+    else {
+        level.head = index;
+    }
+    level.tail = index;
+    level.quantity += slot.order.quantity;
+    level.orderCount++;
+}
+
+// Remove a pooled order from anywhere in a level's FIFO.
+void OrderBook::unlinkFromLevel(PriceLevel& level, SlotIndex index) {
+    OrderSlot& slot = pool_[index];
+    if (slot.prev != kInvalidSlot) {
+        pool_[slot.prev].next = slot.next;
+    }
+    else {
+        level.head = slot.next;
+    }
+    if (slot.next != kInvalidSlot) {
+        pool_[slot.next].prev = slot.prev;
+    }
+    else {
+        level.tail = slot.prev;
+    }
+    level.quantity -= slot.order.quantity;
+    level.orderCount--;
+}
+
+// Push an owned order at the head of its owner's list.
+void OrderBook::linkOwner(SlotIndex index) {
+    OrderSlot& slot = pool_[index];
+    slot.ownerPrev = kInvalidSlot;
+    slot.ownerNext = kInvalidSlot;
+    if (slot.order.owner == kNoOwner) {
+        return;
+    }
+    auto head = owners_.try_emplace(slot.order.owner, kInvalidSlot).first;
+    slot.ownerNext = head->second;
+    if (head->second != kInvalidSlot) {
+        pool_[head->second].ownerPrev = index;
+    }
+    head->second = index;
+}
+
+// Only removing an owner's newest or last order touches the map.
+void OrderBook::unlinkOwner(SlotIndex index) {
+    OrderSlot& slot = pool_[index];
+    if (slot.order.owner == kNoOwner) {
+        return;
+    }
+    if (slot.ownerPrev != kInvalidSlot) {
+        pool_[slot.ownerPrev].ownerNext = slot.ownerNext;
+    }
+    else if (slot.ownerNext != kInvalidSlot) {
+        owners_[slot.order.owner] = slot.ownerNext;
+    }
+    else {
+        owners_.erase(slot.order.owner);
+    }
+    if (slot.ownerNext != kInvalidSlot) {
+        pool_[slot.ownerNext].ownerPrev = slot.ownerPrev;
+    }
+}
+
+void OrderBook::releaseSlot(SlotIndex index) {
+    unlinkOwner(index);
+    pool_[index].mirror_.reset();
+    pool_.release(index);
+}
+
+// Helper: Fill against one price level, oldest order first.
+void OrderBook::fillFromLevel(Order& order, Tick orderTick, PriceLevel& level, Tick levelTick, std::vector<Trade>& trades) {
+    while (order.quantity > 0 && !level.empty()) {
+        SlotIndex restingIndex = level.head;
+        OrderSlot& resting = pool_[restingIndex];
+        int tradeQuantity = std::min(order.quantity, resting.order.quantity);
+        // Trades print at the sell order's limit price.
+        if (order.GetSide() == OrderType::BUY) {
+            trades.push_back({ order.GetOrderId(), resting.order.GetOrderId(), tradeQuantity, toPrice(levelTick) });
+        }
+        else {
+            // A market sell has no limit: it trades at the bid it hits.
+            Tick priceTick = order.IsMarket() ? levelTick : orderTick;
+            trades.push_back({ resting.order.GetOrderId(), order.GetOrderId(), tradeQuantity, toPrice(priceTick) });
+        }
+        order.quantity -= tradeQuantity;
+        resting.order.quantity -= tradeQuantity;
+        level.quantity -= tradeQuantity;
+        emitOrder(BookDelta::Type::ORDER_EXECUTED, resting.order, tradeQuantity);
+        if (resting.mirror_) {
+            resting.mirror_->quantity = resting.order.quantity;
+        }
+
+        // If the resting order is fully executed, remove it.
+        if (resting.order.quantity == 0) {
+            unlinkFromLevel(level, restingIndex);
+            orders_.erase(resting.order.GetOrderId());
+            releaseSlot(restingIndex);
+        }
+    }
+}
 
 // Helper: Matching orders.
 // For a BUY order, we try to match with the best (lowest-price) asks.
 // For a SELL order, we match with the best (highest-price) bids.
-void OrderBook::matchOrders(OrderPointer order, std::vector<Trade>& trades) {
-    if (order->GetSide() == OrderType::BUY) {
+// The best level is cached by the ladder, so each step is an array access.
+void OrderBook::matchOrders(Order& order, Tick orderTick, std::vector<Trade>& trades) {
+    if (order.GetSide() == OrderType::BUY) {
         // For a BUY order, match with asks (lowest price first).
-        while (order->quantity > 0 && !asks_.empty()) {
-            auto bestAskIt = asks_.begin(); // Lowest ask price.
-            Price askPrice = bestAskIt->first;
-            if (askPrice > order->GetPrice()) {
+        while (order.quantity > 0 && !asks_.empty()) {
+            Tick bestAsk = asks_.best();
+            if (bestAsk > orderTick) {
                 break; // Cannot match: best ask is above the buy price.
             }
-            // Get the FIFO order from this price level.
-            auto& askList = bestAskIt->second;
-            OrderPointer sellOrder = askList.front();
-            int tradeQuantity = std::min(order->quantity, sellOrder->quantity);
-            trades.push_back({ order->GetOrderId(), sellOrder->GetOrderId(), tradeQuantity, askPrice });
-            order->quantity -= tradeQuantity;
-            sellOrder->quantity -= tradeQuantity;
-
-            // If the sell order is fully executed, remove it.
-            if (sellOrder->quantity == 0) {
-                // Look up its stored location.
-                auto entryIt = orders_.find(sellOrder->GetOrderId());
-                if (entryIt != orders_.end()) {
-                    askList.erase(entryIt->second.location_);
-                    orders_.erase(entryIt);
-                }
-                if (askList.empty()) {
-                    asks_.erase(bestAskIt);
-                }
+            PriceLevel& level = *asks_.find(bestAsk);
+            fillFromLevel(order, orderTick, level, bestAsk, trades);
+            emitLevel(OrderType::SELL, bestAsk, level);
+            if (level.empty()) {
+                asks_.deactivate(bestAsk);
             }
         }
     }
     else {
         // For a SELL order, match with bids (highest price first).
-        while (order->quantity > 0 && !bids_.empty()) {
-            auto bestBidIt = bids_.begin(); // Highest bid price.
-            Price bidPrice = bestBidIt->first;
-            if (bidPrice < order->GetPrice()) {
+        while (order.quantity > 0 && !bids_.empty()) {
+            Tick bestBid = bids_.best();
+            if (bestBid < orderTick) {
                 break; // Cannot match: best bid is below the sell price.
             }
-            auto& bidList = bestBidIt->second;
-            OrderPointer buyOrder = bidList.front();
-            int tradeQuantity = std::min(order->quantity, buyOrder->quantity);
-            trades.push_back({ buyOrder->GetOrderId(), order->GetOrderId(), tradeQuantity, bidPrice });
-            order->quantity -= tradeQuantity;
-            buyOrder->quantity -= tradeQuantity;
-
-            if (buyOrder->quantity == 0) {
-                auto entryIt = orders_.find(buyOrder->GetOrderId());
-                if (entryIt != orders_.end()) {
-                    bidList.erase(entryIt->second.location_);
-                    orders_.erase(entryIt);
-                }
-                if (bidList.empty()) {
-                    bids_.erase(bestBidIt);
-                }
+            PriceLevel& level = *bids_.find(bestBid);
+            fillFromLevel(order, orderTick, level, bestBid, trades);
+            emitLevel(OrderType::BUY, bestBid, level);
+            if (level.empty()) {
+                bids_.deactivate(bestBid);
             }
         }
     }
 }
 
-// Add a new order to the order book.
-std::vector<Trade> OrderBook::addOrder(OrderPointer order) {
-    std::vector<Trade> trades;
-    // Check if the order ID already exists.
-    if (orders_.find(order->GetOrderId()) != orders_.end()) {
-        return trades;  // Returning empty trades because we rejected the order.
+bool OrderBook::crosses(OrderType side, Tick tick) const {
+    if (side == OrderType::BUY) {
+        return !asks_.empty() && asks_.best() <= tick;
+    }
+    return !bids_.empty() && bids_.best() >= tick;
+}
+
+// FOK pre-check: walk the opposite side's level totals from the best level
+// until enough quantity is found or the limit is passed.
+bool OrderBook::canFill(OrderType side, Tick tick, std::int64_t quantity) const {
+    const PriceLadder& opposite = side == OrderType::BUY ? asks_ : bids_;
+    for (Tick level = opposite.best(); level != kNoTick; level = opposite.next(level)) {
+        if (side == OrderType::BUY ? level > tick : level < tick) {
+            break;
+        }
+        quantity -= opposite.find(level)->quantity;
+        if (quantity <= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A market order is limited by the far end of the tick range instead of its price.
+Tick OrderBook::limitTick(const Order& order) const {
+    if (order.IsMarket()) {
+        return order.GetSide() == OrderType::BUY ? std::numeric_limits<Tick>::max() : kNoTick + 1;
+    }
+    return toTick(order.GetPrice());
+}
+
+// Shared add path: check the order's flags, match, then rest any remainder
+// in a pooled slot if its time in force allows. Stops are parked instead.
+bool OrderBook::addPooledOrder(Order& order, const OrderPointer& mirror, std::vector<Trade>& trades, RejectReason* reason) {
+    // Assigned IDs are unique by construction, as long as the ID type lasts;
+    // wrapping around would hand out IDs that may still be live.
+    if (config_.assignOrderIds && nextOrderId_ == std::numeric_limits<OrderId>::max()) {
+        return refuse(reason, RejectReason::ORDER_IDS_EXHAUSTED);
+    }
+    // Check if the order ID already exists, on the book or among the stops.
+    if (!config_.assignOrderIds
+        && (orders_.contains(order.GetOrderId()) || (!stops_.empty() && stops_.contains(order.GetOrderId())))) {
+        return refuse(reason, RejectReason::DUPLICATE_ORDER_ID);
+    }
+    bool market = order.IsMarket();
+    TimeInForce timeInForce = order.GetTimeInForce();
+    if (order.IsPostOnly() && (market || order.IsStop() || timeInForce != TimeInForce::GTC)) {
+        return refuse(reason, RejectReason::INVALID_ORDER);
+    }
+
+    // Convert to ticks once, at the API boundary.
+    if ((!market && !validPrice(order.GetPrice())) || (order.IsStop() && !validPrice(order.stopPrice))) {
+        return refuse(reason, RejectReason::INVALID_ORDER);
+    }
+    Tick tick = limitTick(order);
+    if (!market) {
+        order.price = toPrice(tick);
+    }
+    if (order.IsStop()) {
+        // Nothing can trade until a later print reaches the trigger.
+        Tick stopTick = toTick(order.stopPrice);
+        order.stopPrice = toPrice(stopTick);
+        acceptOrderId(order);
+        SlotIndex index = pool_.allocate();
+        OrderSlot& slot = pool_[index];
+        slot.order = order;
+        slot.tick = stopTick;
+        slot.mirror_ = mirror;
+        linkOwner(index);
+        armStop(index);
+        updateSequence_++;
+        return true;
+    }
+    if (order.IsPostOnly() && crosses(order.GetSide(), tick)) {
+        return refuse(reason, RejectReason::WOULD_CROSS);
+    }
+    if (timeInForce == TimeInForce::FOK && !canFill(order.GetSide(), tick, order.quantity)) {
+        return refuse(reason, RejectReason::NOT_FILLABLE);
     }
+    acceptOrderId(order);
+
     // First, try to match the order.
-    matchOrders(order, trades);
+    std::size_t firstTrade = trades.size();
+    matchOrders(order, tick, trades);
+
+    // If the order still has remaining quantity and may rest, add it to the appropriate side.
+    if (order.quantity > 0 && !market && timeInForce == TimeInForce::GTC) {
+        SlotIndex index = pool_.allocate();
+        OrderSlot& slot = pool_[index];
+        slot.order = order;
+        slot.mirror_ = mirror;
+        linkOwner(index);
+        restOrder(index, tick);
+    }
+    releaseStops(trades, firstTrade);
+    updateSequence_++;
+    return true;
+}
+
+// Refused orders never consume an ID, so assigned IDs have no gaps.
+void OrderBook::acceptOrderId(Order& order) {
+    if (config_.assignOrderIds) {
+        order.orderID = nextOrderId_++;
+    }
+    lastOrderId_ = order.GetOrderId();
+}
 
-    // If the order still has remaining quantity, add it to the appropriate side.
-    if (order->quantity > 0) {
-        if (order->GetSide() == OrderType::BUY) {
-            auto& orderList = bids_[order->GetPrice()];
-            orderList.push_back(order);
-            // Save iterator to the newly added order.
-            auto iter = std::prev(orderList.end());
-            orders_.insert({ order->GetOrderId(), OrderEntry{ order, iter } });
+void OrderBook::restOrder(SlotIndex index, Tick tick) {
+    OrderSlot& slot = pool_[index];
+    slot.tick = tick;
+    PriceLadder& side = sideFor(slot.order.GetSide());
+    PriceLevel& level = side.level(tick);
+    bool wasEmpty = level.empty();
+    appendToLevel(level, index);
+    if (wasEmpty) {
+        side.activate(tick);
+    }
+    orders_.insert(slot.order.GetOrderId(), index);
+    emitOrder(BookDelta::Type::ORDER_ADDED, slot.order, slot.order.quantity);
+    emitLevel(slot.order.GetSide(), tick, level);
+}
+
+// Stop levels reuse PriceLevel's intrusive FIFO; only the map node is allocated.
+void OrderBook::armStop(SlotIndex index) {
+    OrderSlot& slot = pool_[index];
+    std::map<Tick, PriceLevel>& stops = slot.order.GetSide() == OrderType::BUY ? buyStops_ : sellStops_;
+    appendToLevel(stops[slot.tick], index);
+    stops_.insert(slot.order.GetOrderId(), index);
+}
+
+// Trades are scanned in print order and fired stops enter one at a time, so
+// the trades each one prints are scanned before the next enters. The queue
+// replaces recursion: a cascade of any length runs in this one loop.
+void OrderBook::releaseStops(std::vector<Trade>& trades, std::size_t firstTrade) {
+    std::size_t scanned = firstTrade;
+    std::size_t next = 0;
+    while (!stops_.empty() || next < triggered_.size()) {
+        for (; scanned < trades.size() && !stops_.empty(); scanned++) {
+            collectTriggered(toTick(trades[scanned].tradePrice));
         }
-        else {
-            auto& orderList = asks_[order->GetPrice()];
-            orderList.push_back(order);
-            auto iter = std::prev(orderList.end());
-            orders_.insert({ order->GetOrderId(), OrderEntry{ order, iter } });
+        if (next == triggered_.size()) {
+            break;
         }
+        enterTriggered(triggered_[next++], trades);
+    }
+    triggered_.clear();
+}
+
+// Buy stops fire lowest trigger first, sell stops highest first: the order in
+// which a moving price would have reached them.
+void OrderBook::collectTriggered(Tick tick) {
+    while (!buyStops_.empty() && buyStops_.begin()->first <= tick) {
+        auto level = buyStops_.begin();
+        drainStopLevel(level->second);
+        buyStops_.erase(level);
+    }
+    while (!sellStops_.empty() && std::prev(sellStops_.end())->first >= tick) {
+        auto level = std::prev(sellStops_.end());
+        drainStopLevel(level->second);
+        sellStops_.erase(level);
+    }
+}
+
+void OrderBook::drainStopLevel(PriceLevel& level) {
+    for (SlotIndex i = level.head; i != kInvalidSlot; i = pool_[i].next) {
+        triggered_.push_back(i);
+        stops_.erase(pool_[i].order.GetOrderId());
+    }
+}
+
+// The fired order keeps its slot: it matches from there, then rests in it or frees it.
+void OrderBook::enterTriggered(SlotIndex index, std::vector<Trade>& trades) {
+    OrderSlot& slot = pool_[index];
+    Order& order = slot.order;
+    order.flags = static_cast<std::uint8_t>(order.flags & ~ORDER_STOP);
+    Tick tick = limitTick(order);
+    bool fillable = order.GetTimeInForce() != TimeInForce::FOK || canFill(order.GetSide(), tick, order.quantity);
+    if (fillable) {
+        matchOrders(order, tick, trades);
+    }
+    if (slot.mirror_) {
+        slot.mirror_->flags = order.flags;
+        slot.mirror_->quantity = order.quantity;
+    }
+    if (fillable && order.quantity > 0 && !order.IsMarket() && order.GetTimeInForce() == TimeInForce::GTC) {
+        restOrder(index, tick);
+    }
+    else {
+        releaseSlot(index);
     }
+}
+
+// Add a new order to the order book.
+std::vector<Trade> OrderBook::addOrder(const Order& order) {
+    std::vector<Trade> trades;
+    addOrder(order, trades);
+    return trades;
+}
+
+// Add a new order, appending executions to a caller-owned buffer.
+bool OrderBook::addOrder(const Order& order, std::vector<Trade>& trades, RejectReason* reason) {
+    Order incoming = order;
+    return addPooledOrder(incoming, nullptr, trades, reason);
+}
+
+// Compatibility path: keep the caller's Order in sync with the book.
+std::vector<Trade> OrderBook::addOrder(OrderPointer order) {
+    std::vector<Trade> trades;
+    addPooledOrder(*order, order, trades, nullptr);
     return trades;
 }
 
-// Cancel an order using the stored iterator.
+// Cancel an order by unlinking its slot.
 bool OrderBook::cancelOrder(OrderId orderId) {
-    auto it = orders_.find(orderId);
-    if (it != orders_.end()) {
-        OrderPointer order = it->second.order_;
-        if (order->GetSide() == OrderType::BUY) {
-            auto& orderList = bids_[order->GetPrice()];
-            orderList.erase(it->second.location_);
-            if (orderList.empty()) {
-                bids_.erase(order->GetPrice());
+    SlotIndex index = orders_.find(orderId);
+    if (index == kInvalidSlot) {
+        return cancelStop(orderId);
+    }
+    OrderSlot& slot = pool_[index];
+    PriceLadder& side = sideFor(slot.order.GetSide());
+    PriceLevel& level = *side.find(slot.tick);
+    unlinkFromLevel(level, index);
+    emitOrder(BookDelta::Type::ORDER_REMOVED, slot.order, slot.order.quantity);
+    emitLevel(slot.order.GetSide(), slot.tick, level);
+    if (level.empty()) {
+        side.deactivate(slot.tick);
+    }
+    orders_.erase(orderId);
+    updateSequence_++;
+    releaseSlot(index);
+    return true;
+}
+
+// Modify a resting order. A smaller quantity at the same price is applied to
+// the slot where it stands; anything else takes the slot off its level, lets
+// it trade at a new price like an incoming order, and re-links the remainder
+// at the back of its new level. The slot and its index entry are reused.
+bool OrderBook::modifyOrder(OrderId orderId, Price newPrice, int newQuantity,
+    std::vector<Trade>& trades, RejectReason* reason) {
+    SlotIndex index = orders_.find(orderId);
+    if (index == kInvalidSlot) {
+        return refuse(reason, RejectReason::UNKNOWN_ORDER);
+    }
+    if (newQuantity <= 0 || !validPrice(newPrice)) {
+        return refuse(reason, RejectReason::INVALID_ORDER);
+    }
+    OrderSlot& slot = pool_[index];
+    OrderType sideType = slot.order.GetSide();
+    PriceLadder& side = sideFor(sideType);
+    PriceLevel& level = *side.find(slot.tick);
+    Tick tick = toTick(newPrice);
+
+    // Size-down (or no change) at the same price: keep the queue position.
+    if (tick == slot.tick && newQuantity <= slot.order.quantity) {
+        level.quantity -= slot.order.quantity - newQuantity;
+        slot.order.quantity = newQuantity;
+        if (slot.mirror_) {
+            slot.mirror_->quantity = newQuantity;
+        }
+        emitOrder(BookDelta::Type::ORDER_MODIFIED, slot.order, newQuantity);
+        emitLevel(sideType, tick, level);
+        updateSequence_++;
+        return true;
+    }
+    bool moving = tick != slot.tick;
+    std::size_t firstTrade = trades.size();
+    if (moving && slot.order.IsPostOnly() && crosses(sideType, tick)) {
+        return refuse(reason, RejectReason::WOULD_CROSS);
+    }
+
+    // Priority is lost: leave the old level, emptying it if this was its last order.
+    unlinkFromLevel(level, index);
+    if (moving) {
+        emitLevel(sideType, slot.tick, level);
+        if (level.empty()) {
+            side.deactivate(slot.tick);
+        }
+    }
+    slot.order.quantity = newQuantity;
+    slot.order.price = toPrice(tick);
+    slot.tick = tick;
+    if (moving) {
+        matchOrders(slot.order, tick, trades);
+    }
+    if (slot.mirror_) {
+        slot.mirror_->price = slot.order.price;
+        slot.mirror_->quantity = slot.order.quantity;
+    }
+
+    if (slot.order.quantity > 0) {
+        PriceLevel& target = side.level(tick);
+        bool wasEmpty = target.empty();
+        appendToLevel(target, index);
+        if (wasEmpty) {
+            side.activate(tick);
+        }
+        emitOrder(BookDelta::Type::ORDER_MODIFIED, slot.order, slot.order.quantity);
+        emitLevel(sideType, tick, target);
+    }
+    else {
+        // Filled in full on the way to its new price.
+        emitOrder(BookDelta::Type::ORDER_REMOVED, slot.order, 0);
+        orders_.erase(orderId);
+        releaseSlot(index);
+    }
+    releaseStops(trades, firstTrade);
+    updateSequence_++;
+    return true;
+}
+
+// Dormant stops are not on the visible book, so removing one emits no delta.
+bool OrderBook::cancelStop(OrderId orderId) {
+    SlotIndex index = stops_.find(orderId);
+    if (index == kInvalidSlot) {
+        return false;
+    }
+    removeStop(index);
+    updateSequence_++;
+    return true;
+}
+
+void OrderBook::removeStop(SlotIndex index) {
+    OrderSlot& slot = pool_[index];
+    std::map<Tick, PriceLevel>& stops = slot.order.GetSide() == OrderType::BUY ? buyStops_ : sellStops_;
+    auto level = stops.find(slot.tick);
+    unlinkFromLevel(level->second, index);
+    if (level->second.empty()) {
+        stops.erase(level);
+    }
+    stops_.erase(slot.order.GetOrderId());
+    releaseSlot(index);
+}
+
+// One pass over the owner's list, or over the levels in range. Levels are
+// reported and deactivated at the end, once each, however many orders left.
+std::size_t OrderBook::cancelOrders(const MassCancel& filter, std::vector<OrderId>* cancelled) {
+    std::size_t count = 0;
+    auto note = [this, &count, cancelled](SlotIndex index) {
+        if (cancelled != nullptr) {
+            cancelled->push_back(pool_[index].order.GetOrderId());
+        }
+        count++;
+    };
+    if ((filter.hasMinPrice && std::isnan(filter.minPrice)) || (filter.hasMaxPrice && std::isnan(filter.maxPrice))) {
+        return 0;
+    }
+    Tick low = filter.hasMinPrice ? boundTick(filter.minPrice) : kNoTick;
+    Tick high = filter.hasMaxPrice ? boundTick(filter.maxPrice) : std::numeric_limits<Tick>::max();
+    if (filter.owner != kNoOwner) {
+        auto head = owners_.find(filter.owner);
+        SlotIndex index = head != owners_.end() ? head->second : kInvalidSlot;
+        while (index != kInvalidSlot) {
+            SlotIndex next = pool_[index].ownerNext;
+            if (matchesCancel(filter, low, high, pool_[index])) {
+                note(index);
+                if (pool_[index].order.IsStop()) {
+                    removeStop(index);
+                }
+                else {
+                    cancelResting(index);
+                }
+            }
+            index = next;
+        }
+    }
+    else {
+        for (OrderType side : { OrderType::BUY, OrderType::SELL }) {
+            if (filter.bySide && filter.side != side) {
+                continue;
+            }
+            PriceLadder& ladder = sideFor(side);
+            for (Tick tick = ladder.best(); tick != kNoTick; tick = ladder.next(tick)) {
+                // Bids are walked downwards, asks upwards.
+                if (side == OrderType::BUY ? tick < low : tick > high) {
+                    break;
+                }
+                if (tick < low || tick > high) {
+                    continue;
+                }
+                PriceLevel& level = *ladder.find(tick);
+                for (SlotIndex index = level.head; index != kInvalidSlot;) {
+                    SlotIndex next = pool_[index].next;
+                    note(index);
+                    cancelResting(index);
+                    index = next;
+                }
+            }
+            if (filter.byPrice()) {
+                continue;
+            }
+            std::map<Tick, PriceLevel>& stops = side == OrderType::BUY ? buyStops_ : sellStops_;
+            for (auto& entry : stops) {
+                for (SlotIndex index = entry.second.head; index != kInvalidSlot;) {
+                    SlotIndex next = pool_[index].next;
+                    note(index);
+                    stops_.erase(pool_[index].order.GetOrderId());
+                    releaseSlot(index);
+                    index = next;
+                }
             }
+            stops.clear();
+        }
+    }
+
+    std::sort(touchedLevels_.begin(), touchedLevels_.end());
+    touchedLevels_.erase(std::unique(touchedLevels_.begin(), touchedLevels_.end()), touchedLevels_.end());
+    for (const auto& [side, tick] : touchedLevels_) {
+        PriceLadder& ladder = sideFor(side);
+        PriceLevel& level = *ladder.find(tick);
+        emitLevel(side, tick, level);
+        if (level.empty()) {
+            ladder.deactivate(tick);
+        }
+    }
+    touchedLevels_.clear();
+    if (count > 0) {
+        updateSequence_++;
+    }
+    return count;
+}
+
+std::size_t OrderBook::cancelAll(OwnerId owner) {
+    MassCancel filter;
+    filter.owner = owner;
+    return cancelOrders(filter);
+}
+
+std::size_t OrderBook::cancelBySide(OrderType side, OwnerId owner) {
+    MassCancel filter;
+    filter.owner = owner;
+    filter.bySide = true;
+    filter.side = side;
+    return cancelOrders(filter);
+}
+
+std::size_t OrderBook::cancelByPriceRange(OrderType side, Price minPrice, Price maxPrice, OwnerId owner) {
+    MassCancel filter;
+    filter.owner = owner;
+    filter.bySide = true;
+    filter.side = side;
+    filter.hasMinPrice = true;
+    filter.minPrice = minPrice;
+    filter.hasMaxPrice = true;
+    filter.maxPrice = maxPrice;
+    return cancelOrders(filter);
+}
+
+void OrderBook::cancelResting(SlotIndex index) {
+    OrderSlot& slot = pool_[index];
+    OrderType side = slot.order.GetSide();
+    unlinkFromLevel(*sideFor(side).find(slot.tick), index);
+    emitOrder(BookDelta::Type::ORDER_REMOVED, slot.order, slot.order.quantity);
+    std::pair<OrderType, Tick> level(side, slot.tick);
+    if (touchedLevels_.empty() || touchedLevels_.back() != level) {
+        touchedLevels_.push_back(level);
+    }
+    orders_.erase(slot.order.GetOrderId());
+    releaseSlot(index);
+}
+
+bool OrderBook::matchesCancel(const MassCancel& filter, Tick low, Tick high, const OrderSlot& slot) const {
+    if (filter.bySide && slot.order.GetSide() != filter.side) {
+        return false;
+    }
+    if (filter.byPrice()) {
+        return !slot.order.IsStop() && slot.tick >= low && slot.tick <= high;
+    }
+    return true;
+}
+
+std::size_t OrderBook::ownerOrderCount(OwnerId owner) const {
+    auto head = owners_.find(owner);
+    std::size_t count = 0;
+    for (SlotIndex i = head != owners_.end() ? head->second : kInvalidSlot; i != kInvalidSlot; i = pool_[i].ownerNext) {
+        count++;
+    }
+    return count;
+}
+
+// Apply a batch; the per-command sequence steps collapse into one.
+bool OrderBook::applyBatch(const std::vector<BookCommand>& commands,
+    std::vector<BookCommandResult>& results, std::vector<Trade>& trades) {
+    std::uint64_t before = updateSequence_;
+    results.reserve(results.size() + commands.size());
+    bool changed = false;
+    for (const BookCommand& command : commands) {
+        BookCommandResult result;
+        result.firstTrade = trades.size();
+        if (command.type == BookCommand::Type::ADD) {
+            result.accepted = addOrder(command.order, trades, &result.reject);
+            if (result.accepted) {
+                result.orderId = lastOrderId_;
+            }
+        }
+        else if (command.type == BookCommand::Type::MODIFY) {
+            result.accepted = modifyOrder(command.orderId, command.order.GetPrice(), command.order.quantity,
+                trades, &result.reject);
         }
         else {
-            auto& orderList = asks_[order->GetPrice()];
-            orderList.erase(it->second.location_);
-            if (orderList.empty()) {
-                asks_.erase(order->GetPrice());
+            result.accepted = cancelOrder(command.orderId);
+            if (!result.accepted) {
+                result.reject = RejectReason::UNKNOWN_ORDER;
             }
         }
-        orders_.erase(it);
-        return true;
+        result.tradeCount = trades.size() - result.firstTrade;
+        changed = changed || result.accepted;
+        results.push_back(result);
     }
-    return false;
+    updateSequence_ = changed ? before + 1 : before;
+    return changed;
 }
 
 // Display the order book.
 void OrderBook::displayOrders() const {
-    std::cout << "Bids:\n";
-    for (const auto& priceOrders : bids_) {
-        for (const auto& order : priceOrders.second) {
-            std::cout << "  ID: " << order->orderID
-                << ", Price: " << order->price
-                << ", Qty: " << order->quantity << "\n";
+    auto printLevel = [this](Tick, const PriceLevel& level) {
+        for (SlotIndex i = level.head; i != kInvalidSlot; i = pool_[i].next) {
+            const Order& order = pool_[i].order;
+            std::cout << "  ID: " << order.orderID
+                << ", Price: " << order.price
+                << ", Qty: " << order.quantity << "\n";
         }
-    }
+    };
+    std::cout << "Bids:\n";
+    bids_.forEachLevel(printLevel);
     std::cout << "Asks:\n";
-    for (const auto& priceOrders : asks_) {
-        for (const auto& order : priceOrders.second) {
-            std::cout << "  ID: " << order->orderID
-                << ", Price: " << order->price
-                << ", Qty: " << order->quantity << "\n";
+    asks_.forEachLevel(printLevel);
+}
+
+// Get raw order book data, walking the ladders best level first.
+std::pair<std::vector<Order>, std::vector<Order>> OrderBook::getRawOrderBookData(std::size_t levels) const {
+    std::vector<Order> bidOrders, askOrders;
+    auto collect = [this, levels](const PriceLadder& side, std::vector<Order>& out) {
+        std::size_t count = 0;
+        for (Tick tick = side.best(); tick != kNoTick && count < levels; tick = side.next(tick), count++) {
+            for (SlotIndex i = side.find(tick)->head; i != kInvalidSlot; i = pool_[i].next) {
+                out.push_back(pool_[i].order);
+            }
         }
-    }
+    };
+    collect(bids_, bidOrders);
+    collect(asks_, askOrders);
+    return { bidOrders, askOrders };
 }
 
-// Get raw order book data.
-std::pair<std::vector<OrderPointer>, std::vector<OrderPointer>> OrderBook::getRawOrderBookData() const {
-    std::vector<OrderPointer> bidOrders, askOrders;
-    for (const auto& priceOrders : bids_) {
-        for (const auto& order : priceOrders.second) {
-            bidOrders.push_back(order);
+// Get aggregated depth, stopping after `levels` levels per side.
+BookDepth OrderBook::getDepth(std::size_t levels) const {
+    BookDepth depth;
+    depth.sequence = updateSequence_;
+    auto collect = [this, levels](const PriceLadder& side, std::vector<DepthLevel>& out) {
+        out.reserve(levels);
+        for (Tick tick = side.best(); tick != kNoTick && out.size() < levels; tick = side.next(tick)) {
+            const PriceLevel& level = *side.find(tick);
+            out.push_back({ toPrice(tick), level.quantity, level.orderCount });
         }
+    };
+    collect(bids_, depth.bids);
+    collect(asks_, depth.asks);
+    return depth;
+}
+
+// Write the levels of both sides, each followed by its FIFO.
+void OrderBook::saveSnapshot(SnapshotWriter& out) const {
+    SnapshotBookCounts counts;
+    auto countLevel = [&counts](Tick, const PriceLevel&) { counts.levelCount++; };
+    bids_.forEachLevel(countLevel);
+    asks_.forEachLevel(countLevel);
+    counts.orderCount = static_cast<std::uint32_t>(orders_.size());
+    counts.stopCount = static_cast<std::uint32_t>(stops_.size());
+    counts.nextOrderId = nextOrderId_;
+    out.put(counts);
+
+    auto writeSide = [this, &out](const PriceLadder& side, std::uint8_t sideCode) {
+        side.forEachLevel([this, &out, sideCode](Tick tick, const PriceLevel& level) {
+            SnapshotLevel header;
+            header.tick = tick;
+            header.side = sideCode;
+            for (SlotIndex i = level.head; i != kInvalidSlot; i = pool_[i].next) {
+                header.orderCount++;
+            }
+            out.put(header);
+            for (SlotIndex i = level.head; i != kInvalidSlot; i = pool_[i].next) {
+                const Order& order = pool_[i].order;
+                SnapshotOrder record;
+                record.orderId = order.orderID;
+                record.quantity = order.quantity;
+                record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    order.timestamp.time_since_epoch()).count();
+                record.owner = order.owner;
+                out.put(record);
+            }
+        });
+    };
+    writeSide(bids_, 0);
+    writeSide(asks_, 1);
+
+    // Dormant stops, each side's levels in map order and FIFO within a level.
+    auto writeStops = [this, &out](const std::map<Tick, PriceLevel>& stops) {
+        for (const auto& entry : stops) {
+            for (SlotIndex i = entry.second.head; i != kInvalidSlot; i = pool_[i].next) {
+                const Order& order = pool_[i].order;
+                SnapshotStop record;
+                record.orderId = order.orderID;
+                record.quantity = order.quantity;
+                record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    order.timestamp.time_since_epoch()).count();
+                record.price = order.price;
+                record.stopTick = entry.first;
+                record.side = order.GetSide() == OrderType::BUY ? 0 : 1;
+                record.timeInForce = static_cast<std::uint8_t>(order.GetTimeInForce());
+                record.flags = order.flags;
+                record.owner = order.owner;
+                out.put(record);
+            }
+        }
+    };
+    writeStops(buyStops_);
+    writeStops(sellStops_);
+}
+
+// Bulk rebuild: one reservation, then slots are filled and linked in order.
+bool OrderBook::loadSnapshot(SnapshotReader& in, const Symbol& symbol) {
+    SnapshotBookCounts counts;
+    if (!orders_.empty() || !in.get(counts)) {
+        return false;
     }
-    for (const auto& priceOrders : asks_) {
-        for (const auto& order : priceOrders.second) {
-            askOrders.push_back(order);
+    pool_.reserve(counts.orderCount + counts.stopCount);
+    orders_.reserve(counts.orderCount);
+    nextOrderId_ = counts.nextOrderId;
+
+    std::uint32_t restored = 0;
+    for (std::uint32_t l = 0; l < counts.levelCount; l++) {
+        SnapshotLevel header;
+        if (!in.get(header) || header.side > 1 || header.orderCount == 0) {
+            return false;
         }
+        OrderType side = header.side == 0 ? OrderType::BUY : OrderType::SELL;
+        PriceLadder& ladder = sideFor(side);
+        PriceLevel& level = ladder.level(header.tick);
+        for (std::uint32_t o = 0; o < header.orderCount; o++) {
+            SnapshotOrder record;
+            if (!in.get(record) || record.quantity <= 0 || hasOrder(record.orderId)) {
+                return false;
+            }
+            SlotIndex index = pool_.allocate();
+            OrderSlot& slot = pool_[index];
+            slot.order = Order(record.orderId, toPrice(header.tick), record.quantity, side, symbol);
+            slot.order.timestamp = std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    std::chrono::nanoseconds(record.timestamp)));
+            slot.order.owner = record.owner;
+            slot.tick = header.tick;
+            linkOwner(index);
+            appendToLevel(level, index);
+            orders_.insert(record.orderId, index);
+            restored++;
+        }
+        ladder.activate(header.tick);
     }
-    return { bidOrders, askOrders };
+    if (restored != counts.orderCount) {
+        return false;
+    }
+
+    for (std::uint32_t s = 0; s < counts.stopCount; s++) {
+        SnapshotStop record;
+        if (!in.get(record) || record.side > 1 || record.quantity <= 0 || hasOrder(record.orderId)
+            || stops_.contains(record.orderId)) {
+            return false;
+        }
+        SlotIndex index = pool_.allocate();
+        OrderSlot& slot = pool_[index];
+        slot.order = Order(record.orderId, record.price, record.quantity,
+            record.side == 0 ? OrderType::BUY : OrderType::SELL, symbol);
+        slot.order.timeInForce = static_cast<TimeInForce>(record.timeInForce);
+        slot.order.flags = record.flags;
+        slot.order.stopPrice = toPrice(record.stopTick);
+        slot.order.timestamp = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(record.timestamp)));
+        slot.order.owner = record.owner;
+        slot.tick = record.stopTick;
+        linkOwner(index);
+        armStop(index);
+    }
+    return true;
 }
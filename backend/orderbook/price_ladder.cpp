@@ -0,0 +1,201 @@
+#include "price_ladder.h"
+#include <algorithm>
+#include <iterator>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+// Index of the lowest set bit (word must be non-zero).
+inline int lowestBit(std::uint64_t word) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+// Index of the highest set bit (word must be non-zero).
+inline int highestBit(std::uint64_t word) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, word);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(word);
+#endif
+}
+
+// Mask of bits [0, bit].
+inline std::uint64_t maskAtOrBelow(int bit) {
+    return bit == 63 ? ~0ULL : ((1ULL << (bit + 1)) - 1);
+}
+
+// Mask of bits [bit, 63].
+inline std::uint64_t maskAtOrAbove(int bit) {
+    return ~0ULL << bit;
+}
+
+} // namespace
+
+PriceLadder::PriceLadder(Direction direction, Tick minTick, Tick maxTick)
+    : direction_(direction), minTick_(minTick), maxTick_(maxTick) {
+    levelCount_ = maxTick_ >= minTick_ ? static_cast<std::size_t>(maxTick_ - minTick_ + 1) : 0;
+    std::size_t words = (levelCount_ + 63) / 64;
+    pages_.resize((levelCount_ + kPageSize - 1) >> kPageShift);
+    bits_.assign(words, 0);
+    summary_.assign((words + 63) / 64, 0);
+}
+
+PriceLevel& PriceLadder::level(Tick tick) {
+    if (inBand(tick)) {
+        std::size_t index = static_cast<std::size_t>(tick - minTick_);
+        std::unique_ptr<PriceLevel[]>& page = pages_[index >> kPageShift];
+        if (!page) {
+            page.reset(new PriceLevel[kPageSize]);
+        }
+        return page[index & (kPageSize - 1)];
+    }
+    return overflow_[tick];
+}
+
+PriceLevel* PriceLadder::find(Tick tick) {
+    return const_cast<PriceLevel*>(static_cast<const PriceLadder*>(this)->find(tick));
+}
+
+const PriceLevel* PriceLadder::find(Tick tick) const {
+    if (inBand(tick)) {
+        std::size_t index = static_cast<std::size_t>(tick - minTick_);
+        const std::unique_ptr<PriceLevel[]>& page = pages_[index >> kPageShift];
+        return page ? &page[index & (kPageSize - 1)] : nullptr;
+    }
+    auto it = overflow_.find(tick);
+    return it != overflow_.end() ? &it->second : nullptr;
+}
+
+void PriceLadder::activate(Tick tick) {
+    if (inBand(tick)) {
+        setBit(static_cast<std::size_t>(tick - minTick_));
+    }
+    bool better = direction_ == Direction::DESCENDING ? tick > best_ : tick < best_;
+    if (best_ == kNoTick || better) {
+        best_ = tick;
+    }
+}
+
+void PriceLadder::deactivate(Tick tick) {
+    if (inBand(tick)) {
+        clearBit(static_cast<std::size_t>(tick - minTick_));
+    }
+    else {
+        overflow_.erase(tick);
+    }
+    if (tick == best_) {
+        best_ = next(tick);
+    }
+}
+
+Tick PriceLadder::next(Tick tick) const {
+    return direction_ == Direction::DESCENDING ? seek(tick - 1) : seek(tick + 1);
+}
+
+// Find the closest active tick at or behind `tick`, looking at both the
+// banded array and the overflow map.
+Tick PriceLadder::seek(Tick tick) const {
+    Tick found = kNoTick;
+    if (direction_ == Direction::DESCENDING) {
+        auto it = overflow_.upper_bound(tick);
+        if (it != overflow_.begin()) {
+            found = std::prev(it)->first;
+        }
+        if (tick >= minTick_) {
+            std::int64_t index = highestAtOrBelow(std::min(tick, maxTick_) - minTick_);
+            if (index >= 0 && (found == kNoTick || minTick_ + index > found)) {
+                found = minTick_ + index;
+            }
+        }
+    }
+    else {
+        auto it = overflow_.lower_bound(tick);
+        if (it != overflow_.end()) {
+            found = it->first;
+        }
+        if (tick <= maxTick_) {
+            std::int64_t index = lowestAtOrAbove(std::max(tick, minTick_) - minTick_);
+            if (index >= 0 && (found == kNoTick || minTick_ + index < found)) {
+                found = minTick_ + index;
+            }
+        }
+    }
+    return found;
+}
+
+void PriceLadder::setBit(std::size_t index) {
+    std::size_t word = index >> 6;
+    bits_[word] |= 1ULL << (index & 63);
+    summary_[word >> 6] |= 1ULL << (word & 63);
+}
+
+void PriceLadder::clearBit(std::size_t index) {
+    std::size_t word = index >> 6;
+    bits_[word] &= ~(1ULL << (index & 63));
+    if (bits_[word] == 0) {
+        summary_[word >> 6] &= ~(1ULL << (word & 63));
+    }
+}
+
+std::int64_t PriceLadder::highestAtOrBelow(std::int64_t index) const {
+    if (index < 0) {
+        return -1;
+    }
+    std::int64_t word = index >> 6;
+    std::uint64_t bits = bits_[word] & maskAtOrBelow(static_cast<int>(index & 63));
+    if (bits) {
+        return word * 64 + highestBit(bits);
+    }
+    // Use the summary to jump to the closest lower non-empty word.
+    if (word == 0) {
+        return -1;
+    }
+    std::int64_t below = word - 1;
+    std::int64_t group = below >> 6;
+    std::uint64_t summary = summary_[group] & maskAtOrBelow(static_cast<int>(below & 63));
+    while (!summary) {
+        if (--group < 0) {
+            return -1;
+        }
+        summary = summary_[group];
+    }
+    std::int64_t found = group * 64 + highestBit(summary);
+    return found * 64 + highestBit(bits_[found]);
+}
+
+std::int64_t PriceLadder::lowestAtOrAbove(std::int64_t index) const {
+    if (index >= static_cast<std::int64_t>(levelCount_)) {
+        return -1;
+    }
+    std::int64_t word = index >> 6;
+    std::uint64_t bits = bits_[word] & maskAtOrAbove(static_cast<int>(index & 63));
+    if (bits) {
+        return word * 64 + lowestBit(bits);
+    }
+    // Use the summary to jump to the closest higher non-empty word.
+    std::int64_t above = word + 1;
+    if (above >= static_cast<std::int64_t>(bits_.size())) {
+        return -1;
+    }
+    std::int64_t group = above >> 6;
+    std::uint64_t summary = summary_[group] & maskAtOrAbove(static_cast<int>(above & 63));
+    while (!summary) {
+        if (++group >= static_cast<std::int64_t>(summary_.size())) {
+            return -1;
+        }
+        summary = summary_[group];
+    }
+    std::int64_t found = group * 64 + lowestBit(summary);
+    return found * 64 + lowestBit(bits_[found]);
+}
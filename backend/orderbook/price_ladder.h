@@ -0,0 +1,105 @@
+#ifndef PRICE_LADDER_H
+#define PRICE_LADDER_H
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <vector>
+#include "order_pool.h"
+
+// Prices inside the engine are integer multiples of the instrument's tick size.
+using Tick = std::int64_t;
+
+// Sentinel returned when a side has no active level.
+constexpr Tick kNoTick = std::numeric_limits<Tick>::min();
+
+// A price level is just the head and tail of its intrusive FIFO.
+struct PriceLevel {
+    SlotIndex head{ kInvalidSlot };
+    SlotIndex tail{ kInvalidSlot };
+    std::int64_t quantity = 0;      // Sum of the remaining quantity of its orders.
+    std::uint32_t orderCount = 0;
+
+    bool empty() const { return head == kInvalidSlot; }
+};
+
+//
+// One side of the book. Levels inside the configured price band live in a
+// flat array indexed by (tick - minTick); a two-level bitmap records which of
+// them are non-empty so the next best level is found with a couple of bit
+// scans. Ticks outside the band fall back to a sparse std::map.
+//
+// The level array is split into fixed-size pages that are only allocated
+// the first time a tick inside them is used, so a wide band costs the
+// bitmap (one bit per tick) up front and level storage only where the
+// book actually trades.
+//
+class PriceLadder {
+public:
+    enum class Direction {
+        DESCENDING,  // Bids: best is the highest tick.
+        ASCENDING    // Asks: best is the lowest tick.
+    };
+
+    PriceLadder(Direction direction, Tick minTick, Tick maxTick);
+
+    // Returns the level for `tick`, creating it if needed. The level only
+    // counts towards best() once activate() has been called for it.
+    PriceLevel& level(Tick tick);
+
+    // Returns the level for `tick`, or nullptr if it does not exist.
+    PriceLevel* find(Tick tick);
+    const PriceLevel* find(Tick tick) const;
+
+    // Marks a level as holding orders.
+    void activate(Tick tick);
+
+    // Marks a level as empty and moves the cached best if needed.
+    void deactivate(Tick tick);
+
+    // Best active tick, or kNoTick if the side is empty.
+    Tick best() const { return best_; }
+
+    bool empty() const { return best_ == kNoTick; }
+
+    // Next active tick strictly behind `tick` in priority order, or kNoTick.
+    Tick next(Tick tick) const;
+
+    // Visits active levels from best to worst.
+    template <typename Visitor>
+    void forEachLevel(Visitor&& visit) const {
+        for (Tick tick = best_; tick != kNoTick; tick = next(tick)) {
+            visit(tick, *find(tick));
+        }
+    }
+
+private:
+    static constexpr std::size_t kPageShift = 10;
+    static constexpr std::size_t kPageSize = std::size_t(1) << kPageShift;
+
+    bool inBand(Tick tick) const { return tick >= minTick_ && tick <= maxTick_; }
+
+    // Active tick at or behind `tick` in priority order, or kNoTick.
+    Tick seek(Tick tick) const;
+
+    // Bitmap helpers (indices are offsets from minTick_).
+    void setBit(std::size_t index);
+    void clearBit(std::size_t index);
+    std::int64_t highestAtOrBelow(std::int64_t index) const;
+    std::int64_t lowestAtOrAbove(std::int64_t index) const;
+
+    Direction direction_;
+    Tick minTick_;
+    Tick maxTick_;
+    Tick best_ = kNoTick;
+
+    std::size_t levelCount_ = 0;                    // Ticks in the band.
+    std::vector<std::unique_ptr<PriceLevel[]>> pages_;  // kPageSize levels each.
+    std::vector<std::uint64_t> bits_;     // One bit per level.
+    std::vector<std::uint64_t> summary_;  // One bit per non-zero word of bits_.
+
+    std::map<Tick, PriceLevel> overflow_;
+};
+
+#endif // PRICE_LADDER_H
@@ -0,0 +1,155 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//
+// Building blocks for binary book snapshots. Images are plain little-endian
+// structs laid out back to back, written into a memory buffer and read back
+// straight out of a read-only memory mapping.
+//
+
+#pragma pack(push, 1)
+// First bytes of a shard snapshot file.
+struct SnapshotHeader {
+    char magic[4] = { 'O', 'B', 'S', '1' };
+    std::uint32_t version = 4;
+    std::uint32_t shardIndex = 0;
+    std::uint32_t shardCount = 1;
+    std::uint64_t sequence = 0;     // Last journal sequence included.
+    std::uint32_t bookCount = 0;
+};
+
+// Precedes each book's image.
+struct SnapshotBookHeader {
+    char symbol[16] = {};
+    double tickSize = 0.0;
+    double minPrice = 0.0;
+    double maxPrice = 0.0;
+    std::uint8_t assignOrderIds = 0;
+    std::uint8_t reserved[7] = {};
+};
+
+// Written by OrderBook::saveSnapshot ahead of its levels.
+struct SnapshotBookCounts {
+    std::uint32_t levelCount = 0;
+    std::uint32_t orderCount = 0;
+    std::uint32_t stopCount = 0;    // SnapshotStop records after the levels.
+    std::int32_t nextOrderId = 1;   // Next ID the book would assign.
+};
+
+// One price level; followed by its orders, oldest first.
+struct SnapshotLevel {
+    std::int64_t tick = 0;
+    std::uint8_t side = 0;          // 0 = BUY, 1 = SELL
+    std::uint8_t reserved[3] = {};
+    std::uint32_t orderCount = 0;
+};
+
+// One resting order.
+struct SnapshotOrder {
+    std::int32_t orderId = 0;
+    std::int32_t quantity = 0;
+    std::int64_t timestamp = 0;     // Nanoseconds since the epoch.
+    std::uint32_t owner = 0;
+};
+
+// One dormant stop order, in firing order within its side.
+struct SnapshotStop {
+    std::int32_t orderId = 0;
+    std::int32_t quantity = 0;
+    std::int64_t timestamp = 0;
+    double price = 0.0;             // Limit price (unused for a stop-market order).
+    std::int64_t stopTick = 0;
+    std::uint8_t side = 0;
+    std::uint8_t timeInForce = 0;
+    std::uint8_t flags = 0;
+    std::uint32_t owner = 0;
+    std::uint8_t reserved[1] = {};
+};
+
+// Last bytes of a snapshot file.
+struct SnapshotTrailer {
+    std::uint32_t checksum = 0;     // FNV-1a of everything before the trailer.
+};
+#pragma pack(pop)
+
+// Appends raw bytes to a growing buffer.
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(std::vector<char>& buffer) : buffer_(buffer) {}
+
+    void write(const void* data, std::size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        buffer_.insert(buffer_.end(), bytes, bytes + size);
+    }
+
+    template <typename T>
+    void put(const T& value) { write(&value, sizeof(T)); }
+
+    std::size_t size() const { return buffer_.size(); }
+
+private:
+    std::vector<char>& buffer_;
+};
+
+// Reads raw bytes from a memory range, failing instead of overrunning it.
+class SnapshotReader {
+public:
+    SnapshotReader(const char* data, std::size_t size) : cursor_(data), end_(data + size) {}
+
+    bool read(void* out, std::size_t size) {
+        if (static_cast<std::size_t>(end_ - cursor_) < size) {
+            return false;
+        }
+        std::memcpy(out, cursor_, size);
+        cursor_ += size;
+        return true;
+    }
+
+    template <typename T>
+    bool get(T& value) { return read(&value, sizeof(T)); }
+
+    std::size_t remaining() const { return static_cast<std::size_t>(end_ - cursor_); }
+
+private:
+    const char* cursor_;
+    const char* end_;
+};
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
+
+// FNV-1a checksum used by the trailer.
+std::uint32_t snapshotChecksum(const char* data, std::size_t size);
+
+// Writes `data` to `path` via a temporary file, fsync and rename, so a crash
+// leaves either the old or the new snapshot, never a partial one.
+bool writeFileDurably(const std::string& path, const std::vector<char>& data);
+
+#endif // SNAPSHOT_H
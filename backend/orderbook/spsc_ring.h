@@ -0,0 +1,75 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+//
+// Bounded lock-free single-producer / single-consumer ring. Each side keeps
+// a cached copy of the other side's index so the shared cache lines are only
+// read when the ring looks full (producer) or empty (consumer).
+//
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(std::size_t capacity) {
+        std::size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        slots_.reset(new T[size]);
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side. Returns false if the ring is full.
+    bool tryPush(const T& value) {
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head - cachedTail_ > mask_) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head - cachedTail_ > mask_) {
+                return false;
+            }
+        }
+        slots_[head & mask_] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool tryPop(T& out) {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == cachedHead_) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail == cachedHead_) {
+                return false;
+            }
+        }
+        out = std::move(slots_[tail & mask_]);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: true if nothing is waiting.
+    bool empty() const {
+        return tail_.load(std::memory_order_relaxed) == head_.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+private:
+    std::unique_ptr<T[]> slots_;
+    std::size_t mask_ = 0;
+
+    alignas(64) std::atomic<std::size_t> head_{ 0 };  // Written by the producer.
+    std::size_t cachedTail_ = 0;
+
+    alignas(64) std::atomic<std::size_t> tail_{ 0 };  // Written by the consumer.
+    std::size_t cachedHead_ = 0;
+};
+
+#endif // SPSC_RING_H
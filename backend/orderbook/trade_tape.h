@@ -0,0 +1,161 @@
+#ifndef TRADE_TAPE_H
+#define TRADE_TAPE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include "order_book.h"
+
+// One execution as kept on a TradeTape.
+struct TapeTrade {
+    std::uint64_t sequence = 0;         // Position on the tape; consecutive, from 0.
+    std::uint64_t commandSequence = 0;  // Shard sequence of the command that traded.
+    std::int64_t timestamp = 0;         // Nanoseconds since the epoch, when it traded.
+    Trade trade{};
+    Symbol symbol;
+};
+
+//
+// Fixed-capacity ring of the most recent executions. One thread appends (the
+// shard's matching thread); any number of threads read from any sequence at
+// the same time without a lock and without slowing the writer down. Old
+// trades are simply overwritten: a reader that falls more than capacity()
+// trades behind skips to the oldest one still held and sees the gap in the
+// sequence numbers.
+//
+// Every slot is one cache line holding a version word and the trade. The
+// writer clears the version, stores the trade, then sets the version to the
+// trade's sequence + 1; a reader that sees the same version before and after
+// copying a slot has a whole trade (a per-slot seqlock). The trade is stored
+// as relaxed atomic words, so a torn copy is detected rather than undefined.
+//
+class TradeTape {
+public:
+    // Default number of trades held per tape.
+    static constexpr std::size_t kDefaultCapacity = 1 << 14;
+
+    explicit TradeTape(std::size_t capacity = kDefaultCapacity) {
+        std::size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        slots_.reset(new Slot[size]);
+    }
+
+    TradeTape(const TradeTape&) = delete;
+    TradeTape& operator=(const TradeTape&) = delete;
+
+    // Writer side: appends `count` trades printed by one command.
+    void append(const Trade* trades, std::size_t count, const Symbol& symbol,
+        std::uint64_t commandSequence, std::int64_t timestamp) {
+        std::uint64_t head = head_.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < count; i++, head++) {
+            // Claim the sequence first: from here on readers treat the trade
+            // it replaces as lapped, and this one as not yet ready.
+            head_.store(head + 1, std::memory_order_release);
+            Payload payload;
+            payload.commandSequence = commandSequence;
+            payload.timestamp = timestamp;
+            payload.trade = trades[i];
+            payload.symbol = symbol;
+            Slot& slot = slots_[head & mask_];
+            slot.version.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::uint64_t words[kWords];
+            std::memcpy(words, &payload, sizeof(payload));
+            for (std::size_t w = 0; w < kWords; w++) {
+                slot.words[w].store(words[w], std::memory_order_relaxed);
+            }
+            slot.version.store(head + 1, std::memory_order_release);
+        }
+    }
+
+    // Sequence the next appended trade will get.
+    std::uint64_t head() const { return head_.load(std::memory_order_acquire); }
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    // Copies up to `max` trades, starting at sequence `since` or at the oldest
+    // one still held if that is later, into `out`. Returns the number copied;
+    // they are consecutive, and the next read should start at
+    // out[count - 1].sequence + 1 (or at `since` again if none were ready).
+    // Never waits for the writer.
+    std::size_t read(std::uint64_t since, TapeTrade* out, std::size_t max) const {
+        std::size_t count = 0;
+        std::uint64_t sequence = since;
+        while (count < max) {
+            std::uint64_t head = head_.load(std::memory_order_acquire);
+            if (sequence >= head) {
+                break;
+            }
+            if (head - sequence > capacity()) {
+                if (count > 0) {
+                    break;                      // Keep what was copied consecutive.
+                }
+                sequence = head - capacity();   // Lapped: skip to the oldest trade held.
+                continue;
+            }
+            if (readSlot(sequence, out[count])) {
+                count++;
+                sequence++;
+                continue;
+            }
+            // The slot did not hold this trade whole: either the writer lapped
+            // us meanwhile (go round again) or it is still writing it (stop).
+            if (head_.load(std::memory_order_acquire) - sequence <= capacity()) {
+                break;
+            }
+        }
+        return count;
+    }
+
+private:
+    struct Payload {
+        std::uint64_t commandSequence = 0;
+        std::int64_t timestamp = 0;
+        Trade trade{};
+        Symbol symbol;
+    };
+    static_assert(std::is_trivially_copyable<Trade>::value, "trades are copied as words");
+    static constexpr std::size_t kWords = (sizeof(Payload) + 7) / 8;
+
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> version{ 0 };   // Sequence + 1 of the trade held; 0 while written.
+        std::atomic<std::uint64_t> words[kWords] = {};
+    };
+
+    bool readSlot(std::uint64_t sequence, TapeTrade& out) const {
+        const Slot& slot = slots_[sequence & mask_];
+        std::uint64_t version = slot.version.load(std::memory_order_acquire);
+        if (version != sequence + 1) {
+            return false;
+        }
+        std::uint64_t words[kWords];
+        for (std::size_t w = 0; w < kWords; w++) {
+            words[w] = slot.words[w].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.version.load(std::memory_order_relaxed) != version) {
+            return false;
+        }
+        Payload payload;
+        std::memcpy(&payload, words, sizeof(payload));
+        out.sequence = sequence;
+        out.commandSequence = payload.commandSequence;
+        out.timestamp = payload.timestamp;
+        out.trade = payload.trade;
+        out.symbol = payload.symbol;
+        return true;
+    }
+
+    std::unique_ptr<Slot[]> slots_;
+    std::size_t mask_ = 0;
+
+    alignas(64) std::atomic<std::uint64_t> head_{ 0 };  // Written by the writer only.
+};
+
+#endif // TRADE_TAPE_H
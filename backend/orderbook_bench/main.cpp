@@ -0,0 +1,425 @@
+#include "../orderbook/order_book.h"
+#include "../orderbook/command_file.h"
+#include "../orderbook/latency_histogram.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Standalone benchmark of OrderBook itself, without the engine, journal or
+// network in the way. It either generates a synthetic order flow or reads a
+// recorded command file (see command_file.h), then applies it to fresh books
+// twice: once untimed for throughput, once timing every command to report
+// its latency distribution by kind.
+//
+//   orderbook_bench [--operations=N] [--warmup=N] [--depth=N]
+//                   [--cancel-ratio=R] [--aggressive-ratio=R]
+//                   [--distribution=uniform|exponential|normal] [--seed=N]
+//                   [--record=FILE] [--replay=FILE]
+
+using Clock = std::chrono::steady_clock;
+
+enum class PriceDistribution
+{
+    UNIFORM,        // Every level of the book equally likely.
+    EXPONENTIAL,    // Concentrated at the touch, thinning out with distance.
+    NORMAL          // Bell around the middle of the book.
+};
+
+struct BenchConfig
+{
+    std::size_t operations = 1000000;   // Timed commands.
+    std::size_t warmup = 100000;        // Untimed commands applied first.
+    std::size_t depth = 50;             // Price levels per side orders rest on.
+    double cancelRatio = 0.3;           // Share of commands that cancel a resting order.
+    double aggressiveRatio = 0.1;       // Share of adds that cross the spread.
+    PriceDistribution distribution = PriceDistribution::EXPONENTIAL;
+    std::uint64_t seed = 1;
+    std::string recordPath;             // Write the generated flow here.
+    std::string replayPath;             // Read the flow from here instead.
+    bool warmupSet = false;
+};
+
+// -----------------------------------------------------------------------------
+// Command line: --name=value options.
+// -----------------------------------------------------------------------------
+void printUsage()
+{
+    std::printf(
+        "usage: orderbook_bench [options]\n"
+        "  --operations=N        timed commands (default 1000000)\n"
+        "  --warmup=N            untimed commands applied first (default 100000; 0 when replaying)\n"
+        "  --depth=N             price levels per side (default 50)\n"
+        "  --cancel-ratio=R      share of commands that are cancels (default 0.3)\n"
+        "  --aggressive-ratio=R  share of adds that cross the spread (default 0.1)\n"
+        "  --distribution=D      uniform | exponential (default) | normal\n"
+        "  --seed=N              random seed (default 1)\n"
+        "  --record=FILE         save the generated flow as a command file\n"
+        "  --replay=FILE         benchmark a recorded command file instead\n");
+}
+
+bool parseArguments(int argc, char** argv, BenchConfig& config)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        std::size_t equals = argument.find('=');
+        std::string name = argument.substr(0, equals);
+        std::string value = equals == std::string::npos ? std::string() : argument.substr(equals + 1);
+        if (name == "--operations") {
+            config.operations = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        else if (name == "--warmup") {
+            config.warmup = std::strtoull(value.c_str(), nullptr, 10);
+            config.warmupSet = true;
+        }
+        else if (name == "--depth") {
+            config.depth = std::max<std::size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+        }
+        else if (name == "--cancel-ratio") {
+            config.cancelRatio = std::atof(value.c_str());
+        }
+        else if (name == "--aggressive-ratio") {
+            config.aggressiveRatio = std::atof(value.c_str());
+        }
+        else if (name == "--distribution") {
+            if (value == "uniform") {
+                config.distribution = PriceDistribution::UNIFORM;
+            }
+            else if (value == "exponential") {
+                config.distribution = PriceDistribution::EXPONENTIAL;
+            }
+            else if (value == "normal") {
+                config.distribution = PriceDistribution::NORMAL;
+            }
+            else {
+                std::fprintf(stderr, "unknown distribution '%s'\n", value.c_str());
+                return false;
+            }
+        }
+        else if (name == "--seed") {
+            config.seed = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        else if (name == "--record") {
+            config.recordPath = value;
+        }
+        else if (name == "--replay") {
+            config.replayPath = value;
+        }
+        else {
+            printUsage();
+            return false;
+        }
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Synthetic flow. The generator runs the flow through a shadow book as it
+// goes, so cancels always name an order that is still resting. Only
+// mt19937_64's raw output is used (the <random> distributions differ between
+// standard libraries), so a seed gives the same flow on every platform.
+// -----------------------------------------------------------------------------
+class FlowGenerator
+{
+public:
+    explicit FlowGenerator(const BenchConfig& config) : config_(config), random_(config.seed) {}
+
+    std::vector<RecordedCommand> generate()
+    {
+        std::size_t seedOrders = config_.depth * 8;
+        std::size_t total = seedOrders + config_.warmup + config_.operations;
+        std::vector<RecordedCommand> commands;
+        commands.reserve(total);
+
+        // Rest a few orders on every level first, so the timed flow starts on a full book.
+        for (std::size_t i = 0; i < seedOrders; i++)
+        {
+            OrderType side = i % 2 == 0 ? OrderType::BUY : OrderType::SELL;
+            commands.push_back(add(side, 1 + (i / 2) % config_.depth));
+        }
+        while (commands.size() < total)
+        {
+            if (uniform() < config_.cancelRatio && pickLive(commands)) {
+                continue;
+            }
+            OrderType side = (random_() & 1) ? OrderType::BUY : OrderType::SELL;
+            std::int64_t offset = 1 + static_cast<std::int64_t>(levelOffset());
+            // Aggressive orders are priced through the touch into the other side.
+            commands.push_back(add(side, uniform() < config_.aggressiveRatio ? -offset : offset));
+        }
+        return commands;
+    }
+
+    // Warmup including the seeding orders.
+    std::size_t warmup() const { return config_.depth * 8 + config_.warmup; }
+
+private:
+    // Prices are whole cents around 100.00, built from integer ticks so they
+    // print back exactly.
+    static constexpr std::int64_t kMidTicks = 10000;
+    static constexpr double kTicksPerUnit = 100.0;
+
+    double uniform() { return static_cast<double>(random_() >> 11) * (1.0 / 9007199254740992.0); }
+
+    // Distance from the touch, in levels, in [0, depth).
+    std::size_t levelOffset()
+    {
+        double depth = static_cast<double>(config_.depth);
+        double level = 0.0;
+        switch (config_.distribution) {
+        case PriceDistribution::UNIFORM:
+            level = uniform() * depth;
+            break;
+        case PriceDistribution::EXPONENTIAL:
+            level = -std::log(1.0 - uniform()) * depth / 8.0;
+            break;
+        case PriceDistribution::NORMAL: {
+            // Box-Muller, centred on the middle of the book.
+            double u1 = 1.0 - uniform();
+            double u2 = uniform();
+            level = depth / 2.0 + std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2) * depth / 6.0;
+            break;
+        }
+        }
+        return static_cast<std::size_t>(std::min(std::max(level, 0.0), depth - 1.0));
+    }
+
+    // An add `ticksAway` ticks behind the touch on its own side (negative:
+    // through it into the other side).
+    RecordedCommand add(OrderType side, std::int64_t ticksAway)
+    {
+        std::int64_t ticks = kMidTicks + (side == OrderType::BUY ? -ticksAway : ticksAway);
+        double price = static_cast<double>(ticks) / kTicksPerUnit;
+        int quantity = 1 + static_cast<int>(random_() % 100);
+        RecordedCommand recorded;
+        recorded.timestamp = nextTimestamp();
+        recorded.command.type = BookCommand::Type::ADD;
+        recorded.command.orderId = nextOrderId_++;
+        recorded.command.order = Order(recorded.command.orderId, price, quantity, side);
+        shadow_.addOrder(recorded.command.order, trades_);
+        trades_.clear();
+        if (shadow_.hasOrder(recorded.command.orderId)) {
+            live_.push_back(recorded.command.orderId);
+        }
+        return recorded;
+    }
+
+    // Appends a cancel of a random resting order; false if none is left.
+    bool pickLive(std::vector<RecordedCommand>& commands)
+    {
+        while (!live_.empty())
+        {
+            std::size_t index = static_cast<std::size_t>(random_() % live_.size());
+            OrderId orderId = live_[index];
+            live_[index] = live_.back();
+            live_.pop_back();
+            if (shadow_.cancelOrder(orderId)) {
+                RecordedCommand recorded;
+                recorded.timestamp = nextTimestamp();
+                recorded.command.type = BookCommand::Type::CANCEL;
+                recorded.command.orderId = orderId;
+                commands.push_back(recorded);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::int64_t nextTimestamp() { return timestamp_ += 1000; }
+
+    const BenchConfig& config_;
+    std::mt19937_64 random_;
+    OrderBook shadow_;
+    std::vector<Trade> trades_;
+    std::vector<OrderId> live_;
+    OrderId nextOrderId_ = 1;
+    std::int64_t timestamp_ = 0;
+};
+
+// -----------------------------------------------------------------------------
+// Runs. Both passes apply the same commands to fresh books; a command file
+// may name several symbols, each with its own book.
+// -----------------------------------------------------------------------------
+struct RunStats
+{
+    LatencyHistogram resting;   // Adds that did not trade.
+    LatencyHistogram matched;   // Adds that traded (the matching path).
+    LatencyHistogram cancels;
+    double seconds = 0.0;       // Wall time of the commands after the warmup.
+    std::size_t trades = 0;
+    std::uint64_t tradeHash = 14695981039346656037ULL;
+};
+
+class BookSet
+{
+public:
+    OrderBook& bookFor(const Symbol& symbol)
+    {
+        if (last_ == nullptr || symbol != lastSymbol_) {
+            auto it = books_.find(symbol);
+            if (it == books_.end()) {
+                it = books_.emplace(symbol, std::make_unique<OrderBook>()).first;
+            }
+            last_ = it->second.get();
+            lastSymbol_ = symbol;
+        }
+        return *last_;
+    }
+
+private:
+    std::unordered_map<Symbol, std::unique_ptr<OrderBook>, SymbolHash> books_;
+    OrderBook* last_ = nullptr;
+    Symbol lastSymbol_;
+};
+
+// Applies one command; returns true if it was an add or modify (either may trade).
+inline bool apply(BookSet& books, const BookCommand& command, std::vector<Trade>& trades)
+{
+    if (command.type == BookCommand::Type::ADD) {
+        books.bookFor(command.order.symbol).addOrder(command.order, trades);
+        return true;
+    }
+    if (command.type == BookCommand::Type::MODIFY) {
+        books.bookFor(command.order.symbol).modifyOrder(command.orderId, command.order.GetPrice(),
+            command.order.quantity, trades);
+        return true;
+    }
+    books.bookFor(command.order.symbol).cancelOrder(command.orderId);
+    return false;
+}
+
+void hashTrades(RunStats& stats, const std::vector<Trade>& trades)
+{
+    for (const Trade& trade : trades)
+    {
+        std::int64_t fields[4] = { trade.buyOrderID, trade.sellOrderID, trade.quantity,
+            static_cast<std::int64_t>(std::llround(trade.tradePrice * 1e8)) };
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(fields);
+        for (std::size_t i = 0; i < sizeof(fields); i++)
+        {
+            stats.tradeHash = (stats.tradeHash ^ bytes[i]) * 1099511628211ULL;
+        }
+    }
+    stats.trades += trades.size();
+}
+
+// Throughput pass: nothing but the book calls inside the clock.
+void runUntimed(const std::vector<RecordedCommand>& commands, std::size_t warmup, RunStats& stats)
+{
+    BookSet books;
+    std::vector<Trade> trades;
+    trades.reserve(1024);
+    std::size_t first = std::min(warmup, commands.size());
+    for (std::size_t i = 0; i < first; i++)
+    {
+        apply(books, commands[i].command, trades);
+        trades.clear();
+    }
+    Clock::time_point start = Clock::now();
+    for (std::size_t i = first; i < commands.size(); i++)
+    {
+        apply(books, commands[i].command, trades);
+        trades.clear();
+    }
+    stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Latency pass: every command after the warmup is timed on its own.
+void runTimed(const std::vector<RecordedCommand>& commands, std::size_t warmup, RunStats& stats)
+{
+    BookSet books;
+    std::vector<Trade> trades;
+    trades.reserve(1024);
+    for (std::size_t i = 0; i < commands.size(); i++)
+    {
+        Clock::time_point start = Clock::now();
+        bool added = apply(books, commands[i].command, trades);
+        Clock::time_point end = Clock::now();
+        if (i >= warmup) {
+            auto nanos = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            if (!added) {
+                stats.cancels.record(nanos);
+            }
+            else if (trades.empty()) {
+                stats.resting.record(nanos);
+            }
+            else {
+                stats.matched.record(nanos);
+            }
+        }
+        hashTrades(stats, trades);
+        trades.clear();
+    }
+}
+
+void printRow(const char* name, const LatencyHistogram& histogram)
+{
+    std::printf("%-10s %10llu %8.0f %8llu %8llu %8llu %10llu\n", name,
+        static_cast<unsigned long long>(histogram.count()), histogram.mean(),
+        static_cast<unsigned long long>(histogram.percentile(50.0)),
+        static_cast<unsigned long long>(histogram.percentile(99.0)),
+        static_cast<unsigned long long>(histogram.percentile(99.9)),
+        static_cast<unsigned long long>(histogram.max()));
+}
+
+int main(int argc, char** argv)
+{
+    BenchConfig config;
+    if (!parseArguments(argc, argv, config)) {
+        return 2;
+    }
+
+    std::vector<RecordedCommand> commands;
+    std::size_t warmup = 0;
+    if (!config.replayPath.empty()) {
+        std::string error;
+        if (!readCommandFile(config.replayPath, commands, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        warmup = config.warmupSet ? config.warmup : 0;
+        std::printf("replaying %zu commands from %s\n", commands.size(), config.replayPath.c_str());
+    }
+    else {
+        FlowGenerator generator(config);
+        commands = generator.generate();
+        warmup = generator.warmup();
+        std::printf("synthetic flow: %zu commands (%zu warmup), depth %zu, cancel ratio %.2f, aggressive ratio %.2f, seed %llu\n",
+            commands.size(), warmup, config.depth, config.cancelRatio, config.aggressiveRatio,
+            static_cast<unsigned long long>(config.seed));
+    }
+    if (!config.recordPath.empty() && !writeCommandFile(config.recordPath, commands)) {
+        std::fprintf(stderr, "cannot write %s\n", config.recordPath.c_str());
+        return 1;
+    }
+
+    RunStats throughput;
+    runUntimed(commands, warmup, throughput);
+    RunStats latency;
+    runTimed(commands, warmup, latency);
+
+    std::size_t measured = commands.size() - std::min(warmup, commands.size());
+    std::printf("throughput: %.0f commands/s (%zu commands in %.3f s)\n",
+        throughput.seconds > 0.0 ? static_cast<double>(measured) / throughput.seconds : 0.0,
+        measured, throughput.seconds);
+    std::printf("trades: %zu, trade hash %016llx\n", latency.trades,
+        static_cast<unsigned long long>(latency.tradeHash));
+
+    LatencyHistogram all;
+    all.merge(latency.resting);
+    all.merge(latency.matched);
+    all.merge(latency.cancels);
+    std::printf("\n%-10s %10s %8s %8s %8s %8s %10s\n", "ns", "count", "mean", "p50", "p99", "p99.9", "max");
+    printRow("add", latency.resting);
+    printRow("match", latency.matched);
+    printRow("cancel", latency.cancels);
+    printRow("all", all);
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "../orderbook/market_data_ring.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Follows the server's shared memory market data ring (ORDERBOOK_MD_RING) and
+// prints each trade and book delta, or only how long records took to arrive.
+// Doubles as the example consumer of the reader library.
+//
+//   orderbook_md_tail [--ring=NAME] [--from-oldest] [--count=N] [--quiet]
+
+struct TailConfig
+{
+    std::string ring = "/orderbook-md";
+    bool fromOldest = false;        // Start at the oldest record held instead of the head.
+    std::uint64_t count = 0;        // Stop after this many records; 0 = run until the ring closes.
+    bool quiet = false;             // Only print the summary.
+};
+
+// -----------------------------------------------------------------------------
+// Command line: --name=value options.
+// -----------------------------------------------------------------------------
+void printUsage()
+{
+    std::printf(
+        "usage: orderbook_md_tail [options]\n"
+        "  --ring=NAME      shared memory ring to follow (default /orderbook-md)\n"
+        "  --from-oldest    start at the oldest record held, not at the next one published\n"
+        "  --count=N        stop after N records (default: until the ring is closed)\n"
+        "  --quiet          print only the summary\n");
+}
+
+bool parseArguments(int argc, char** argv, TailConfig& config)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        std::size_t equals = argument.find('=');
+        std::string name = argument.substr(0, equals);
+        std::string value = equals == std::string::npos ? std::string() : argument.substr(equals + 1);
+        if (name == "--ring") {
+            config.ring = value;
+        }
+        else if (name == "--from-oldest") {
+            config.fromOldest = true;
+        }
+        else if (name == "--count") {
+            config.count = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        else if (name == "--quiet") {
+            config.quiet = true;
+        }
+        else {
+            printUsage();
+            return false;
+        }
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Output.
+// -----------------------------------------------------------------------------
+const char* typeName(MarketDataType type)
+{
+    switch (type) {
+    case MarketDataType::TRADE: return "trade";
+    case MarketDataType::ORDER_ADDED: return "add";
+    case MarketDataType::ORDER_REMOVED: return "remove";
+    case MarketDataType::ORDER_EXECUTED: return "execute";
+    case MarketDataType::ORDER_MODIFIED: return "modify";
+    case MarketDataType::LEVEL: return "level";
+    default: return "?";
+    }
+}
+
+void printRecord(std::uint64_t sequence, const MarketDataRecord& record)
+{
+    if (record.type == MarketDataType::TRADE) {
+        std::printf("%llu %s book %llu trade %lld @ %.6g buy %d sell %d\n",
+            static_cast<unsigned long long>(sequence), record.symbol,
+            static_cast<unsigned long long>(record.bookSequence), static_cast<long long>(record.quantity),
+            record.price, record.orderId, record.other);
+        return;
+    }
+    std::printf("%llu %s book %llu %s %s %lld @ %.6g order %d other %d\n",
+        static_cast<unsigned long long>(sequence), record.symbol,
+        static_cast<unsigned long long>(record.bookSequence), typeName(record.type),
+        record.side == 0 ? "buy" : "sell", static_cast<long long>(record.quantity),
+        record.price, record.orderId, record.other);
+}
+
+std::int64_t nowNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char** argv)
+{
+    TailConfig config;
+    if (!parseArguments(argc, argv, config)) {
+        return 2;
+    }
+    MarketDataReader reader;
+    std::string error;
+    if (!reader.open(config.ring, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    if (config.fromOldest) {
+        std::uint64_t head = reader.head();
+        reader.seek(head > reader.capacity() ? head - reader.capacity() : 0);
+    }
+
+    // Busy-polls, as a latency-sensitive consumer would; the latency of each
+    // record is its arrival time minus the time it was published. Only the
+    // latest kMaxSamples are kept.
+    constexpr std::size_t kMaxSamples = 1 << 20;
+    std::vector<std::int64_t> latencies;
+    MarketDataRecord record;
+    std::uint64_t sequence = 0;
+    std::uint64_t received = 0;
+    while (config.count == 0 || received < config.count)
+    {
+        if (!reader.poll(record, sequence)) {
+            if (reader.closed()) {
+                break;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        std::int64_t latency = nowNanos() - record.timestamp;
+        if (latencies.size() < kMaxSamples) {
+            latencies.push_back(latency);
+        }
+        else {
+            latencies[received % kMaxSamples] = latency;
+        }
+        received++;
+        if (!config.quiet) {
+            printRecord(sequence, record);
+        }
+    }
+
+    std::fprintf(stderr, "records: %llu, overruns: %llu\n", static_cast<unsigned long long>(received),
+        static_cast<unsigned long long>(reader.overruns()));
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&latencies](double p) {
+            return static_cast<long long>(latencies[static_cast<std::size_t>(p * static_cast<double>(latencies.size() - 1))]);
+        };
+        std::fprintf(stderr, "publish to read (ns): p50 %lld, p99 %lld, max %lld\n",
+            percentile(0.5), percentile(0.99), static_cast<long long>(latencies.back()));
+    }
+    return 0;
+}
@@ -0,0 +1,321 @@
+#include "../orderbook/order_book.h"
+#include "../orderbook/command_file.h"
+#include "../orderbook/snapshot.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Offline replay of a recorded command file (CSV or binary journal segment,
+// see command_file.h) through fresh OrderBooks, one per symbol, on a single
+// thread. Writes every trade and periodic per-book checksums so two builds
+// can be compared on the same captured flow. Everything the output depends on
+// comes from the input: orders carry the file's timestamps, never the clock,
+// so two runs over the same file produce byte-identical output. Timing only
+// goes to stderr.
+//
+//   orderbook_replay --input=FILE [--speed=X] [--trades=FILE]
+//                    [--checksums=FILE] [--checksum-every=N]
+
+using Clock = std::chrono::steady_clock;
+
+struct ReplayConfig
+{
+    std::string inputPath;
+    double speed = 0.0;                 // Multiple of recorded time; 0 = as fast as possible.
+    std::string tradesPath;             // Trades CSV ("-" = stdout).
+    std::string checksumsPath;          // Book checksums CSV ("-" = stdout).
+    std::size_t checksumEvery = 0;      // Commands between checksum rows; 0 = only at the end.
+};
+
+// -----------------------------------------------------------------------------
+// Command line: --name=value options.
+// -----------------------------------------------------------------------------
+void printUsage()
+{
+    std::printf(
+        "usage: orderbook_replay --input=FILE [options]\n"
+        "  --input=FILE          command file to replay: CSV or binary journal segment\n"
+        "  --speed=X             replay at X times recorded speed (default 0: as fast as possible)\n"
+        "  --trades=FILE         write every trade as CSV (- for stdout)\n"
+        "  --checksums=FILE      write book checksums as CSV (- for stdout)\n"
+        "  --checksum-every=N    also checksum every book after each N commands\n");
+}
+
+bool parseArguments(int argc, char** argv, ReplayConfig& config)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        std::size_t equals = argument.find('=');
+        std::string name = argument.substr(0, equals);
+        std::string value = equals == std::string::npos ? std::string() : argument.substr(equals + 1);
+        if (name == "--input") {
+            config.inputPath = value;
+        }
+        else if (name == "--speed") {
+            config.speed = std::max(0.0, std::atof(value.c_str()));
+        }
+        else if (name == "--trades") {
+            config.tradesPath = value;
+        }
+        else if (name == "--checksums") {
+            config.checksumsPath = value;
+        }
+        else if (name == "--checksum-every") {
+            config.checksumEvery = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        else {
+            printUsage();
+            return false;
+        }
+    }
+    if (config.inputPath.empty()) {
+        printUsage();
+        return false;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Output. Prices are written with the fewest digits that read back exactly,
+// and books are always visited in symbol order, so the files only depend on
+// the input.
+// -----------------------------------------------------------------------------
+class OutputFile
+{
+public:
+    bool open(const std::string& path)
+    {
+        if (path.empty()) {
+            return true;
+        }
+        file_ = path == "-" ? stdout : std::fopen(path.c_str(), "wb");
+        return file_ != nullptr;
+    }
+
+    ~OutputFile()
+    {
+        if (file_ != nullptr && file_ != stdout) {
+            std::fclose(file_);
+        }
+    }
+
+    explicit operator bool() const { return file_ != nullptr; }
+    std::FILE* get() const { return file_; }
+
+private:
+    std::FILE* file_ = nullptr;
+};
+
+std::string formatPrice(Price price)
+{
+    char text[32];
+    auto written = std::to_chars(text, text + sizeof(text), price);
+    return std::string(text, written.ptr);
+}
+
+constexpr std::uint64_t kFnvOffset = 14695981039346656037ULL;
+
+std::uint64_t fnv1a(std::uint64_t hash, const void* data, std::size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// -----------------------------------------------------------------------------
+// Replay.
+// -----------------------------------------------------------------------------
+class Replay
+{
+public:
+    Replay(OutputFile& trades, OutputFile& checksums) : tradesOut_(trades), checksumsOut_(checksums)
+    {
+        trades_.reserve(1024);
+        if (tradesOut_) {
+            std::fprintf(tradesOut_.get(), "# command,timestamp_ns,symbol,buyOrderID,sellOrderID,quantity,price\n");
+        }
+        if (checksumsOut_) {
+            std::fprintf(checksumsOut_.get(), "# command,symbol,updateSequence,checksum\n");
+        }
+    }
+
+    void apply(std::size_t index, const RecordedCommand& recorded)
+    {
+        const BookCommand& command = recorded.command;
+        const Symbol& symbol = command.order.symbol;
+        OrderBook& book = bookFor(symbol);
+        bool accepted = false;
+        if (command.type == BookCommand::Type::ADD) {
+            accepted = book.addOrder(command.order, trades_);
+        }
+        else if (command.type == BookCommand::Type::MODIFY) {
+            accepted = book.modifyOrder(command.orderId, command.order.GetPrice(), command.order.quantity, trades_);
+        }
+        else {
+            accepted = book.cancelOrder(command.orderId);
+        }
+        (accepted ? accepted_ : rejected_)++;
+        for (const Trade& trade : trades_)
+        {
+            std::int64_t fields[4] = { trade.buyOrderID, trade.sellOrderID, trade.quantity, recorded.timestamp };
+            tradeHash_ = fnv1a(tradeHash_, fields, sizeof(fields));
+            tradeHash_ = fnv1a(tradeHash_, &trade.tradePrice, sizeof(trade.tradePrice));
+            if (tradesOut_) {
+                std::fprintf(tradesOut_.get(), "%zu,%lld,%s,%d,%d,%d,%s\n", index,
+                    static_cast<long long>(recorded.timestamp), symbol.c_str(), trade.buyOrderID,
+                    trade.sellOrderID, trade.quantity, formatPrice(trade.tradePrice).c_str());
+            }
+        }
+        tradeCount_ += trades_.size();
+        trades_.clear();
+    }
+
+    // Writes a checksum row for every book, as of `commands` commands applied.
+    void writeChecksums(std::size_t commands)
+    {
+        if (!checksumsOut_) {
+            return;
+        }
+        for (const Symbol& symbol : sortedSymbols())
+        {
+            const OrderBook& book = *books_.at(symbol);
+            std::fprintf(checksumsOut_.get(), "%zu,%s,%llu,%016llx\n", commands, symbol.c_str(),
+                static_cast<unsigned long long>(book.updateSequence()),
+                static_cast<unsigned long long>(checksum(book)));
+        }
+    }
+
+    // Checksum of every book's full state, in symbol order.
+    std::uint64_t bookHash()
+    {
+        std::uint64_t hash = kFnvOffset;
+        for (const Symbol& symbol : sortedSymbols())
+        {
+            std::uint64_t book = checksum(*books_.at(symbol));
+            hash = fnv1a(hash, symbol.c_str(), std::char_traits<char>::length(symbol.c_str()));
+            hash = fnv1a(hash, &book, sizeof(book));
+        }
+        return hash;
+    }
+
+    std::size_t accepted() const { return accepted_; }
+    std::size_t rejected() const { return rejected_; }
+    std::size_t tradeCount() const { return tradeCount_; }
+    std::uint64_t tradeHash() const { return tradeHash_; }
+    std::size_t bookCount() const { return books_.size(); }
+
+private:
+    OrderBook& bookFor(const Symbol& symbol)
+    {
+        if (last_ == nullptr || symbol != lastSymbol_) {
+            auto it = books_.find(symbol);
+            if (it == books_.end()) {
+                it = books_.emplace(symbol, std::make_unique<OrderBook>()).first;
+            }
+            last_ = it->second.get();
+            lastSymbol_ = symbol;
+        }
+        return *last_;
+    }
+
+    std::vector<Symbol> sortedSymbols() const
+    {
+        std::vector<Symbol> symbols;
+        symbols.reserve(books_.size());
+        for (const auto& entry : books_)
+        {
+            symbols.push_back(entry.first);
+        }
+        std::sort(symbols.begin(), symbols.end());
+        return symbols;
+    }
+
+    // FNV-1a of the book's snapshot image: every level, resting order (with
+    // its timestamp) and dormant stop, in priority order.
+    std::uint64_t checksum(const OrderBook& book)
+    {
+        image_.clear();
+        SnapshotWriter writer(image_);
+        book.saveSnapshot(writer);
+        return fnv1a(kFnvOffset, image_.data(), image_.size());
+    }
+
+    OutputFile& tradesOut_;
+    OutputFile& checksumsOut_;
+    std::unordered_map<Symbol, std::unique_ptr<OrderBook>, SymbolHash> books_;
+    OrderBook* last_ = nullptr;
+    Symbol lastSymbol_;
+    std::vector<Trade> trades_;
+    std::vector<char> image_;
+    std::size_t accepted_ = 0;
+    std::size_t rejected_ = 0;
+    std::size_t tradeCount_ = 0;
+    std::uint64_t tradeHash_ = kFnvOffset;
+};
+
+int main(int argc, char** argv)
+{
+    ReplayConfig config;
+    if (!parseArguments(argc, argv, config)) {
+        return 2;
+    }
+
+    std::vector<RecordedCommand> commands;
+    std::string error;
+    if (!readCommandFile(config.inputPath, commands, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    OutputFile tradesOut;
+    OutputFile checksumsOut;
+    if (!tradesOut.open(config.tradesPath)) {
+        std::fprintf(stderr, "cannot write %s\n", config.tradesPath.c_str());
+        return 1;
+    }
+    if (!checksumsOut.open(config.checksumsPath)) {
+        std::fprintf(stderr, "cannot write %s\n", config.checksumsPath.c_str());
+        return 1;
+    }
+
+    // Paced replays sleep until each command's recorded offset, scaled by
+    // the speed, has elapsed; that only changes when commands run, not what
+    // they do.
+    Replay replay(tradesOut, checksumsOut);
+    Clock::time_point start = Clock::now();
+    std::int64_t firstTimestamp = commands.empty() ? 0 : commands.front().timestamp;
+    for (std::size_t i = 0; i < commands.size(); i++)
+    {
+        if (config.speed > 0.0) {
+            auto offset = std::chrono::duration<double, std::nano>(
+                static_cast<double>(commands[i].timestamp - firstTimestamp) / config.speed);
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(offset));
+        }
+        replay.apply(i, commands[i]);
+        if (config.checksumEvery != 0 && (i + 1) % config.checksumEvery == 0 && i + 1 != commands.size()) {
+            replay.writeChecksums(i + 1);
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    replay.writeChecksums(commands.size());
+
+    std::FILE* summary = config.tradesPath == "-" || config.checksumsPath == "-" ? stderr : stdout;
+    std::fprintf(summary, "commands: %zu (%zu accepted, %zu rejected) on %zu books\n", commands.size(),
+        replay.accepted(), replay.rejected(), replay.bookCount());
+    std::fprintf(summary, "trades: %zu, trade hash %016llx\n", replay.tradeCount(),
+        static_cast<unsigned long long>(replay.tradeHash()));
+    std::fprintf(summary, "book checksum: %016llx\n", static_cast<unsigned long long>(replay.bookHash()));
+    std::fprintf(stderr, "replayed in %.3f s (%.0f commands/s)\n", seconds,
+        seconds > 0.0 ? static_cast<double>(commands.size()) / seconds : 0.0);
+    return 0;
+}
@@ -0,0 +1,183 @@
+#include "binary_gateway.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+const std::uintptr_t kNoSocket = static_cast<std::uintptr_t>(INVALID_SOCKET);
+
+void closeSocket(std::uintptr_t socket) {
+    closesocket(static_cast<SocketHandle>(socket));
+}
+
+void shutdownSocket(std::uintptr_t socket) {
+    shutdown(static_cast<SocketHandle>(socket), SD_BOTH);
+}
+#else
+using SocketHandle = int;
+const std::uintptr_t kNoSocket = static_cast<std::uintptr_t>(-1);
+
+void closeSocket(std::uintptr_t socket) {
+    ::close(static_cast<SocketHandle>(socket));
+}
+
+void shutdownSocket(std::uintptr_t socket) {
+    shutdown(static_cast<SocketHandle>(socket), SHUT_RDWR);
+}
+#endif
+
+bool sendAll(std::uintptr_t socket, const std::string& data) {
+    std::size_t sent = 0;
+    while (sent < data.size()) {
+        int chunk = static_cast<int>(std::min<std::size_t>(data.size() - sent, 1 << 20));
+        int written = send(static_cast<SocketHandle>(socket), data.data() + sent, chunk, 0);
+        if (written <= 0) {
+            return false;
+        }
+        sent += static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+// Bytes read from a connection per recv().
+constexpr int kReadChunk = 64 * 1024;
+
+} // namespace
+
+BinaryGateway::BinaryGateway(Handler handler)
+    : handler_(std::move(handler)), listener_(kNoSocket) {
+}
+
+BinaryGateway::~BinaryGateway() {
+    stop();
+}
+
+bool BinaryGateway::start(std::uint16_t port) {
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        return false;
+    }
+#endif
+    SocketHandle listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (static_cast<std::uintptr_t>(listener) == kNoSocket) {
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || listen(listener, SOMAXCONN) != 0) {
+        closeSocket(static_cast<std::uintptr_t>(listener));
+        return false;
+    }
+    listener_ = static_cast<std::uintptr_t>(listener);
+    stopping_.store(false);
+    acceptor_ = std::thread([this] { acceptLoop(); });
+    return true;
+}
+
+void BinaryGateway::stop() {
+    if (!acceptor_.joinable()) {
+        return;
+    }
+    stopping_.store(true);
+    shutdownSocket(listener_);
+    closeSocket(listener_);
+    acceptor_.join();
+    listener_ = kNoSocket;
+
+    std::vector<Worker> workers;
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        for (std::uintptr_t client : clients_) {
+            shutdownSocket(client);
+        }
+        workers.swap(workers_);
+    }
+    for (auto& worker : workers) {
+        worker.thread.join();
+    }
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+void BinaryGateway::acceptLoop() {
+    while (!stopping_.load()) {
+        SocketHandle client = accept(static_cast<SocketHandle>(listener_), nullptr, nullptr);
+        if (static_cast<std::uintptr_t>(client) == kNoSocket) {
+            continue;  // Interrupted, or the listener was closed by stop().
+        }
+        // Replies are small and latency-sensitive: do not wait to coalesce them.
+        int noDelay = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        if (stopping_.load()) {
+            closeSocket(static_cast<std::uintptr_t>(client));
+            break;
+        }
+        // Join the threads of connections that have ended since the last accept.
+        auto finished = std::partition(workers_.begin(), workers_.end(),
+            [](const Worker& worker) { return !worker.done->load(); });
+        for (auto it = finished; it != workers_.end(); ++it) {
+            it->thread.join();
+        }
+        workers_.erase(finished, workers_.end());
+
+        clients_.push_back(static_cast<std::uintptr_t>(client));
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        workers_.push_back({ std::thread([this, client, done] {
+            serve(static_cast<std::uintptr_t>(client));
+            done->store(true);
+        }), done });
+    }
+}
+
+// Per-connection loop: buffer the stream, let the handler take every
+// complete message, write the replies back.
+void BinaryGateway::serve(std::uintptr_t client) {
+    std::string buffer;
+    std::string replies;
+    std::vector<char> chunk(kReadChunk);
+    for (;;) {
+        int received = recv(static_cast<SocketHandle>(client), chunk.data(), kReadChunk, 0);
+        if (received <= 0) {
+            break;
+        }
+        buffer.append(chunk.data(), static_cast<std::size_t>(received));
+        bool fatal = false;
+        std::size_t used = handler_(buffer.data(), buffer.size(), replies, fatal);
+        buffer.erase(0, used);
+        if (!replies.empty() && !sendAll(client, replies)) {
+            break;
+        }
+        replies.clear();
+        if (fatal) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(clientsMutex_);
+    clients_.erase(std::find(clients_.begin(), clients_.end(), client));
+    closeSocket(client);
+}
@@ -0,0 +1,58 @@
+#ifndef BINARY_GATEWAY_H
+#define BINARY_GATEWAY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//
+// Raw TCP listener for the binary order-entry protocol. Every connection is
+// served by its own thread, which reads the byte stream, hands the buffered
+// bytes to the handler and writes back whatever replies it produced.
+//
+class BinaryGateway {
+public:
+    // Consumes complete messages at the start of [data, data + size), appends
+    // their replies to `replies` and returns the number of bytes used. Sets
+    // `fatal` if the connection must be closed once the replies are sent.
+    using Handler = std::function<std::size_t(const char* data, std::size_t size, std::string& replies, bool& fatal)>;
+
+    explicit BinaryGateway(Handler handler);
+    ~BinaryGateway();
+
+    BinaryGateway(const BinaryGateway&) = delete;
+    BinaryGateway& operator=(const BinaryGateway&) = delete;
+
+    // Listens on `port` on all interfaces. Returns false if it cannot bind.
+    bool start(std::uint16_t port);
+
+    // Closes the listener and every connection, then joins their threads.
+    void stop();
+
+private:
+    void acceptLoop();
+    void serve(std::uintptr_t client);
+
+    Handler handler_;
+    std::uintptr_t listener_;
+    std::atomic<bool> stopping_{ false };
+    std::thread acceptor_;
+
+    // One thread per connection; `done` is set when it is ready to be joined.
+    struct Worker {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> done;
+    };
+
+    std::mutex clientsMutex_;
+    std::vector<std::uintptr_t> clients_;
+    std::vector<Worker> workers_;
+};
+
+#endif // BINARY_GATEWAY_H
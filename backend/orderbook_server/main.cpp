@@ -1,80 +1,971 @@
 #include "crow.h"                 // Main Crow header
 #include "crow/middlewares/cors.h"  // CORSHandler and CORSRules
-#include "../orderbook/order_book.h"
-#include <unordered_set>
+#include "../orderbook/matching_engine.h"
+#include "../orderbook/client_feed.h"
+#include "../orderbook/binary_protocol.h"
+#include "../orderbook/metrics.h"
+#include "../orderbook/bar_aggregator.h"
+#include "../orderbook/json_writer.h"
+#include "../orderbook/market_data_ring.h"
+#include "binary_gateway.h"
+#include <unordered_map>
+#include <map>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <atomic>
 #include <thread>
+#include <cstdlib>
+#include <future>
+#include <tuple>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
 
 // Instead of crow::SimpleApp, we define an App with CORSHandler.
 using MyCORSApp = crow::App<crow::CORSHandler>;
 
+// Owners from kFirstSessionOwner up are given to WebSocket order-entry
+// sessions; clients may tag REST orders with owners below it.
+constexpr OwnerId kFirstSessionOwner = 1u << 31;
+std::atomic<OwnerId> next_session_owner{ kFirstSessionOwner };
+
+// Set on a WebSocket connection when it is accepted (conn.userdata()).
+struct Subscription
+{
+    Symbol symbol;
+    std::uint64_t id = 0;
+    std::chrono::milliseconds interval{ 0 };    // ?interval=<ms>: client's max update rate.
+    std::size_t window = 0;                     // ?window=<bytes>: unacknowledged bytes allowed.
+    // Binary orders sent over the connection belong to `owner`. With
+    // cancelOnDisconnect they are cancelled, on every symbol in
+    // `orderSymbols`, when the connection closes.
+    OwnerId owner = kNoOwner;
+    bool cancelOnDisconnect = false;
+    std::vector<Symbol> orderSymbols{};
+};
+std::atomic<std::uint64_t> next_subscription_id{ 1 };
+constexpr long kMaxFeedWindow = 64L << 20;
+
+// Each WebSocket connection follows the book of one symbol. It only receives
+// deltas once its snapshot has been sent (`live`), and only those newer than
+// the snapshot; what it is sent is paced and, if it falls behind, conflated
+// by its ClientFeed.
+struct Subscriber
+{
+    Symbol symbol;
+    std::uint64_t id = 0;
+    bool live = false;
+    std::uint64_t snapshotSequence = 0;
+    ClientFeed feed;
+};
+
 std::mutex connection_mutex;
-std::unordered_set<crow::websocket::connection*> active_connections;
+std::unordered_map<crow::websocket::connection*, Subscriber> active_connections;
 std::atomic<bool> running{ true };
-std::mutex orderBookMutex;
 
-// Global OrderBook instance.
-OrderBook globalOrderBook;
+// A /trades WebSocket connection: the symbol it follows and the tape
+// sequence it has been sent up to.
+struct TradeSubscriber
+{
+    Symbol symbol;
+    std::uint64_t next = 0;
+};
+
+std::mutex trade_connection_mutex;
+std::unordered_map<crow::websocket::connection*, TradeSubscriber> trade_connections;
+
+// A /bars WebSocket connection: the symbol and bar interval it follows.
+struct BarSubscriber
+{
+    Symbol symbol;
+    std::int64_t interval = 0;
+};
+
+std::mutex bar_connection_mutex;
+std::unordered_map<crow::websocket::connection*, BarSubscriber> bar_connections;
+
+// Number of matching shards: ORDERBOOK_SHARDS, or one per core.
+std::size_t configuredShardCount()
+{
+    if (const char* env = std::getenv("ORDERBOOK_SHARDS")) {
+        int shards = std::atoi(env);
+        if (shards > 0) {
+            return static_cast<std::size_t>(shards);
+        }
+    }
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores > 0 ? cores : 1;
+}
+
+// Instrument settings for every book. ORDERBOOK_ORDER_IDS=server makes the
+// books assign order IDs themselves; the orderID a client sends with a new
+// order is then ignored and the response carries the one assigned.
+InstrumentConfig configuredInstrument()
+{
+    InstrumentConfig config;
+    const char* env = std::getenv("ORDERBOOK_ORDER_IDS");
+    config.assignOrderIds = env != nullptr && std::string(env) == "server";
+    return config;
+}
+
+// Global matching engine. Every book is owned by exactly one shard thread,
+// so handlers never lock a book; they queue commands to its shard instead.
+MatchingEngine engine(configuredShardCount(), configuredInstrument());
+
+// Whether /orderbook sessions cancel their orders when they disconnect:
+// ORDERBOOK_CANCEL_ON_DISCONNECT=1, or ?cancelOnDisconnect=0|1 per connection.
+bool configuredCancelOnDisconnect()
+{
+    const char* env = std::getenv("ORDERBOOK_CANCEL_ON_DISCONNECT");
+    return env != nullptr && std::atoi(env) != 0;
+}
+const bool cancel_on_disconnect = configuredCancelOnDisconnect();
+
+// Bar intervals in milliseconds: ORDERBOOK_BAR_INTERVALS, comma-separated
+// (default 1 second and 1 minute). Returned in nanoseconds.
+std::vector<std::int64_t> configuredBarIntervals()
+{
+    const char* env = std::getenv("ORDERBOOK_BAR_INTERVALS");
+    std::string list = env ? env : "1000,60000";
+    std::vector<std::int64_t> intervals;
+    std::size_t start = 0;
+    while (start <= list.size()) {
+        std::size_t end = std::min(list.find(',', start), list.size());
+        long long millis = std::atoll(list.substr(start, end - start).c_str());
+        if (millis > 0) {
+            intervals.push_back(static_cast<std::int64_t>(millis) * 1000000);
+        }
+        start = end + 1;
+    }
+    return intervals;
+}
+
+// OHLCV bars of every symbol, built on their own thread from the trade tapes.
+BarAggregator bar_aggregator(engine, configuredBarIntervals());
+
+// Journal settings: ORDERBOOK_JOURNAL_DIR enables the write-ahead journal,
+// ORDERBOOK_DURABILITY picks none | batch (default) | sync.
+bool configuredJournal(JournalConfig& config)
+{
+    const char* dir = std::getenv("ORDERBOOK_JOURNAL_DIR");
+    if (dir == nullptr || *dir == '\0') {
+        return false;
+    }
+    config.directory = dir;
+    std::string durability = std::getenv("ORDERBOOK_DURABILITY") ? std::getenv("ORDERBOOK_DURABILITY") : "batch";
+    if (durability == "none") {
+        config.durability = Durability::NONE;
+    }
+    else if (durability == "sync") {
+        config.durability = Durability::SYNC;
+    }
+    else {
+        config.durability = Durability::BATCH;
+    }
+    return true;
+}
+
+// Books each shard creates for symbols it has not seen: ORDERBOOK_MAX_BOOKS.
+// Orders for further symbols are rejected, so clients cannot exhaust memory
+// by inventing symbols.
+std::size_t configuredBookLimit()
+{
+    const char* env = std::getenv("ORDERBOOK_MAX_BOOKS");
+    return env ? static_cast<std::size_t>(std::max(0, std::atoi(env))) : MatchingEngine::kDefaultBookLimit;
+}
+
+// Seconds between book snapshots: ORDERBOOK_SNAPSHOT_INTERVAL (0 = only at shutdown).
+int configuredSnapshotInterval()
+{
+    const char* env = std::getenv("ORDERBOOK_SNAPSHOT_INTERVAL");
+    return env ? std::max(0, std::atoi(env)) : 300;
+}
+
+// TCP port of the binary order-entry gateway: ORDERBOOK_BINARY_PORT (0 = off).
+int configuredBinaryPort()
+{
+    const char* env = std::getenv("ORDERBOOK_BINARY_PORT");
+    return env ? std::clamp(std::atoi(env), 0, 65535) : 9001;
+}
+
+// Shared memory market data ring: ORDERBOOK_MD_RING names the segment (unset
+// = off), ORDERBOOK_MD_RING_CAPACITY its size in records.
+bool configuredMarketDataRing(std::string& name, std::size_t& capacity)
+{
+    const char* env = std::getenv("ORDERBOOK_MD_RING");
+    if (!env || !*env) {
+        return false;
+    }
+    name = env;
+    capacity = MarketDataRing::kDefaultCapacity;
+    if (const char* size = std::getenv("ORDERBOOK_MD_RING_CAPACITY")) {
+        capacity = std::max<std::size_t>(2, std::strtoull(size, nullptr, 10));
+    }
+    return true;
+}
+
+// Reads the optional `symbol` query parameter (empty symbol = default book).
+bool symbolFromQuery(const crow::request& req, Symbol& symbol)
+{
+    const char* param = req.url_params.get("symbol");
+    if (param == nullptr) {
+        symbol = Symbol();
+        return true;
+    }
+    if (std::string(param).size() > Symbol::kMaxLength) {
+        return false;
+    }
+    symbol = Symbol(param);
+    return true;
+}
+
+// Reads the optional execution fields of a JSON order into `order`:
+// "timeInForce": "GTC" | "IOC" | "FOK", "market": true, "postOnly": true.
+// Returns false on an unknown time in force.
+bool readExecutionFields(const crow::json::rvalue& body, Order& order)
+{
+    if (body.has("timeInForce")) {
+        std::string timeInForce = body["timeInForce"].s();
+        if (timeInForce == "GTC") {
+            order.timeInForce = TimeInForce::GTC;
+        }
+        else if (timeInForce == "IOC") {
+            order.timeInForce = TimeInForce::IOC;
+        }
+        else if (timeInForce == "FOK") {
+            order.timeInForce = TimeInForce::FOK;
+        }
+        else {
+            return false;
+        }
+    }
+    if (body.has("market") && body["market"].b()) {
+        order.flags |= ORDER_MARKET;
+    }
+    if (body.has("postOnly") && body["postOnly"].b()) {
+        order.flags |= ORDER_POST_ONLY;
+    }
+    if (body.has("stopPrice")) {
+        order.flags |= ORDER_STOP;
+        order.stopPrice = body["stopPrice"].d();
+    }
+    return true;
+}
+
+// Reads the optional "owner" of a JSON order; false if it is out of the
+// range left to clients.
+bool readOwner(const crow::json::rvalue& body, Order& order)
+{
+    if (!body.has("owner")) {
+        return true;
+    }
+    std::int64_t owner = body["owner"].i();
+    if (owner < 0 || owner >= kFirstSessionOwner) {
+        return false;
+    }
+    order.owner = static_cast<OwnerId>(owner);
+    return true;
+}
+
+const char* rejectReasonName(RejectReason reason)
+{
+    switch (reason) {
+    case RejectReason::DUPLICATE_ORDER_ID: return "duplicate order ID";
+    case RejectReason::UNKNOWN_ORDER: return "unknown order";
+    case RejectReason::INVALID_ORDER: return "invalid order";
+    case RejectReason::WOULD_CROSS: return "post-only order would cross";
+    case RejectReason::NOT_FILLABLE: return "fill-or-kill order cannot be filled";
+    case RejectReason::UNKNOWN_SYMBOL: return "too many symbols";
+    case RejectReason::ORDER_IDS_EXHAUSTED: return "order IDs exhausted";
+    default: return "";
+    }
+}
 
 // -----------------------------------------------------------------------------
-// Helper function: convert the raw order book data to a single crow::json::wvalue.
+// JSON output. Everything sent to clients is written with JsonWriter into the
+// thread's reusable buffer, so building a message allocates nothing.
 // -----------------------------------------------------------------------------
-crow::json::wvalue convertOrderBookToJson(
-    const std::vector<std::shared_ptr<Order>>& buyOrders,
-    const std::vector<std::shared_ptr<Order>>& sellOrders)
+crow::response jsonResponse(const JsonWriter& json)
 {
-    crow::json::wvalue result;
-    crow::json::wvalue::list bids;
-    crow::json::wvalue::list asks;
+    crow::response response(json.str());
+    response.set_header("Content-Type", "application/json");
+    return response;
+}
+
+// Writes the raw order book data as "bids" and "asks" fields.
+void writeOrderBook(
+    JsonWriter& json,
+    const std::vector<Order>& buyOrders,
+    const std::vector<Order>& sellOrders)
+{
+    auto writeSide = [&json](const char* name, const std::vector<Order>& orders) {
+        json.key(name).beginArray();
+        for (const auto& order : orders)
+        {
+            json.beginObject()
+                .field("orderID", order.orderID)
+                .field("price", order.price)
+                .field("quantity", order.quantity)
+                .endObject();
+        }
+        json.endArray();
+    };
+    writeSide("bids", buyOrders);
+    writeSide("asks", sellOrders);
+}
 
-    // Convert buy orders to JSON array.
-    for (const auto& order : buyOrders)
+// Writes the trades of an order response as a "trades" field.
+void writeExecutedTrades(JsonWriter& json, const Trade* trades, std::size_t count)
+{
+    json.key("trades").beginArray();
+    for (std::size_t i = 0; i < count; i++)
     {
-        crow::json::wvalue orderJson;
-        orderJson["orderID"] = order->orderID;
-        orderJson["price"] = order->price;
-        orderJson["quantity"] = order->quantity;
-        bids.push_back(std::move(orderJson));
+        json.beginObject()
+            .field("buyOrderID", trades[i].buyOrderID)
+            .field("sellOrderID", trades[i].sellOrderID)
+            .field("quantity", trades[i].quantity)
+            .field("tradePrice", trades[i].tradePrice)
+            .endObject();
     }
+    json.endArray();
+}
+
+// -----------------------------------------------------------------------------
+// Depth cache: serialized GET /api/depth responses per symbol and level count.
+// An entry keeps the levels it was serialized from and is reused for newer
+// views whose best levels are the same, so polls of a book that only changes
+// deeper down serialize once; only the header with the sequence is rewritten.
+// Past kMaxDepthCacheEntries the least recently requested entry is dropped.
+// -----------------------------------------------------------------------------
+constexpr std::size_t kDefaultDepthLevels = 10;
+constexpr long kMaxDepthLevels = static_cast<long>(BookView::kDefaultLevels);   // All a view holds.
+constexpr std::size_t kMaxDepthCacheEntries = 1024;
+
+struct CachedDepth
+{
+    std::uint64_t sequence = 0;     // Of the view the levels came from.
+    std::vector<DepthLevel> bids;
+    std::vector<DepthLevel> asks;
+    std::string levels;             // The response after its "sequence" field.
+    std::uint64_t lastUsed = 0;     // depth_requests when last served.
+};
+
+std::mutex depth_mutex;
+std::map<std::pair<Symbol, std::size_t>, CachedDepth> depth_cache;
+std::uint64_t depth_requests = 0;
+
+// The "bids" and "asks" of a depth response, closing its object.
+void writeDepthLevels(JsonWriter& json, const BookDepth& depth)
+{
+    auto writeSide = [&json](const char* name, const std::vector<DepthLevel>& levels) {
+        json.key(name).beginArray();
+        for (const auto& level : levels)
+        {
+            json.beginObject()
+                .field("price", level.price)
+                .field("quantity", level.quantity)
+                .field("orders", level.orderCount)
+                .endObject();
+        }
+        json.endArray();
+    };
+    writeSide("bids", depth.bids);
+    writeSide("asks", depth.asks);
+    json.endObject();
+}
 
-    // Convert sell orders to JSON array.
-    for (const auto& order : sellOrders)
+// Whether `cached` holds exactly the best `count` entries of `levels`.
+bool sameLevels(const std::vector<DepthLevel>& cached, const std::vector<DepthLevel>& levels, std::size_t count)
+{
+    if (cached.size() != std::min(count, levels.size())) {
+        return false;
+    }
+    for (std::size_t i = 0; i < cached.size(); i++)
     {
-        crow::json::wvalue orderJson;
-        orderJson["orderID"] = order->orderID;
-        orderJson["price"] = order->price;
-        orderJson["quantity"] = order->quantity;
-        asks.push_back(std::move(orderJson));
+        if (cached[i].price != levels[i].price || cached[i].quantity != levels[i].quantity
+            || cached[i].orderCount != levels[i].orderCount) {
+            return false;
+        }
     }
+    return true;
+}
 
-    result["bids"] = std::move(bids);
-    result["asks"] = std::move(asks);
+// The GET /api/depth body for the best `count` levels of `view`.
+std::string depthResponse(const Symbol& symbol, std::size_t count, const BookView& view)
+{
+    auto key = std::make_pair(symbol, count);
+    JsonWriter json = JsonWriter::threadLocal();
+    json.beginObject()
+        .field("symbol", symbol.str())
+        .field("sequence", view.sequence);
+    std::size_t header = json.str().size();
+    {
+        std::lock_guard<std::mutex> lock(depth_mutex);
+        auto it = depth_cache.find(key);
+        if (it != depth_cache.end() && sameLevels(it->second.bids, view.levels.bids, count)
+            && sameLevels(it->second.asks, view.levels.asks, count)) {
+            it->second.lastUsed = ++depth_requests;
+            return json.str() + it->second.levels;
+        }
+    }
+
+    BookDepth depth = view.depth(count);
+    writeDepthLevels(json, depth);
+    std::lock_guard<std::mutex> lock(depth_mutex);
+    auto it = depth_cache.find(key);
+    if (it == depth_cache.end() && depth_cache.size() >= kMaxDepthCacheEntries) {
+        auto idle = std::min_element(depth_cache.begin(), depth_cache.end(), [](const auto& a, const auto& b) {
+            return a.second.lastUsed < b.second.lastUsed;
+            });
+        depth_cache.erase(idle);
+    }
+    CachedDepth& cached = it != depth_cache.end() ? it->second : depth_cache[key];
+    cached.lastUsed = ++depth_requests;
+    if (cached.levels.empty() || view.sequence >= cached.sequence) {
+        cached.sequence = view.sequence;
+        cached.bids = std::move(depth.bids);
+        cached.asks = std::move(depth.asks);
+        cached.levels = json.str().substr(header);
+    }
+    return json.str();
+}
+
+// -----------------------------------------------------------------------------
+// Trade tape readers. GET /api/trades and the /trades channel read the shard's
+// TradeTape directly, without a lock or a trip through the shard; the tape
+// holds every symbol of the shard, so other symbols' trades are skipped.
+// -----------------------------------------------------------------------------
+constexpr std::size_t kDefaultTradeLimit = 100;
+constexpr int kMaxTradeLimit = 1000;
+constexpr std::size_t kTapeChunk = 256;
+
+// Appends up to `limit` of `symbol`'s trades from tape sequence `since` on to
+// `out`; returns the sequence the next read should start from.
+std::uint64_t readTrades(const Symbol& symbol, std::uint64_t since, std::size_t limit, std::vector<TapeTrade>& out)
+{
+    const TradeTape& tape = engine.tape(symbol);
+    thread_local std::vector<TapeTrade> chunk(kTapeChunk);
+    std::uint64_t next = since;
+    while (out.size() < limit) {
+        std::size_t count = tape.read(next, chunk.data(), chunk.size());
+        if (count == 0) {
+            break;
+        }
+        for (std::size_t i = 0; i < count && out.size() < limit; i++)
+        {
+            next = chunk[i].sequence + 1;
+            if (chunk[i].symbol == symbol) {
+                out.push_back(chunk[i]);
+            }
+        }
+    }
+    if (!out.empty()) {
+        // Like acknowledgements, trades are only shown once durable.
+        engine.waitDurable(symbol, out.back().commandSequence);
+    }
+    return next;
+}
+
+// Writes tape trades as a "trades" field.
+void writeTapeTrades(JsonWriter& json, const std::vector<TapeTrade>& trades)
+{
+    json.key("trades").beginArray();
+    for (const TapeTrade& entry : trades)
+    {
+        json.beginObject()
+            .field("sequence", entry.sequence)
+            .field("buyOrderID", entry.trade.buyOrderID)
+            .field("sellOrderID", entry.trade.sellOrderID)
+            .field("quantity", entry.trade.quantity)
+            .field("tradePrice", entry.trade.tradePrice)
+            .field("time", entry.timestamp)
+            .endObject();
+    }
+    json.endArray();
+}
+
+// -----------------------------------------------------------------------------
+// Bars: served from the BarAggregator and pushed to /bars subscribers from its
+// thread after each pass. Intervals are given in milliseconds on the wire.
+// -----------------------------------------------------------------------------
+constexpr std::size_t kDefaultBarLimit = 100;
+constexpr int kMaxBarLimit = 1000;
+
+// Writes bars as a "bars" field.
+void writeBars(JsonWriter& json, const std::vector<Bar>& bars)
+{
+    json.key("bars").beginArray();
+    for (const Bar& bar : bars)
+    {
+        json.beginObject()
+            .field("start", bar.start)
+            .field("open", bar.open)
+            .field("high", bar.high)
+            .field("low", bar.low)
+            .field("close", bar.close)
+            .field("volume", bar.volume)
+            .field("vwap", bar.vwap())
+            .field("trades", bar.trades)
+            .endObject();
+    }
+    json.endArray();
+}
+
+// Reads ?interval=<ms>; defaults to the shortest configured interval.
+std::int64_t barIntervalFromQuery(const crow::request& req)
+{
+    if (const char* param = req.url_params.get("interval")) {
+        return static_cast<std::int64_t>(std::atoll(param)) * 1000000;
+    }
+    const std::vector<std::int64_t>& intervals = bar_aggregator.intervals();
+    return intervals.empty() ? 0 : *std::min_element(intervals.begin(), intervals.end());
+}
+
+void sendBarUpdates(const std::vector<BarUpdate>& updates)
+{
+    std::lock_guard<std::mutex> lock(bar_connection_mutex);
+    if (bar_connections.empty()) {
+        return;
+    }
+    for (const BarUpdate& update : updates)
+    {
+        if (update.bars.empty()) {
+            continue;
+        }
+        std::string text;
+        for (auto& [conn, subscriber] : bar_connections)
+        {
+            if (subscriber.symbol != update.symbol || subscriber.interval != update.interval) {
+                continue;
+            }
+            if (text.empty()) {
+                StageTimer serialize(MetricStage::SERIALIZE);
+                JsonWriter json = JsonWriter::threadLocal();
+                json.beginObject()
+                    .field("type", "bars")
+                    .field("symbol", update.symbol.str())
+                    .field("interval", update.interval / 1000000);
+                writeBars(json, update.bars);
+                json.endObject();
+                text = json.str();
+            }
+            StageTimer fanout(MetricStage::FANOUT);
+            conn->send_text(text);
+        }
+    }
+}
+
+// Upper bound on the entries of one POST /api/orders/batch; a batch holds its
+// shard for its whole length.
+constexpr std::size_t kMaxBatchSize = 1000;
+
+// -----------------------------------------------------------------------------
+// Sequencer round trip: the handler thread only queues the command and waits
+// for the shard to apply it. Nothing is acknowledged before it is journaled.
+// -----------------------------------------------------------------------------
+CommandResult executeCommand(const EngineCommand& command)
+{
+    CommandResult result = engine.submit(command).get();
+    engine.waitDurable(command.symbol, result.sequence);
     return result;
 }
 
 // -----------------------------------------------------------------------------
-// Broadcast entire order book to all WebSocket clients.
+// Binary order entry (binary WebSocket frames and the TCP gateway). Commands
+// are decoded in place into EngineCommands; all complete messages in the
+// buffer are queued before the first result is awaited, so a burst costs one
+// round trip to each shard rather than one per order. Replies come back in
+// message order. Returns the number of bytes consumed. New orders of a
+// WebSocket session are stamped with its owner, and the symbols it sent
+// orders for are added to `symbols`.
 // -----------------------------------------------------------------------------
-void broadcastOrderBookUpdate()
+std::size_t processBinaryOrders(const char* data, std::size_t size, std::string& replies, bool& fatal,
+    OwnerId owner = kNoOwner, std::vector<Symbol>* symbols = nullptr)
 {
-    // First, gather the current state under a lock.
-    std::lock_guard<std::mutex> lock(orderBookMutex);
-    auto [buyOrders, sellOrders] = globalOrderBook.getRawOrderBookData();
+    std::vector<EngineCommand> commands;
+    std::vector<std::future<CommandResult>> results;
+    std::size_t offset = 0;
+    for (;;)
+    {
+        EngineCommand command;
+        std::size_t consumed = 0;
+        auto parseStart = Metrics::Clock::now();
+        BinaryDecodeStatus status = decodeBinaryCommand(data + offset, size - offset, command, consumed);
+        Metrics::record(MetricStage::PARSE, parseStart, Metrics::Clock::now());
+        if (status == BinaryDecodeStatus::INCOMPLETE) {
+            break;
+        }
+        if (status == BinaryDecodeStatus::MALFORMED) {
+            fatal = true;
+            break;
+        }
+        if (owner != kNoOwner) {
+            command.order.owner = owner;
+            for (BookCommand& sub : command.batch) {
+                sub.order.owner = owner;
+            }
+            if (std::find(symbols->begin(), symbols->end(), command.symbol) == symbols->end()) {
+                symbols->push_back(command.symbol);
+            }
+        }
+        results.push_back(engine.submit(command));
+        commands.push_back(command);
+        offset += consumed;
+    }
+    for (std::size_t i = 0; i < commands.size(); i++)
+    {
+        CommandResult result = results[i].get();
+        engine.waitDurable(commands[i].symbol, result.sequence);
+        StageTimer serialize(MetricStage::SERIALIZE);
+        encodeBinaryResult(commands[i], result, replies);
+    }
+    if (fatal) {
+        encodeBinaryReject(0, REJECT_MALFORMED, replies);
+    }
+    return offset;
+}
+
+// -----------------------------------------------------------------------------
+// Market data feed. The shards publish the deltas of every book update, and
+// new subscribers' snapshots, onto one queue in sequence order; the publisher
+// thread serializes each event once and queues it on the ClientFeed of every
+// client following the symbol, which paces it to the client's rate (and
+// window, if it acknowledges) and conflates it into per-level "levels"
+// messages when the client falls behind. A subscriber's snapshot is taken
+// from the book's published view when the publisher thread reaches it; the
+// view may trail the deltas already sent by up to one shard drain, so the
+// deltas since the view are replayed from a short per-book history, and
+// older ones are skipped. Every message carries the book's update sequence:
+// a client that sees it jump by more than one has missed a delta and
+// resubscribes.
+// -----------------------------------------------------------------------------
+struct FeedEvent
+{
+    Symbol symbol;
+    std::uint64_t sequence = 0;         // Shard sequence, for waitDurable.
+    std::uint64_t bookSequence = 0;
+    std::vector<BookDelta> deltas;
+    std::uint64_t subscriber = 0;       // Non-zero: snapshot for this subscription.
+    std::vector<Trade> trades;          // Only kept for the market data ring.
+};
 
-    // Build a single JSON object for the update.
-    crow::json::wvalue updateMsg;
-    updateMsg["status"] = "update";
-    updateMsg["data"] = convertOrderBookToJson(buyOrders, sellOrders);
+std::mutex feed_mutex;
+std::condition_variable feed_ready;
+std::deque<FeedEvent> feed_queue;
+bool feed_acked = false;    // A client acknowledged data: held feeds may send again.
 
-    // Serialize once.
-    std::string jsonStr = updateMsg.dump();
+// The latest updates of each book, oldest first, for replay after a snapshot
+// (publisher thread only). A view trails the deltas by at most one drain.
+constexpr std::size_t kRecentUpdates = MatchingEngine::kMaxBatch;
+std::unordered_map<Symbol, std::deque<FeedUpdatePtr>, SymbolHash> recent_updates;
 
-    // Now send to all active connections.
-    std::lock_guard<std::mutex> connLock(connection_mutex);
-    for (auto conn : active_connections)
+// Written by the publisher thread only, once durable, like the WebSocket feed.
+MarketDataRing market_data_ring;
+
+MarketDataType ringRecordType(BookDelta::Type type)
+{
+    switch (type) {
+    case BookDelta::Type::ORDER_ADDED: return MarketDataType::ORDER_ADDED;
+    case BookDelta::Type::ORDER_REMOVED: return MarketDataType::ORDER_REMOVED;
+    case BookDelta::Type::ORDER_EXECUTED: return MarketDataType::ORDER_EXECUTED;
+    case BookDelta::Type::ORDER_MODIFIED: return MarketDataType::ORDER_MODIFIED;
+    default: return MarketDataType::LEVEL;
+    }
+}
+
+void publishToRing(const FeedEvent& event)
+{
+    MarketDataRecord record;
+    record.bookSequence = event.bookSequence;
+    record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::memcpy(record.symbol, event.symbol.c_str(), sizeof(record.symbol));
+    for (const Trade& trade : event.trades)
     {
-        conn->send_text(jsonStr);
+        record.type = MarketDataType::TRADE;
+        record.side = 0;
+        record.price = trade.tradePrice;
+        record.quantity = trade.quantity;
+        record.orderId = trade.buyOrderID;
+        record.other = trade.sellOrderID;
+        market_data_ring.publish(record);
+    }
+    for (const BookDelta& delta : event.deltas)
+    {
+        record.type = ringRecordType(delta.type);
+        record.side = delta.side == OrderType::BUY ? 0 : 1;
+        record.price = delta.price;
+        record.quantity = delta.quantity;
+        record.orderId = delta.orderId;
+        record.other = delta.type == BookDelta::Type::LEVEL ? static_cast<std::int32_t>(delta.orderCount) : delta.remaining;
+        market_data_ring.publish(record);
+    }
+}
+
+void publish(FeedEvent&& event)
+{
+    {
+        std::lock_guard<std::mutex> lock(feed_mutex);
+        feed_queue.push_back(std::move(event));
+    }
+    feed_ready.notify_one();
+}
+
+const char* deltaTypeName(BookDelta::Type type)
+{
+    switch (type) {
+    case BookDelta::Type::ORDER_ADDED: return "add";
+    case BookDelta::Type::ORDER_REMOVED: return "remove";
+    case BookDelta::Type::ORDER_EXECUTED: return "execute";
+    case BookDelta::Type::ORDER_MODIFIED: return "modify";
+    default: return "level";
+    }
+}
+
+std::string deltaMessage(const FeedEvent& event)
+{
+    JsonWriter json = JsonWriter::threadLocal();
+    json.beginObject()
+        .field("type", "delta")
+        .field("symbol", event.symbol.str())
+        .field("sequence", event.bookSequence)
+        .key("deltas").beginArray();
+    for (const BookDelta& delta : event.deltas)
+    {
+        json.beginObject()
+            .field("type", deltaTypeName(delta.type))
+            .field("side", delta.side == OrderType::BUY ? "buy" : "sell")
+            .field("price", delta.price)
+            .field("quantity", delta.quantity);
+        if (delta.type == BookDelta::Type::LEVEL) {
+            json.field("orders", delta.orderCount);
+        }
+        else {
+            json.field("orderID", delta.orderId);
+        }
+        if (delta.type == BookDelta::Type::ORDER_EXECUTED) {
+            json.field("remaining", delta.remaining);
+        }
+        json.endObject();
+    }
+    json.endArray().endObject();
+    return json.str();
+}
+
+std::string snapshotMessage(const Symbol& symbol, const BookView& view)
+{
+    JsonWriter json = JsonWriter::threadLocal();
+    json.beginObject()
+        .field("type", "snapshot")
+        .field("symbol", symbol.str())
+        .field("sequence", view.sequence);
+    writeOrderBook(json, view.bids, view.asks);
+    json.endObject();
+    return json.str();
+}
+
+std::string levelsMessage(const Symbol& symbol, std::uint64_t sequence, const std::vector<BookDelta>& levels)
+{
+    JsonWriter json = JsonWriter::threadLocal();
+    json.beginObject()
+        .field("type", "levels")
+        .field("symbol", symbol.str())
+        .field("sequence", sequence)
+        .key("levels").beginArray();
+    for (const BookDelta& level : levels)
+    {
+        json.beginObject()
+            .field("side", level.side == OrderType::BUY ? "buy" : "sell")
+            .field("price", level.price)
+            .field("quantity", level.quantity)
+            .field("orders", level.orderCount)
+            .endObject();
+    }
+    json.endArray().endObject();
+    return json.str();
+}
+
+// Hand one event to the subscribers' feeds. Snapshots go out at once, since
+// the subscriber has nothing queued before them, followed by the deltas the
+// view did not include yet.
+void dispatchFeedEvent(const FeedEvent& event)
+{
+    if (event.subscriber != 0) {
+        std::uint64_t sequence = 0;
+        std::string text = engine.readView(event.symbol, [&event, &sequence](const BookView& view) {
+            StageTimer serialize(MetricStage::SERIALIZE);
+            sequence = view.sequence;
+            return snapshotMessage(event.symbol, view);
+            });
+        std::lock_guard<std::mutex> lock(connection_mutex);
+        for (auto& [conn, subscriber] : active_connections)
+        {
+            if (subscriber.id == event.subscriber) {
+                subscriber.feed.reset();
+                conn->send_text(text);
+                subscriber.feed.sent(sequence, text.size());
+                subscriber.live = true;
+                subscriber.snapshotSequence = sequence;
+                for (const FeedUpdatePtr& update : recent_updates[event.symbol])
+                {
+                    if (update->bookSequence > sequence) {
+                        subscriber.feed.offer(update);
+                    }
+                }
+                break;
+            }
+        }
+        return;
+    }
+
+    // Deltas are only published once durable, like acknowledgements.
+    engine.waitDurable(event.symbol, event.sequence);
+    if (market_data_ring.isOpen()) {
+        publishToRing(event);
+    }
+    auto update = std::make_shared<FeedUpdate>();
+    update->bookSequence = event.bookSequence;
+    update->deltas = event.deltas;
+    {
+        StageTimer serialize(MetricStage::SERIALIZE);
+        update->message = deltaMessage(event);
+    }
+    std::deque<FeedUpdatePtr>& recent = recent_updates[event.symbol];
+    recent.push_back(update);
+    if (recent.size() > kRecentUpdates) {
+        recent.pop_front();
+    }
+
+    StageTimer fanout(MetricStage::FANOUT);
+    std::lock_guard<std::mutex> lock(connection_mutex);
+    for (auto& [conn, subscriber] : active_connections)
+    {
+        if (!subscriber.live || subscriber.symbol != event.symbol || update->bookSequence <= subscriber.snapshotSequence) {
+            continue;
+        }
+        if (!subscriber.feed.offer(update)) {
+            CROW_LOG_WARNING << "Dropping WebSocket client " << subscriber.id << ": too far behind";
+            subscriber.live = false;
+            conn->close("too slow");
+        }
+    }
+}
+
+// A client with a window has processed everything up to `sequence`; wake the
+// publisher if that lets its feed send again.
+void acknowledgeFeed(crow::websocket::connection& conn, std::uint64_t sequence)
+{
+    bool reopened = false;
+    {
+        std::lock_guard<std::mutex> lock(connection_mutex);
+        auto it = active_connections.find(&conn);
+        if (it != active_connections.end()) {
+            ClientFeed& feed = it->second.feed;
+            bool held = feed.held();
+            feed.acknowledge(sequence);
+            reopened = held && !feed.held();
+        }
+    }
+    if (!reopened) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(feed_mutex);
+        feed_acked = true;
+    }
+    feed_ready.notify_one();
+}
+
+// Send whatever each subscriber's pacing allows now; returns when the next
+// rate-limited subscriber becomes due.
+ClientFeed::Clock::time_point flushSubscribers()
+{
+    auto now = ClientFeed::Clock::now();
+    auto nextDue = ClientFeed::Clock::time_point::max();
+    std::vector<std::string> out;
+    StageTimer fanout(MetricStage::FANOUT);
+    std::lock_guard<std::mutex> lock(connection_mutex);
+    for (auto& [conn, subscriber] : active_connections)
+    {
+        if (!subscriber.live) {
+            continue;
+        }
+        const Symbol& symbol = subscriber.symbol;
+        subscriber.feed.drain(now, [&symbol](std::uint64_t sequence, const std::vector<BookDelta>& levels) {
+            return levelsMessage(symbol, sequence, levels);
+            }, out);
+        for (const std::string& text : out)
+        {
+            conn->send_text(text);
+        }
+        out.clear();
+        if (subscriber.feed.pending()) {
+            nextDue = std::min(nextDue, subscriber.feed.nextDue());
+        }
+    }
+    return nextDue;
+}
+
+// Send each /trades subscriber the trades printed since its last message.
+void flushTradeSubscribers()
+{
+    std::vector<TapeTrade> trades;
+    std::lock_guard<std::mutex> lock(trade_connection_mutex);
+    for (auto& [conn, subscriber] : trade_connections)
+    {
+        trades.clear();
+        subscriber.next = readTrades(subscriber.symbol, subscriber.next, kMaxTradeLimit, trades);
+        if (trades.empty()) {
+            continue;
+        }
+        std::string text;
+        {
+            StageTimer serialize(MetricStage::SERIALIZE);
+            JsonWriter json = JsonWriter::threadLocal();
+            json.beginObject()
+                .field("type", "trades")
+                .field("symbol", subscriber.symbol.str());
+            writeTapeTrades(json, trades);
+            json.field("next", subscriber.next).endObject();
+            text = json.str();
+        }
+        StageTimer fanout(MetricStage::FANOUT);
+        conn->send_text(text);
+    }
+}
+
+// Publisher thread: the only place market data is serialized and sent, so
+// neither the matching threads nor the request threads ever wait on a client.
+void runFeed()
+{
+    std::deque<FeedEvent> batch;
+    auto nextDue = ClientFeed::Clock::time_point::max();
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(feed_mutex);
+            auto ready = [] { return !feed_queue.empty() || feed_acked || !running; };
+            if (nextDue == ClientFeed::Clock::time_point::max()) {
+                feed_ready.wait(lock, ready);
+            }
+            else {
+                feed_ready.wait_until(lock, nextDue, ready);
+            }
+            if (feed_queue.empty() && !running) {
+                return;
+            }
+            batch.swap(feed_queue);
+            feed_acked = false;
+        }
+        for (const FeedEvent& event : batch)
+        {
+            dispatchFeedEvent(event);
+        }
+        batch.clear();
+        nextDue = flushSubscribers();
+        flushTradeSubscribers();
     }
 }
 
@@ -87,109 +978,481 @@ int main()
     auto& cors = app.get_middleware<crow::CORSHandler>();
     cors.global()
         .origin("*")   // Allow all origins.
-        .methods("GET"_method, "POST"_method, "DELETE"_method, "OPTIONS"_method)
+        .methods("GET"_method, "POST"_method, "PUT"_method, "DELETE"_method, "OPTIONS"_method)
         .allow_credentials();
 
-    // WebSocket for real-time order book.
+    // WebSocket for real-time order book (ws://host/orderbook?symbol=XYZ).
     CROW_WEBSOCKET_ROUTE(app, "/orderbook")
+        .onaccept([&](const crow::request& req, void** userdata) {
+            Symbol symbol;
+            if (!symbolFromQuery(req, symbol)) {
+                return false;
+            }
+            auto* subscription = new Subscription{ symbol, next_subscription_id++ };
+            if (const char* interval = req.url_params.get("interval")) {
+                subscription->interval = std::chrono::milliseconds(std::clamp(std::atoi(interval), 0, 60000));
+            }
+            if (const char* window = req.url_params.get("window")) {
+                subscription->window = static_cast<std::size_t>(std::clamp(std::atol(window), 0L, kMaxFeedWindow));
+            }
+            subscription->owner = next_session_owner++;
+            subscription->cancelOnDisconnect = cancel_on_disconnect;
+            if (const char* cancel = req.url_params.get("cancelOnDisconnect")) {
+                subscription->cancelOnDisconnect = std::atoi(cancel) != 0;
+            }
+            *userdata = subscription;
+            return true;
+            })
         .onopen([&](crow::websocket::connection& conn) {
+            Subscription subscription;
+            if (auto* accepted = static_cast<Subscription*>(conn.userdata())) {
+                subscription = *accepted;
+            }
             {
                 std::lock_guard<std::mutex> lock(connection_mutex);
-                active_connections.insert(&conn);
+                ClientFeed::Limits limits;
+                limits.minInterval = subscription.interval;
+                limits.maxUnackedBytes = subscription.window;
+                active_connections[&conn] = Subscriber{ subscription.symbol, subscription.id, false, 0, ClientFeed(limits) };
                 CROW_LOG_INFO << "New WebSocket connection. Total: " << active_connections.size();
             }
 
-            // Send an initial snapshot to the newly connected client.
-            std::lock_guard<std::mutex> lock(orderBookMutex);
-            auto [buyOrders, sellOrders] = globalOrderBook.getRawOrderBookData();
+            // Queue the initial snapshot; the publisher thread takes it from the book's view.
+            FeedEvent event;
+            event.symbol = subscription.symbol;
+            event.subscriber = subscription.id;
+            publish(std::move(event));
+            })
+        .onclose([&](crow::websocket::connection& conn, const std::string& reason) {
+        {
+            std::lock_guard<std::mutex> lock(connection_mutex);
+            active_connections.erase(&conn);
+            CROW_LOG_INFO << "WebSocket disconnected: " << reason << ". Total now: " << active_connections.size();
+        }
+        auto* subscription = static_cast<Subscription*>(conn.userdata());
+        if (subscription != nullptr && subscription->cancelOnDisconnect) {
+            // One mass cancel per book the session traded on; not awaited.
+            for (const Symbol& symbol : subscription->orderSymbols) {
+                EngineCommand command;
+                command.type = EngineCommand::Type::MASS_CANCEL;
+                command.symbol = symbol;
+                command.massCancel.owner = subscription->owner;
+                engine.submit(command, [](const OrderBook&, CommandResult&) {});
+            }
+        }
+        delete subscription;
+        conn.userdata(nullptr);
+            })
+        .onmessage([&](crow::websocket::connection& conn, const std::string& data, bool is_binary) {
+        if (!is_binary) {
+            // {"type": "ack", "sequence": N} from a client with a window.
+            auto message = crow::json::load(data);
+            if (message && message.has("type") && message["type"].t() == crow::json::type::String
+                && std::string(message["type"].s()) == "ack"
+                && message.has("sequence") && message["sequence"].t() == crow::json::type::Number) {
+                acknowledgeFeed(conn, static_cast<std::uint64_t>(message["sequence"].i()));
+            }
+            else {
+                CROW_LOG_INFO << "Received WebSocket message: " << data;
+            }
+            return;
+        }
+        // Binary frames carry whole order-entry messages.
+        std::string replies;
+        bool fatal = false;
+        auto* subscription = static_cast<Subscription*>(conn.userdata());
+        std::size_t used = subscription != nullptr
+            ? processBinaryOrders(data.data(), data.size(), replies, fatal, subscription->owner, &subscription->orderSymbols)
+            : processBinaryOrders(data.data(), data.size(), replies, fatal);
+        if (used != data.size() && !fatal) {
+            encodeBinaryReject(0, REJECT_MALFORMED, replies);  // Frame ends mid-message.
+        }
+        conn.send_binary(replies);
+            });
+
+    // WebSocket of executions (ws://host/trades?symbol=XYZ[&since=<seq>]):
+    // "trades" messages from tape sequence `since`, or from now on.
+    CROW_WEBSOCKET_ROUTE(app, "/trades")
+        .onaccept([&](const crow::request& req, void** userdata) {
+            Symbol symbol;
+            if (!symbolFromQuery(req, symbol)) {
+                return false;
+            }
+            const char* since = req.url_params.get("since");
+            auto* subscriber = new TradeSubscriber{ symbol,
+                since ? std::strtoull(since, nullptr, 10) : engine.tape(symbol).head() };
+            *userdata = subscriber;
+            return true;
+            })
+        .onopen([&](crow::websocket::connection& conn) {
+            TradeSubscriber subscriber;
+            if (auto* accepted = static_cast<TradeSubscriber*>(conn.userdata())) {
+                subscriber = *accepted;
+            }
+            std::lock_guard<std::mutex> lock(trade_connection_mutex);
+            trade_connections[&conn] = subscriber;
+            })
+        .onclose([&](crow::websocket::connection& conn, const std::string&) {
+        {
+            std::lock_guard<std::mutex> lock(trade_connection_mutex);
+            trade_connections.erase(&conn);
+        }
+        delete static_cast<TradeSubscriber*>(conn.userdata());
+        conn.userdata(nullptr);
+            });
 
-            // Build the snapshot.
-            crow::json::wvalue snapshot;
-            snapshot["type"] = "snapshot";
+    // GET /api/trades?symbol=XYZ&since=<seq>&limit=<n> -> Recent executions from the tape.
+    CROW_ROUTE(app, "/api/trades")
+        .methods("GET"_method)
+        ([&](const crow::request& req) {
+        Symbol symbol;
+        if (!symbolFromQuery(req, symbol)) {
+            return crow::response(400, "Symbol too long");
+        }
+        std::size_t limit = kDefaultTradeLimit;
+        if (const char* param = req.url_params.get("limit")) {
+            limit = static_cast<std::size_t>(std::clamp(std::atoi(param), 1, kMaxTradeLimit));
+        }
+        // Without a cursor, start `limit` trades back on the shard's tape.
+        std::uint64_t head = engine.tape(symbol).head();
+        std::uint64_t since = head > limit ? head - limit : 0;
+        if (const char* param = req.url_params.get("since")) {
+            since = std::strtoull(param, nullptr, 10);
+        }
+        std::vector<TapeTrade> trades;
+        std::uint64_t next = readTrades(symbol, since, limit, trades);
 
-            // Convert the entire order book to JSON and store in the snapshot.
-            crow::json::wvalue obJson = convertOrderBookToJson(buyOrders, sellOrders);
-            snapshot["bids"] = std::move(obJson["bids"]);
-            snapshot["asks"] = std::move(obJson["asks"]);
+        StageTimer serialize(MetricStage::SERIALIZE);
+        JsonWriter json = JsonWriter::threadLocal();
+        json.beginObject().field("symbol", symbol.str());
+        writeTapeTrades(json, trades);
+        json.field("next", next).endObject();
+        return jsonResponse(json);
+            });
 
-            // Send the snapshot.
-            conn.send_text(snapshot.dump());
+    // WebSocket of bars (ws://host/bars?symbol=XYZ&interval=<ms>): a "bars"
+    // message with the bars changed by each aggregation pass.
+    CROW_WEBSOCKET_ROUTE(app, "/bars")
+        .onaccept([&](const crow::request& req, void** userdata) {
+            Symbol symbol;
+            if (!symbolFromQuery(req, symbol)) {
+                return false;
+            }
+            std::int64_t interval = barIntervalFromQuery(req);
+            const std::vector<std::int64_t>& intervals = bar_aggregator.intervals();
+            if (std::find(intervals.begin(), intervals.end(), interval) == intervals.end()) {
+                return false;
+            }
+            *userdata = new BarSubscriber{ symbol, interval };
+            return true;
             })
-        .onclose([&](crow::websocket::connection& conn, const std::string& reason) {
-        std::lock_guard<std::mutex> lock(connection_mutex);
-        active_connections.erase(&conn);
-        CROW_LOG_INFO << "WebSocket disconnected: " << reason << ". Total now: " << active_connections.size();
+        .onopen([&](crow::websocket::connection& conn) {
+            BarSubscriber subscriber;
+            if (auto* accepted = static_cast<BarSubscriber*>(conn.userdata())) {
+                subscriber = *accepted;
+            }
+            std::lock_guard<std::mutex> lock(bar_connection_mutex);
+            bar_connections[&conn] = subscriber;
             })
-        .onmessage([&](crow::websocket::connection& /*conn*/, const std::string& data, bool is_binary) {
-        if (!is_binary) {
-            CROW_LOG_INFO << "Received WebSocket message: " << data;
+        .onclose([&](crow::websocket::connection& conn, const std::string&) {
+        {
+            std::lock_guard<std::mutex> lock(bar_connection_mutex);
+            bar_connections.erase(&conn);
         }
+        delete static_cast<BarSubscriber*>(conn.userdata());
+        conn.userdata(nullptr);
+            });
+
+    // GET /api/bars?symbol=XYZ&interval=<ms>&limit=<n> -> The latest bars, oldest first.
+    CROW_ROUTE(app, "/api/bars")
+        .methods("GET"_method)
+        ([&](const crow::request& req) {
+        Symbol symbol;
+        if (!symbolFromQuery(req, symbol)) {
+            return crow::response(400, "Symbol too long");
+        }
+        std::size_t limit = kDefaultBarLimit;
+        if (const char* param = req.url_params.get("limit")) {
+            limit = static_cast<std::size_t>(std::clamp(std::atoi(param), 1, kMaxBarLimit));
+        }
+        std::int64_t interval = barIntervalFromQuery(req);
+        std::vector<Bar> bars;
+        if (!bar_aggregator.bars(symbol, interval, limit, bars)) {
+            return crow::response(400, "Unknown bar interval");
+        }
+
+        StageTimer serialize(MetricStage::SERIALIZE);
+        JsonWriter json = JsonWriter::threadLocal();
+        json.beginObject()
+            .field("symbol", symbol.str())
+            .field("interval", interval / 1000000);
+        writeBars(json, bars);
+        json.endObject();
+        return jsonResponse(json);
             });
 
     // POST /api/orders -> Add a New Order.
     CROW_ROUTE(app, "/api/orders")
         .methods("POST"_method)
         ([&](const crow::request& req) {
+        auto parseStart = Metrics::Clock::now();
         auto body = crow::json::load(req.body);
         if (!body) {
             return crow::response(400, "Invalid JSON");
         }
 
-        int orderID = body["orderID"].i();
-        double price = body["price"].d();
+        int orderID = body.has("orderID") ? static_cast<int>(body["orderID"].i()) : 0;
+        double price = body.has("price") ? body["price"].d() : 0.0;  // Market orders may omit it.
         int quantity = body["quantity"].i();
         std::string type = body["orderType"].s();
+        std::string symbol = body.has("symbol") ? std::string(body["symbol"].s()) : std::string();
+        if (symbol.size() > Symbol::kMaxLength) {
+            return crow::response(400, "Symbol too long");
+        }
 
         OrderType orderType = (type == "buy") ? OrderType::BUY : OrderType::SELL;
-        auto order = std::make_shared<Order>(orderID, price, quantity, orderType);
 
-        std::vector<Trade> trades;
-        {
-            std::lock_guard<std::mutex> lock(orderBookMutex);
-            trades = globalOrderBook.addOrder(order);
+        // Queue the order on the shard owning its symbol and wait for the sequencer.
+        EngineCommand command;
+        command.type = EngineCommand::Type::ADD;
+        command.symbol = Symbol(symbol);
+        command.order = Order(orderID, price, quantity, orderType, command.symbol);
+        if (!readExecutionFields(body, command.order)) {
+            return crow::response(400, "Unknown timeInForce");
         }
+        if (!readOwner(body, command.order)) {
+            return crow::response(400, "Invalid owner");
+        }
+        Metrics::record(MetricStage::PARSE, parseStart, Metrics::Clock::now());
+        CommandResult outcome = executeCommand(command);
+        const std::vector<Trade>& trades = outcome.trades;
 
-        // Broadcast the updated order book.
-        broadcastOrderBookUpdate();
+        // Timed until the response (and its body) has been built.
+        StageTimer serialize(MetricStage::SERIALIZE);
 
         // Return executed trades as JSON.
-        crow::json::wvalue result;
-        crow::json::wvalue::list trades_list;
+        JsonWriter json = JsonWriter::threadLocal();
+        json.beginObject();
+        writeExecutedTrades(json, trades.data(), trades.size());
+        json.field("sequence", outcome.sequence)
+            .field("accepted", outcome.accepted)
+            .field("orderID", outcome.accepted ? outcome.orderId : orderID);
+        if (!outcome.accepted) {
+            json.field("reason", rejectReasonName(outcome.reject));
+        }
+        json.endObject();
+        return jsonResponse(json);
+            });
+
+    // POST /api/orders/batch -> Apply several adds, cancels and modifies on one book as a unit.
+    CROW_ROUTE(app, "/api/orders/batch")
+        .methods("POST"_method)
+        ([&](const crow::request& req) {
+        auto parseStart = Metrics::Clock::now();
+        auto body = crow::json::load(req.body);
+        if (!body || !body.has("orders") || body["orders"].t() != crow::json::type::List) {
+            return crow::response(400, "Invalid JSON");
+        }
+        std::string symbol = body.has("symbol") ? std::string(body["symbol"].s()) : std::string();
+        if (symbol.size() > Symbol::kMaxLength) {
+            return crow::response(400, "Symbol too long");
+        }
+        if (body["orders"].size() > kMaxBatchSize) {
+            return crow::response(400, "Batch too large");
+        }
+
+        EngineCommand command;
+        command.type = EngineCommand::Type::BATCH;
+        command.symbol = Symbol(symbol);
+        command.batch.reserve(body["orders"].size());
+        for (const auto& entry : body["orders"]) {
+            BookCommand sub;
+            std::string action = entry.has("action") ? std::string(entry["action"].s()) : std::string("add");
+            if (action == "cancel") {
+                sub.type = BookCommand::Type::CANCEL;
+                sub.orderId = entry["orderID"].i();
+            }
+            else if (action == "modify") {
+                sub.type = BookCommand::Type::MODIFY;
+                sub.orderId = entry["orderID"].i();
+                sub.order.price = entry["price"].d();
+                sub.order.quantity = entry["quantity"].i();
+            }
+            else {
+                OrderType orderType = (std::string(entry["orderType"].s()) == "buy") ? OrderType::BUY : OrderType::SELL;
+                sub.type = BookCommand::Type::ADD;
+                double price = entry.has("price") ? entry["price"].d() : 0.0;
+                int orderID = entry.has("orderID") ? static_cast<int>(entry["orderID"].i()) : 0;
+                sub.order = Order(orderID, price, entry["quantity"].i(), orderType, command.symbol);
+                sub.orderId = sub.order.GetOrderId();
+                if (!readExecutionFields(entry, sub.order)) {
+                    return crow::response(400, "Unknown timeInForce");
+                }
+                if (!readOwner(entry, sub.order)) {
+                    return crow::response(400, "Invalid owner");
+                }
+            }
+            command.batch.push_back(std::move(sub));
+        }
+        Metrics::record(MetricStage::PARSE, parseStart, Metrics::Clock::now());
+        CommandResult outcome = executeCommand(command);
+        StageTimer serialize(MetricStage::SERIALIZE);
+
+        // One result per entry, in submission order, with the trades it caused.
+        JsonWriter json = JsonWriter::threadLocal();
+        json.beginObject().key("results").beginArray();
+        for (std::size_t i = 0; i < outcome.batch.size(); i++) {
+            const BookCommandResult& entry = outcome.batch[i];
+            bool assigned = entry.accepted && command.batch[i].type == BookCommand::Type::ADD;
+            json.beginObject()
+                .field("orderID", assigned ? entry.orderId : command.batch[i].orderId)
+                .field("accepted", entry.accepted)
+                .field("sequence", entry.sequence);
+            if (!entry.accepted) {
+                json.field("reason", rejectReasonName(entry.reject));
+            }
+            writeExecutedTrades(json, outcome.trades.data() + entry.firstTrade, entry.tradeCount);
+            json.endObject();
+        }
+        json.endArray()
+            .field("sequence", outcome.sequence)
+            .endObject();
+        return jsonResponse(json);
+            });
+
+    // POST /api/orders/cancel -> Cancel every order of one book matching the
+    // "owner", "side" and "minPrice"/"maxPrice" filters, as one update. The
+    // request must name an owner or say "all": true.
+    CROW_ROUTE(app, "/api/orders/cancel")
+        .methods("POST"_method)
+        ([&](const crow::request& req) {
+        auto body = crow::json::load(req.body);
+        if (!body) {
+            return crow::response(400, "Invalid JSON");
+        }
+        std::string symbol = body.has("symbol") ? std::string(body["symbol"].s()) : std::string();
+        if (symbol.size() > Symbol::kMaxLength) {
+            return crow::response(400, "Symbol too long");
+        }
+        EngineCommand command;
+        command.type = EngineCommand::Type::MASS_CANCEL;
+        command.symbol = Symbol(symbol);
+        MassCancel& filter = command.massCancel;
+        if (body.has("owner")) {
+            std::int64_t owner = body["owner"].i();
+            if (owner <= 0 || owner >= kFirstSessionOwner) {
+                return crow::response(400, "Invalid owner");
+            }
+            filter.owner = static_cast<OwnerId>(owner);
+        }
+        else if (!body.has("all") || !body["all"].b()) {
+            return crow::response(400, "Missing owner or \"all\": true");
+        }
+        if (body.has("side")) {
+            std::string side = body["side"].s();
+            if (side != "buy" && side != "sell") {
+                return crow::response(400, "Unknown side");
+            }
+            filter.bySide = true;
+            filter.side = side == "buy" ? OrderType::BUY : OrderType::SELL;
+        }
+        if (body.has("minPrice")) {
+            filter.hasMinPrice = true;
+            filter.minPrice = body["minPrice"].d();
+        }
+        if (body.has("maxPrice")) {
+            filter.hasMaxPrice = true;
+            filter.maxPrice = body["maxPrice"].d();
+        }
+        CommandResult outcome = executeCommand(command);
+        StageTimer serialize(MetricStage::SERIALIZE);
 
-        for (const auto& t : trades) {
-            crow::json::wvalue trade;
-            trade["buyOrderID"] = t.buyOrderID;
-            trade["sellOrderID"] = t.sellOrderID;
-            trade["quantity"] = t.quantity;
-            trade["tradePrice"] = t.tradePrice;
-            trades_list.push_back(std::move(trade));
+        JsonWriter json = JsonWriter::threadLocal();
+        json.beginObject().key("cancelled").beginArray();
+        for (OrderId orderId : outcome.cancelled) {
+            json.value(orderId);
         }
-        result["trades"] = std::move(trades_list);
-        return crow::response(result);
+        json.endArray()
+            .field("sequence", outcome.sequence)
+            .endObject();
+        return jsonResponse(json);
             });
 
-    // GET /api/orderbook -> Retrieve the entire Order Book.
+    // GET /api/orderbook?symbol=XYZ -> Every order of the best
+    // BookView::kDefaultLevels levels per side; "truncated" is true when a
+    // side has deeper levels left out.
     CROW_ROUTE(app, "/api/orderbook")
+        .methods("GET"_method)
+        ([&](const crow::request& req) {
+        Symbol symbol;
+        if (!symbolFromQuery(req, symbol)) {
+            return crow::response(400, "Symbol too long");
+        }
+        return engine.readView(symbol, [](const BookView& view) {
+            StageTimer serialize(MetricStage::SERIALIZE);
+            JsonWriter json = JsonWriter::threadLocal();
+            json.beginObject();
+            writeOrderBook(json, view.bids, view.asks);
+            json.field("truncated", view.truncated);
+            json.endObject();
+            return jsonResponse(json);
+            });
+            });
+
+    // GET /api/depth?symbol=XYZ&levels=N -> Aggregated top N levels per side.
+    CROW_ROUTE(app, "/api/depth")
+        .methods("GET"_method)
+        ([&](const crow::request& req) {
+        Symbol symbol;
+        if (!symbolFromQuery(req, symbol)) {
+            return crow::response(400, "Symbol too long");
+        }
+        std::size_t levels = kDefaultDepthLevels;
+        if (const char* param = req.url_params.get("levels")) {
+            // strtol saturates instead of overflowing on huge values.
+            levels = static_cast<std::size_t>(std::clamp(std::strtol(param, nullptr, 10), 1L, kMaxDepthLevels));
+        }
+
+        std::string body = engine.readView(symbol, [&symbol, levels](const BookView& view) {
+            return depthResponse(symbol, levels, view);
+            });
+        crow::response response(body);
+        response.set_header("Content-Type", "application/json");
+        return response;
+            });
+
+    // GET /metrics -> Stage latencies, counters and gauges for Prometheus.
+    CROW_ROUTE(app, "/metrics")
         .methods("GET"_method)
         ([&]() {
-        std::lock_guard<std::mutex> lock(orderBookMutex);
-        auto [buyOrders, sellOrders] = globalOrderBook.getRawOrderBookData();
-        auto resultJson = convertOrderBookToJson(buyOrders, sellOrders);
-        return crow::response(resultJson);
+        std::size_t connections = 0;
+        {
+            std::lock_guard<std::mutex> lock(connection_mutex);
+            connections = active_connections.size();
+        }
+        std::vector<MetricGauge> gauges = {
+            { "orderbook_websocket_connections", "Open market data WebSocket connections.", static_cast<double>(connections) },
+            { "orderbook_bar_missed_trades", "Trades overwritten on a tape before the bar aggregator read them.",
+                static_cast<double>(bar_aggregator.missedTrades()) },
+        };
+        crow::response response(Metrics::renderPrometheus(gauges));
+        response.set_header("Content-Type", "text/plain; version=0.0.4");
+        return response;
             });
 
-    // DELETE /api/order/<int> -> Cancel an order by ID.
+    // DELETE /api/order/<int>?symbol=XYZ -> Cancel an order by ID.
     CROW_ROUTE(app, "/api/order/<int>")
         .methods("DELETE"_method)
-        ([&](int id) {
-        bool cancelled;
-        {
-            std::lock_guard<std::mutex> lock(orderBookMutex);
-            cancelled = globalOrderBook.cancelOrder(id);
+        ([&](const crow::request& req, int id) {
+        EngineCommand command;
+        command.type = EngineCommand::Type::CANCEL;
+        command.orderId = id;
+        if (!symbolFromQuery(req, command.symbol)) {
+            return crow::response(400, "Symbol too long");
         }
+        CommandResult outcome = executeCommand(command);
 
-        if (cancelled) {
-            broadcastOrderBookUpdate();
+        if (outcome.accepted) {
             return crow::response(200, "Order cancelled");
         }
         else {
@@ -197,9 +1460,131 @@ int main()
         }
             });
 
-    // Start the Crow server on port 8080.
+    // PUT /api/order/<int>?symbol=XYZ -> Change an order's price and quantity in place.
+    CROW_ROUTE(app, "/api/order/<int>")
+        .methods("PUT"_method)
+        ([&](const crow::request& req, int id) {
+        auto parseStart = Metrics::Clock::now();
+        auto body = crow::json::load(req.body);
+        if (!body || !body.has("price") || !body.has("quantity")) {
+            return crow::response(400, "Invalid JSON");
+        }
+        EngineCommand command;
+        command.type = EngineCommand::Type::MODIFY;
+        command.orderId = id;
+        command.order.price = body["price"].d();
+        command.order.quantity = body["quantity"].i();
+        if (!symbolFromQuery(req, command.symbol)) {
+            return crow::response(400, "Symbol too long");
+        }
+        Metrics::record(MetricStage::PARSE, parseStart, Metrics::Clock::now());
+        CommandResult outcome = executeCommand(command);
+        StageTimer serialize(MetricStage::SERIALIZE);
+
+        // Same shape as POST /api/orders: a new price may trade.
+        JsonWriter json = JsonWriter::threadLocal();
+        json.beginObject();
+        writeExecutedTrades(json, outcome.trades.data(), outcome.trades.size());
+        json.field("sequence", outcome.sequence)
+            .field("accepted", outcome.accepted);
+        if (!outcome.accepted) {
+            json.field("reason", rejectReasonName(outcome.reject));
+        }
+        json.endObject();
+        crow::response response = jsonResponse(json);
+        if (outcome.reject == RejectReason::UNKNOWN_ORDER) {
+            response.code = 404;
+        }
+        return response;
+            });
+
+    engine.setBookLimit(configuredBookLimit());
+
+    // Recover from the latest snapshot and journal, if any, before accepting traffic.
+    JournalConfig journalConfig;
+    bool journaling = configuredJournal(journalConfig);
+    if (journaling) {
+        if (!engine.enableJournal(journalConfig)) {
+            CROW_LOG_ERROR << "Cannot recover journal in " << journalConfig.directory;
+            return 1;
+        }
+        CROW_LOG_INFO << "Journaling to " << journalConfig.directory;
+    }
+
+    // Periodic snapshots keep the journal that a restart has to replay short.
+    std::thread snapshotter;
+    int snapshotInterval = configuredSnapshotInterval();
+    if (journaling && snapshotInterval > 0) {
+        snapshotter = std::thread([snapshotInterval]() {
+            auto next = std::chrono::steady_clock::now() + std::chrono::seconds(snapshotInterval);
+            while (running) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                if (std::chrono::steady_clock::now() >= next) {
+                    if (!engine.snapshot()) {
+                        CROW_LOG_ERROR << "Snapshot failed";
+                    }
+                    next = std::chrono::steady_clock::now() + std::chrono::seconds(snapshotInterval);
+                }
+            }
+            });
+    }
+
+    // Every book update feeds the WebSocket clients through the feed thread.
+    engine.setUpdateListener([](const Symbol& symbol, const OrderBook&, const CommandResult& result) {
+        FeedEvent event;
+        event.symbol = symbol;
+        event.sequence = result.sequence;
+        event.bookSequence = result.bookSequence;
+        event.deltas = result.deltas;
+        if (market_data_ring.isOpen()) {
+            event.trades = result.trades;
+        }
+        publish(std::move(event));
+        });
+    engine.enableBookViews();
+    std::string ringName;
+    std::size_t ringCapacity = 0;
+    if (configuredMarketDataRing(ringName, ringCapacity)) {
+        std::string error;
+        if (market_data_ring.create(ringName, ringCapacity, error)) {
+            CROW_LOG_INFO << "Publishing market data to shared memory " << ringName;
+        }
+        else {
+            CROW_LOG_ERROR << error;
+        }
+    }
+    std::thread feed(runFeed);
+
+    // Start the matching shards, the binary gateway, then the Crow server on port 8080.
+    engine.start();
+    bar_aggregator.setListener(sendBarUpdates);
+    bar_aggregator.start();
+    BinaryGateway gateway([](const char* data, std::size_t size, std::string& replies, bool& fatal) {
+        return processBinaryOrders(data, size, replies, fatal);
+        });
+    int binaryPort = configuredBinaryPort();
+    if (binaryPort != 0) {
+        if (gateway.start(static_cast<std::uint16_t>(binaryPort))) {
+            CROW_LOG_INFO << "Binary order entry on port " << binaryPort;
+        }
+        else {
+            CROW_LOG_ERROR << "Cannot listen on binary port " << binaryPort;
+        }
+    }
     app.port(8080).multithreaded().run();
 
+    gateway.stop();
     running = false;
+    feed_ready.notify_all();
+    feed.join();
+    market_data_ring.close();
+    bar_aggregator.stop();
+    if (snapshotter.joinable()) {
+        snapshotter.join();
+    }
+    engine.stop();
+    if (journaling && !engine.snapshot()) {
+        CROW_LOG_ERROR << "Final snapshot failed";
+    }
     return 0;
 }
@@ -16,6 +16,34 @@ function getWebSocketURL() {
   return `ws://${baseURL}/orderbook`;
 }
 
+// Apply order-level deltas for one side to a list of resting orders, kept
+// best price first and oldest first within a price.
+function applyDeltas(orders, deltas, side) {
+  let next = orders;
+  for (const delta of deltas) {
+    if (delta.side !== side || delta.type === "level") {
+      continue;
+    }
+    const current = delta.type === "modify" ? next.find((o) => o.orderID === delta.orderID) : undefined;
+    if (current && current.price === delta.price && delta.quantity <= current.quantity) {
+      // Reduced in place: the order keeps its position.
+      next = next.map((o) => (o.orderID === delta.orderID ? { ...o, quantity: delta.quantity } : o));
+    } else if (delta.type === "add" || delta.type === "modify") {
+      // Anything else re-enters at the back of its price level.
+      const order = { orderID: delta.orderID, price: delta.price, quantity: delta.quantity };
+      const behind = (o) => (side === "buy" ? o.price < order.price : o.price > order.price);
+      next = next.filter((o) => o.orderID !== order.orderID);
+      const index = next.findIndex(behind);
+      next = index === -1 ? [...next, order] : [...next.slice(0, index), order, ...next.slice(index)];
+    } else if (delta.type === "remove" || (delta.type === "execute" && delta.remaining === 0)) {
+      next = next.filter((o) => o.orderID !== delta.orderID);
+    } else if (delta.type === "execute") {
+      next = next.map((o) => (o.orderID === delta.orderID ? { ...o, quantity: delta.remaining } : o));
+    }
+  }
+  return next;
+}
+
 function App() {
   const [bids, setBids] = useState([]);
   const [asks, setAsks] = useState([]);
@@ -25,6 +53,9 @@ function App() {
   const [price, setPrice] = useState("");
   const [quantity, setQuantity] = useState("");
   const [orderType, setOrderType] = useState("buy");
+  const [timeInForce, setTimeInForce] = useState("GTC");
+  const [execution, setExecution] = useState("limit"); // limit | market | postOnly
+  const [stopPrice, setStopPrice] = useState(""); // Empty: not a stop order.
 
   // Cancel Order Form
   const [cancelOrderID, setCancelOrderID] = useState("");
@@ -41,35 +72,72 @@ function App() {
         console.error("Error fetching orderbook:", error);
       });
 
-    // 2. Open WebSocket using dynamic URL
-    const socketUrl = getWebSocketURL();
-    const socket = new WebSocket(socketUrl);
+    // 2. Open WebSocket using dynamic URL. The server sends a snapshot, then
+    // only deltas; each message carries the book's sequence number, so a gap
+    // means we missed a delta and must resubscribe for a fresh snapshot.
+    // We acknowledge each message once applied; the server holds back (and
+    // conflates) updates while FEED_WINDOW bytes are unacknowledged.
+    const FEED_WINDOW = 256 * 1024;
+    const socketUrl = `${getWebSocketURL()}?window=${FEED_WINDOW}`;
+    let socket = null;
+    let sequence = null;
 
-    socket.onopen = () => {
-      console.log("WebSocket connected to:", socketUrl);
-    };
+    const connect = () => {
+      sequence = null;
+      socket = new WebSocket(socketUrl);
 
-    socket.onmessage = (event) => {
-      const msg = JSON.parse(event.data);
-      // If it's a snapshot
-      if (msg.type === "snapshot") {
-        setBids(msg.bids || []);
-        setAsks(msg.asks || []);
-      } 
-      // If it's an update
-      else if (msg.status === "update") {
-        const data = msg.data;
-        setBids(data.bids || []);
-        setAsks(data.asks || []);
-      }
-    };
+      socket.onopen = () => {
+        console.log("WebSocket connected to:", socketUrl);
+      };
+
+      socket.onmessage = (event) => {
+        const msg = JSON.parse(event.data);
+        // If it's a snapshot
+        if (msg.type === "snapshot") {
+          sequence = msg.sequence;
+          setBids(msg.bids || []);
+          setAsks(msg.asks || []);
+          acknowledge(msg.sequence);
+        }
+        // If it's a delta
+        else if (msg.type === "delta") {
+          if (sequence === null || msg.sequence <= sequence) {
+            return; // Already contained in the snapshot.
+          }
+          if (msg.sequence !== sequence + 1) {
+            console.warn("Order book feed gap, resyncing");
+            resync();
+            return;
+          }
+          sequence = msg.sequence;
+          setBids((current) => applyDeltas(current, msg.deltas, "buy"));
+          setAsks((current) => applyDeltas(current, msg.deltas, "sell"));
+          acknowledge(msg.sequence);
+        }
+        // Conflated level totals: the server dropped order detail because we
+        // fell behind, so fetch a fresh snapshot of the orders.
+        else if (msg.type === "levels") {
+          resync();
+        }
+      };
 
-    socket.onclose = () => {
-      console.log("WebSocket disconnected");
+      socket.onclose = () => {
+        console.log("WebSocket disconnected");
+      };
+    };
+    const acknowledge = (seq) => {
+      socket.send(JSON.stringify({ type: "ack", sequence: seq }));
+    };
+    const resync = () => {
+      socket.onclose = null;
+      socket.close();
+      connect();
     };
+    connect();
 
     // Cleanup on unmount
     return () => {
+      socket.onclose = null;
       socket.close();
     };
   }, []);
@@ -81,10 +149,19 @@ function App() {
     e.preventDefault();
     const payload = {
       orderID: parseInt(orderID, 10),
-      price: parseFloat(price),
       quantity: parseInt(quantity, 10),
       orderType,
+      timeInForce,
     };
+    if (execution === "market") {
+      payload.market = true;
+    } else {
+      payload.price = parseFloat(price);
+      payload.postOnly = execution === "postOnly";
+    }
+    if (stopPrice !== "") {
+      payload.stopPrice = parseFloat(stopPrice);
+    }
 
     fetch(`${baseURL}/api/orders`, {
       method: "POST",
@@ -95,6 +172,10 @@ function App() {
     })
       .then((res) => res.json())
       .then((data) => {
+        if (data.accepted === false) {
+          console.warn("Order rejected:", data.reason);
+          return;
+        }
         console.log("Order added. Trades executed:", data.trades);
         // The orderbook updates automatically via WebSocket
       })
@@ -192,11 +273,21 @@ function App() {
             <input
               type="number"
               step="0.01"
-              required
+              required={execution !== "market"}
+              disabled={execution === "market"}
               value={price}
               onChange={(e) => setPrice(e.target.value)}
             />
           </div>
+          <div>
+            <label>Stop Price (optional): </label>
+            <input
+              type="number"
+              step="0.01"
+              value={stopPrice}
+              onChange={(e) => setStopPrice(e.target.value)}
+            />
+          </div>
           <div>
             <label>Quantity: </label>
             <input
@@ -216,6 +307,28 @@ function App() {
               <option value="sell">Sell</option>
             </select>
           </div>
+          <div>
+            <label>Execution: </label>
+            <select
+              value={execution}
+              onChange={(e) => setExecution(e.target.value)}
+            >
+              <option value="limit">Limit</option>
+              <option value="market">Market</option>
+              <option value="postOnly">Post-only</option>
+            </select>
+          </div>
+          <div>
+            <label>Time in Force: </label>
+            <select
+              value={timeInForce}
+              onChange={(e) => setTimeInForce(e.target.value)}
+            >
+              <option value="GTC">GTC</option>
+              <option value="IOC">IOC</option>
+              <option value="FOK">FOK</option>
+            </select>
+          </div>
           <button type="submit" style={{ marginTop: "10px" }}>
             Add Order
           </button>